@@ -4,8 +4,69 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Các kênh của vòng quét, theo thứ tự DMA ghi vào bộ đệm (SQ1..SQ4)
+ */
+typedef enum {
+    ADC_CH_POT = 0,    // Biến trở PA0
+    ADC_CH_NTC,        // Cầu phân áp NTC PA4
+    ADC_CH_DIE,        // Cảm biến nhiệt bên trong
+    ADC_CH_VREF,       // VREFINT (≈ 1,21 V), để bù VDDA
+    ADC_CH_COUNT
+} Adc_Channel;
+
+// Oversampling: mỗi khối cộng 2^ADC_OVERSAMPLE_LOG2 mẫu 12-bit của 1 kênh, bỏ bớt bit
+// thấp còn ADC_BITS bit (16 mẫu → thêm 2 bit có nghĩa khi đầu vào có nhiễu ≥ 1 LSB)
+#define ADC_OVERSAMPLE_LOG2  4u
+#define ADC_BITS             14u
+#define ADC_MAX              ((1u << ADC_BITS) - 1)
+
+// Bộ đệm DMA: 2 nửa, mỗi nửa 1 khối 2^ADC_OVERSAMPLE_LOG2 vòng quét
+#define ADC_SCAN_FRAMES      (2u << ADC_OVERSAMPLE_LOG2)
+
+// Giá trị ADC_BITS bit → 12 bit (dải của biến trở, ngưỡng mode, đường cong quạt)
+#define ADC_TO_12BIT(v)      ((uint16_t)((v) >> (ADC_BITS - 12)))
+
+// Lọc thông thấp EMA sau mỗi khối: y += (x − y) / 2^shift, riêng từng kênh (thứ tự
+// Adc_Channel). Bậc lớn hơn ADC_EMA_SNAP (người dùng vặn biến trở, NTC hở) thì
+// nhảy thẳng tới giá trị mới, nên bộ lọc không làm chậm phản hồi.
+#define ADC_EMA_SHIFTS       { 2u, 3u, 3u, 4u }
+#define ADC_EMA_FRAC         8u                             // Bit lẻ của trạng thái EMA
+#define ADC_EMA_SNAP         (64u << (ADC_BITS - 12))       // ~1,6 % dải
+
+// Ngưỡng mode của biến trở (12-bit) và khe trễ ± quanh từng ngưỡng: mode chỉ đổi khi
+// giá trị đã lọc vượt hẳn ra ngoài khe, nên biến trở đứng sát ngưỡng không làm mode nhảy
+#define ADC_MODE_ON_MIN      200u     // Dưới ngưỡng này là vùng tắt (mode 0)
+#define ADC_MODE_THRESHOLDS  { ADC_MODE_ON_MIN, 1365u, 2730u }
+#define ADC_MODE_HYST        { 40u, 64u, 64u }
+
+// Analog watchdog trên biến trở: cửa sổ = dải của mode hiện tại mở rộng theo khe trễ,
+// thu hẹp còn ± ADC_AWD_DEADBAND quanh giá trị đang giữ (đường cong tuyến tính vẫn
+// theo được biến trở trong 1 mode). Biến trở chỉ được lọc trong ADC_POT_ACTIVE_BLOCKS
+// khối sau mỗi lần mẫu thô ra khỏi cửa sổ (đủ để EMA hội tụ < 1 LSB), rồi cửa sổ được
+// đặt lại quanh giá trị mới; không ai vặn thì không tốn chu kỳ nào cho biến trở.
+#define ADC_AWD_DEADBAND      24u     // 12-bit, ~0,6 % dải
+#define ADC_POT_ACTIVE_BLOCKS 16u     // ~63 ms
+
+/**
+ * @brief Thống kê ADC (đọc bằng debugger hoặc chương trình giả lập)
+ */
+typedef struct {
+    uint32_t blocks;       // Số khối mẫu đã xử lý (mỗi nửa bộ đệm DMA)
+    uint32_t overruns;     // Số lần ADC tràn (DMA không kịp đọc), đã quét lại từ đầu
+    uint32_t pot_modes;    // Số lần mode của biến trở đổi (sau khe trễ)
+    uint32_t awd_events;   // Số lần ngắt analog watchdog (biến trở ra khỏi cửa sổ)
+    uint32_t pot_blocks;   // Số khối đã lọc biến trở (chỉ sau ngắt analog watchdog)
+} Adc_Stats;
+
+extern Adc_Stats adc_stats;
+
 void ADC_Init(void);
-uint16_t ADC_Read(void);
+uint16_t ADC_Get(Adc_Channel ch);
+uint16_t ADC_GetPot(void);
+uint8_t ADC_TakeModeEvent(void);
+uint32_t ADC_Sequence(void);
 uint8_t Mode_Update_From_ADC(void);
+uint8_t Mode_From_ADC(uint16_t adc_value);
 
 #endif
@@ -0,0 +1,85 @@
+// ====== control.h ======
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include "hw.h"          // HW_FAN_COUNT
+#include "pid.h"
+
+// Tần số vòng điều khiển mặc định (ngắt update TIM5)
+#define CONTROL_RATE_HZ       1000u
+
+// Khi quạt tắt nhưng hệ thống chưa OFF, Stop mode (TIM5 dừng) kéo dài tối đa bấy
+// nhiêu để biến trở vẫn được đọc (bằng chu kỳ tác vụ điều khiển cũ). ADC không có
+// clock trong Stop, nên analog watchdog của biến trở không đánh thức thay được.
+#define CONTROL_IDLE_POLL_US  100000u
+
+// PID tốc độ chạy 1 lần mỗi bấy nhiêu chu kỳ điều khiển (100 Hz ở 1 kHz): tach chỉ
+// có giá trị mới sau mỗi cạnh (50–100 Hz ở 1500–3000 RPM), chạy nhanh hơn không được gì
+#define CONTROL_PID_DIV       10u
+
+/**
+ * @brief Cách tính duty quạt
+ */
+typedef enum {
+    CONTROL_FAN_CURVE = 0,   // Vòng hở: biến trở → đường cong quạt → duty
+    CONTROL_FAN_RPM,         // Vòng kín cho quạt 0: biến trở → RPM đặt → PID theo tach → duty
+    CONTROL_FAN_TEMP,        // Biến trở ở vùng tắt: tự động theo nhiệt độ (mọi quạt);
+                             // xoay biến trở lên: chỉnh tay theo đường cong như CONTROL_FAN_CURVE
+    CONTROL_FAN_MODE_COUNT
+} Control_FanMode;
+
+/**
+ * @brief Cấu hình vòng điều khiển (đổi bằng Control_SetConfig)
+ */
+typedef struct {
+    uint8_t fan_mode;      // Control_FanMode
+    uint16_t rpm_min;      // RPM đặt ngay trên vùng tắt của biến trở (mode 1 bắt đầu)
+    uint16_t rpm_max;      // RPM đặt ở cuối dải biến trở
+    Pid_Tuning pid;        // Hệ số PID tốc độ (xem pid.h)
+} Control_Config;
+
+// Mặc định chỉnh cho quạt 3000 RPM @ 100 %, quán tính ~0,6 s: PI triệt cực của quạt
+// (ki/kp = 1/0,6 s, hằng số thời gian vòng kín ~0,3 s), slew 300 %/s; RPM đặt tối đa
+// 2700 để còn 10 % duty dự trữ cho quạt yếu hơn danh định
+#define CONTROL_CONFIG_DEFAULT { \
+    CONTROL_FAN_CURVE, 600, 2700, \
+    { 40 << 16, 66 << 16, 0, 196608, 65536 } \
+}
+
+/**
+ * @brief Trạng thái điều khiển mà giao diện (vòng lặp chính) được đọc,
+ *        chụp lại nguyên khối ở cuối mỗi lần chạy vòng điều khiển
+ */
+typedef struct {
+    uint8_t state;       // Fsm_State
+    uint8_t mode;        // Mode đang áp dụng (0–3)
+    uint8_t countdown;   // Số giây đếm ngược còn lại
+    uint16_t adc;        // Giá trị biến trở gần nhất (12-bit)
+    uint16_t rpm[HW_FAN_COUNT];      // Tốc độ từng quạt đo bằng tach (0: đứng hoặc không có tach)
+    uint16_t permille[HW_FAN_COUNT]; // Duty đang ra của từng quạt (‰)
+    uint16_t target_rpm; // RPM đặt của vòng kín quạt 0 (0: vòng hở hoặc quạt tắt)
+    int16_t ntc_dc;      // Nhiệt độ NTC (0,1 °C), TEMP_INVALID nếu chập/hở
+    int16_t die_dc;      // Nhiệt độ chip (0,1 °C)
+    uint8_t temp_auto;   // Quạt đang chạy tự động theo nhiệt độ (CONTROL_FAN_TEMP)
+} Control_Snapshot;
+
+/**
+ * @brief Thống kê vòng điều khiển (đọc bằng debugger hoặc chương trình giả lập)
+ */
+typedef struct {
+    uint32_t rate_hz;      // Tần số đã cấu hình
+    uint32_t runs;         // Số lần ISR đã chạy
+    uint32_t exec_max;     // Số chu kỳ CPU lâu nhất của 1 lần chạy (DWT)
+} Control_Stats;
+
+extern Control_Stats control_stats;
+extern Control_Config control_config;
+
+void Control_Init(uint32_t rate_hz);
+void TIM5_IRQHandler(void);
+void Control_GetSnapshot(Control_Snapshot* snap);
+uint8_t Control_StopAllowed(uint64_t* deadline);
+void Control_SetConfig(const Control_Config* config);
+
+#endif
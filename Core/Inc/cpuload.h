@@ -0,0 +1,58 @@
+// ====== cpuload.h ======
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include <stdint.h>
+#include "sched.h"     // SCHED_MAX_TASKS
+
+/**
+ * @brief Ngữ cảnh được tính chu kỳ CPU (DWT CYCCNT). Tại mỗi thời điểm CPU nằm
+ *        trong đúng 1 ngữ cảnh; ISR và I2C lồng vào ngữ cảnh đang chạy.
+ */
+typedef enum {
+    CPU_SLOT_IDLE = 0,    // Vòng ngủ Sleep_Until (phần CPU còn thức)
+    CPU_SLOT_MAIN,        // Vòng lặp chính ngoài tác vụ
+    CPU_SLOT_SYSTICK,     // ISR SysTick
+    CPU_SLOT_EXTI,        // ISR nút nhấn
+    CPU_SLOT_RTC,         // ISR RTC wakeup
+    CPU_SLOT_CONTROL,     // ISR TIM5: vòng điều khiển
+    CPU_SLOT_TACH,        // ISR TIM3: bắt cạnh tach quạt
+    CPU_SLOT_ADC,         // ISR DMA2: khối mẫu ADC mới
+    CPU_SLOT_I2C,         // Chờ bus I2C (tách khỏi tác vụ gọi nó)
+    CPU_SLOT_TASK,        // CPU_SLOT_TASK + ID: tác vụ trong bộ lập lịch
+    CPU_SLOT_COUNT = CPU_SLOT_TASK + SCHED_MAX_TASKS
+} Cpu_Slot;
+
+// Độ dài cửa sổ tổng hợp (µs)
+#define CPU_WINDOW_US  1000000u
+
+/**
+ * @brief Tải CPU (đọc bằng debugger, trang OLED debug hoặc chương trình giả lập)
+ *
+ * CYCCNT dừng khi CPU ngủ (WFI/Stop), nên thời gian rảnh = thời gian thực của cửa
+ * sổ (GetTimeUs64) − chu kỳ bận; vòng ngủ CPU_SLOT_IDLE cũng tính là rảnh.
+ */
+typedef struct {
+    uint32_t windows;                        // Số cửa sổ đã đóng
+    uint32_t window_us;                      // Độ dài thực của cửa sổ gần nhất
+    uint16_t busy_permille;                  // Tỉ lệ bận của cửa sổ gần nhất (‰)
+    uint16_t permille[CPU_SLOT_COUNT];       // Tỉ lệ từng ngữ cảnh trong cửa sổ gần nhất (‰)
+    uint32_t cycles[CPU_SLOT_COUNT];         // Chu kỳ từng ngữ cảnh trong cửa sổ gần nhất
+    uint64_t total_cycles[CPU_SLOT_COUNT];   // Tổng chu kỳ từ khi khởi tạo
+} CpuLoad_Stats;
+
+// Trang mà Task_Display vẽ (cpu_load_page, ghi bằng debugger)
+#define CPU_PAGE_MAIN   0u   // Trạng thái thiết bị + tốc độ quạt
+#define CPU_PAGE_LOAD   1u   // Tải CPU
+#define CPU_PAGE_FANS   2u   // Tóm tắt các quạt
+
+extern CpuLoad_Stats cpu_load;
+extern volatile uint8_t cpu_load_page;       // CPU_PAGE_*
+
+void CpuLoad_Init(void);
+uint8_t CpuLoad_Enter(uint8_t slot);
+void CpuLoad_Leave(uint8_t prev);
+void CpuLoad_Update(void);
+const char* CpuLoad_SlotName(uint8_t slot);
+
+#endif
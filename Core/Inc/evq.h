@@ -0,0 +1,32 @@
+// ====== evq.h ======
+#ifndef EVQ_H
+#define EVQ_H
+
+#include <stdint.h>
+
+// Kích thước hàng đợi, phải là lũy thừa của 2 (chỉ số chạy tự do, lấy mod bằng phép AND)
+#define EVQ_SIZE  16
+
+/**
+ * @brief Một sự kiện có dấu thời gian (GetTimeUs64() lúc ISR ghi vào)
+ */
+typedef struct {
+    uint64_t time;
+    uint8_t type;       // Mã sự kiện (với nút nhấn: Fsm_Event)
+} Evq_Event;
+
+/**
+ * @brief Thống kê hàng đợi (đọc bằng debugger hoặc chương trình giả lập)
+ */
+typedef struct {
+    uint32_t pushed;       // Số sự kiện đã ghi thành công
+    uint32_t dropped;      // Số sự kiện bị mất do hàng đợi đầy
+    uint8_t high_water;    // Số phần tử lớn nhất từng nằm trong hàng đợi
+} Evq_Stats;
+
+extern Evq_Stats evq_stats;
+
+uint8_t Evq_Push(uint8_t type, uint64_t time);
+uint8_t Evq_Pop(Evq_Event* ev);
+
+#endif
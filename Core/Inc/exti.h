@@ -4,12 +4,8 @@
 
 #include <stdint.h>
 
-extern volatile uint8_t countdown;
-extern volatile uint8_t mode;
-extern volatile uint8_t button_pressed;
-extern volatile uint8_t system_active;
-extern volatile uint8_t oled_state;
-
 void GPIO_EXTI_Init(void);
+void Buttons_EnableCountdown(uint8_t enable);
+uint8_t Buttons_Process(void);
 
 #endif
@@ -0,0 +1,47 @@
+// ====== fancurve.h ======
+#ifndef FANCURVE_H
+#define FANCURVE_H
+
+#include <stdint.h>
+
+// Số điểm tối đa của 1 đường cong (tìm nhị phân đúng 4 bước)
+#define FANCURVE_MAX_POINTS   16u
+
+// Giá trị ADC lớn nhất (12-bit)
+#define FANCURVE_ADC_MAX      4095u
+
+// Độ dốc lưu dạng (Δduty Q16 / ΔADC) · 2^FANCURVE_SLOPE_SHIFT: với |Δduty| ≤ 65536,
+// tích độ dốc · khoảng cách trong 1 đoạn ≤ 2^28, vừa int32
+#define FANCURVE_SLOPE_SHIFT  12u
+
+/**
+ * @brief 1 điểm của đường cong quạt
+ */
+typedef struct {
+    uint16_t adc;          // Giá trị biến trở (0..FANCURVE_ADC_MAX), tăng dần nghiêm ngặt
+    uint16_t permille;     // Duty tại điểm đó (0..1000 ‰)
+} FanCurve_Point;
+
+/**
+ * @brief Đường cong dựng sẵn
+ */
+typedef enum {
+    FANCURVE_PRESET_STEP = 0,   // 4 mức cũ: < 200 / 1365 / 2730 → 0 / 40 / 70 / 100 %
+    FANCURVE_PRESET_LINEAR,     // Tắt dưới 200, rồi tuyến tính 20 % → 100 %
+    FANCURVE_PRESET_QUIET,      // Êm ở nửa dưới, tăng nhanh ở nửa trên
+    FANCURVE_PRESET_COUNT
+} FanCurve_Preset;
+
+// Đường cong lúc khởi động (mọi quạt): giữ nguyên hành vi 4 mode
+#define FANCURVE_DEFAULT_PRESET  FANCURVE_PRESET_STEP
+
+void FanCurve_Init(void);
+uint8_t FanCurve_Set(uint8_t fan, const FanCurve_Point* points, uint8_t count);
+uint8_t FanCurve_SelectPreset(uint8_t fan, uint8_t preset);
+uint8_t FanCurve_GetPreset(uint8_t fan);
+uint32_t FanCurve_Version(void);
+uint32_t FanCurve_Eval(uint8_t fan, uint16_t adc);
+const FanCurve_Point* FanCurve_PresetPoints(uint8_t preset, uint8_t* count);
+const char* FanCurve_PresetName(uint8_t preset);
+
+#endif
@@ -0,0 +1,79 @@
+// ====== fsm.h ======
+#ifndef FSM_H
+#define FSM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Trạng thái thiết bị (cũng là nội dung màn hình OLED)
+ */
+typedef enum {
+    FSM_ST_READY = 0,     // Hết countdown, quạt tắt – "SYSTEM READY"
+    FSM_ST_COUNTDOWN,     // Đang đếm lùi, quạt chạy theo mode – "DEVICE STATUS"
+    FSM_ST_OFF,           // Hệ thống tắt – "SYSTEM STOPPED"
+    FSM_ST_RUN,           // Chạy liên tục theo mode – "TIME: INF"
+    FSM_ST_COUNT
+} Fsm_State;
+
+/**
+ * @brief Sự kiện đưa vào máy trạng thái. Các nút nhấn có mã 0..FSM_EV_BUTTONS-1
+ *        (ISR ghi thẳng mã này vào hàng đợi sự kiện)
+ */
+typedef enum {
+    FSM_EV_POWER = 0,     // PA6: Bật/tắt hệ thống
+    FSM_EV_10S,           // PA7: Countdown 10 s
+    FSM_EV_20S,           // PB0: Countdown 20 s
+    FSM_EV_30S,           // PB1: Countdown 30 s
+    FSM_EV_SECOND,        // Mỗi giây (tác vụ countdown)
+    FSM_EV_TIMEOUT,       // Countdown về 0 (sự kiện nội bộ)
+    FSM_EV_COUNT
+} Fsm_Event;
+
+#define FSM_EV_BUTTONS   4
+#define FSM_ST_NONE      0xFF   // Ô bảng chuyển trạng thái rỗng: bỏ qua sự kiện
+
+typedef uint8_t (*Fsm_Guard)(void);
+typedef void (*Fsm_Action)(uint8_t event);
+
+/**
+ * @brief Một ô trong bảng chuyển trạng thái [trạng thái][sự kiện]
+ *        next == trạng thái hiện tại: chuyển nội bộ (không chạy exit/entry)
+ */
+typedef struct {
+    uint8_t next;         // Trạng thái đích, FSM_ST_NONE: bỏ qua
+    Fsm_Guard guard;      // NULL: luôn cho phép
+    Fsm_Action action;    // NULL: không làm gì (chạy giữa exit và entry)
+} Fsm_Transition;
+
+/**
+ * @brief Thông tin cố định của 1 trạng thái
+ */
+typedef struct {
+    const char* name;
+    void (*entry)(void);
+    void (*exit)(void);
+    uint8_t fan_on;       // 1: PWM/LED chạy theo mode, 0: tắt
+} Fsm_StateInfo;
+
+/**
+ * @brief Dữ liệu thiết bị do máy trạng thái quản lý
+ *        (sau Fsm_Init chỉ vòng điều khiển trong ISR TIM5 truy cập; vòng lặp
+ *        chính chỉ đọc bản chụp Control_Snapshot)
+ */
+typedef struct {
+    uint8_t state;        // Fsm_State
+    uint8_t mode;         // Mức quạt 0..3
+    uint8_t countdown;    // Số giây còn lại
+    uint8_t hold_mode;    // 1: mode vừa được đặt bởi nút, bỏ qua 1 lần đọc ADC
+} Fsm_Device;
+
+extern Fsm_Device device;
+extern const Fsm_Transition fsm_table[FSM_ST_COUNT][FSM_EV_COUNT];
+extern const Fsm_StateInfo fsm_states[FSM_ST_COUNT];
+extern const char* const fsm_event_names[FSM_EV_COUNT];
+
+void Fsm_Init(uint8_t state);
+uint8_t Fsm_Dispatch(uint8_t event);
+uint8_t Fsm_FanEnabled(void);
+
+#endif
@@ -0,0 +1,76 @@
+// ====== hw.h ======
+#ifndef HW_H
+#define HW_H
+
+#include <stdint.h>
+
+// Tần số clock hệ thống (HSI 16 MHz, không dùng PLL)
+#define HW_CPU_HZ       16000000
+
+// Clock của các timer trên APB1 (APB1 không chia → bằng HCLK)
+#define HW_TIM_HZ       16000000
+
+// ADC1: ADCCLK = PCLK2 / 2 (ADCPRE = 00); mỗi lần chuyển đổi mất thời gian lấy mẫu
+// (480 chu kỳ, đủ cho cảm biến nhiệt bên trong) + 12 chu kỳ
+#define HW_ADC_CLK_HZ       (HW_CPU_HZ / 2)
+#define HW_ADC_CONV_CYCLES  (480u + 12u)
+
+// Cờ DMA của vòng quét ADC1 (HW_ADC_DmaFlags)
+#define HW_ADC_DMA_HALF     (1u << 0)   // HTIF: nửa đầu bộ đệm vừa đầy
+#define HW_ADC_DMA_FULL     (1u << 1)   // TCIF: nửa sau vừa đầy, DMA quay về đầu bộ đệm
+
+// Các đường EXTI dùng cho nút nhấn
+#define HW_EXTI_PB0     (1u << 0)
+#define HW_EXTI_PB1     (1u << 1)
+#define HW_EXTI_PA6     (1u << 6)
+#define HW_EXTI_PA7     (1u << 7)
+
+// RTC: bộ đếm giây con 4096 Hz (LSE / 8), wakeup timer 2048 Hz (LSE / 16)
+#define HW_RTC_HZ       4096u
+#define HW_RTC_WRAP     (86400u * HW_RTC_HZ)   // Lịch quay vòng sau 24 giờ
+#define HW_RTC_WUT_HZ   2048u
+#define HW_RTC_WUT_MAX  65536u                 // WUTR 16-bit: tối đa 32 s
+
+// Nguyên nhân reset (HW_ResetCause, từ RCC_CSR)
+#define HW_RESET_PIN    (1u << 0)   // Chân NRST
+#define HW_RESET_POWER  (1u << 1)   // Cấp nguồn (POR/PDR) hoặc sụt áp (BOR)
+#define HW_RESET_SOFT   (1u << 2)   // NVIC_SystemReset
+#define HW_RESET_IWDG   (1u << 3)   // Independent watchdog
+#define HW_RESET_WWDG   (1u << 4)   // Window watchdog
+#define HW_RESET_LPWR   (1u << 5)   // Vào Standby/Stop trái phép (option byte)
+
+// Số quạt: quạt i xuất PWM trên 1 kênh TIM4 và đọc tach trên TIM3 kênh i + 1
+// (bảng chân trong hw_stm32f401.h). Tối đa 4 nhưng trên LQFP64, TIM4 CH3/CH4 chỉ ra
+// được PB8/PB9 (đang là I2C1 của OLED), nên bản này dùng 2.
+#define HW_FAN_MAX      4u
+#ifndef HW_FAN_COUNT
+#define HW_FAN_COUNT    2u
+#endif
+#if HW_FAN_COUNT < 1 || HW_FAN_COUNT > HW_FAN_MAX
+#error "HW_FAN_COUNT phai trong 1..HW_FAN_MAX"
+#endif
+
+// Cờ trạng thái TIM3 dùng cho tach (trùng vị trí bit trong TIM3_SR), `fan` = kênh − 1
+#define HW_TACH_UPDATE            (1u << 0)           // UIF: bộ đếm 16-bit tràn
+#define HW_TACH_CAPTURE(fan)      (1u << (1 + (fan))) // CCxIF: đã bắt cạnh vào CCRx
+#define HW_TACH_OVERCAPTURE(fan)  (1u << (9 + (fan))) // CCxOF: bắt cạnh mới khi CCxIF chưa được xóa
+#define HW_TACH_CAPTURE_ALL       (((1u << HW_FAN_COUNT) - 1) << 1)
+#define HW_TACH_OVERCAPTURE_ALL   (((1u << HW_FAN_COUNT) - 1) << 9)
+
+// Cờ trạng thái I2C1 (SR1)
+#define HW_I2C_SB       (1u << 0)   // Đã gửi START
+#define HW_I2C_ADDR     (1u << 1)   // Slave đã ACK địa chỉ
+#define HW_I2C_BTF      (1u << 2)   // Truyền xong byte
+#define HW_I2C_TXE      (1u << 7)   // Thanh ghi DR trống
+#define HW_I2C_AF       (1u << 10)  // Slave không ACK
+
+// Chọn lớp phần cứng lúc biên dịch:
+//   - Firmware: truy cập thanh ghi STM32F401 qua hàm inline (không tốn thêm chu kỳ)
+//   - HOST_SIM: vi điều khiển giả lập chạy trên Linux (Host/Src/hw_sim.c)
+#ifdef HOST_SIM
+#include "hw_sim.h"
+#else
+#include "hw_stm32f401.h"
+#endif
+
+#endif
@@ -0,0 +1,834 @@
+// ====== hw_stm32f401.h ======
+#ifndef HW_STM32F401_H
+#define HW_STM32F401_H
+
+#include "stm32f4xx.h"   // Thư viện CMSIS cho STM32F4
+
+
+// =======================================
+// ============== CORE / NVIC ============
+// =======================================
+
+/**
+ * @brief Gọi trong mỗi vòng lặp bận chờ. Trên phần cứng thật không làm gì
+ *        (bản giả lập dùng điểm này để cho thời gian ảo trôi đi)
+ */
+static inline void HW_Spin(void) {
+}
+
+/**
+ * @brief Cho CPU ngủ (Sleep mode) tới khi có ngắt. Nếu gọi khi PRIMASK = 1,
+ *        CPU vẫn thức dậy khi có ngắt pending nhưng chỉ vào ISR sau HW_IRQ_Enable
+ */
+static inline void HW_WaitForInterrupt(void) {
+    __DSB();   // Hoàn tất các lệnh ghi bộ nhớ trước khi ngủ
+    __WFI();
+}
+
+static inline void HW_IRQ_Disable(void) {
+    __disable_irq();
+}
+
+static inline void HW_IRQ_Enable(void) {
+    __enable_irq();
+}
+
+/**
+ * @brief Che ngắt và trả về trạng thái PRIMASK cũ (dùng được lồng nhau, kể cả trong ISR)
+ */
+static inline uint32_t HW_IRQ_Save(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static inline void HW_IRQ_Restore(uint32_t primask) {
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Bật bộ đếm chu kỳ CPU DWT CYCCNT (đếm theo HCLK, dừng khi CPU ngủ WFI/Stop)
+ */
+static inline void HW_CycleCounter_Init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;  // Bật khối DWT/ITM
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;             // Bắt đầu đếm
+}
+
+static inline uint32_t HW_CycleCount(void) {
+    return DWT->CYCCNT;
+}
+
+
+/**
+ * @brief Cấu hình SysTick tạo ngắt mỗi (reload + 1) chu kỳ clock hệ thống
+ */
+static inline void HW_SysTick_Init(uint32_t reload) {
+    SysTick->LOAD = reload;
+
+    // Reset giá trị hiện tại của SysTick counter về 0
+    SysTick->VAL = 0;
+
+    // Bật SysTick:
+    // - Bit 2: CLKSOURCE = 1 => chọn clock hệ thống (HCLK = 16 MHz)
+    // - Bit 1: TICKINT = 1 => cho phép tạo ngắt
+    // - Bit 0: ENABLE = 1 => bắt đầu đếm
+    SysTick->CTRL = (1 << 2) |  // CLKSOURCE = processor clock
+                    (1 << 1) |  // TICKINT = enable interrupt
+                    (1 << 0);   // ENABLE = enable counter
+
+    // Ưu tiên cao nhất: ISR SysTick giám sát watchdog, phải chen được vào TIM5/EXTI
+    NVIC_SetPriority(SysTick_IRQn, 0);
+}
+
+
+/**
+ * @brief Giá trị hiện tại của bộ đếm lùi SysTick (LOAD → 0)
+ */
+static inline uint32_t HW_SysTick_Value(void) {
+    return SysTick->VAL;
+}
+
+
+/**
+ * @brief SysTick đã tràn nhưng ISR chưa được thực thi (ICSR.PENDSTSET)
+ */
+static inline uint8_t HW_SysTick_Pending(void) {
+    return (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ? 1 : 0;
+}
+
+
+/**
+ * @brief Dừng SysTick (trước khi vào Stop) và xóa ngắt đang chờ
+ * @return 1 nếu SysTick đã tràn nhưng ISR chưa chạy (tick đó cần được cộng bù)
+ */
+static inline uint8_t HW_SysTick_Suspend(void) {
+    uint8_t pending;
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    pending = HW_SysTick_Pending();
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    return pending;
+}
+
+
+/**
+ * @brief Chạy lại SysTick từ đầu một chu kỳ
+ */
+static inline void HW_SysTick_Resume(void) {
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+}
+
+
+/**
+ * @brief Vào Stop mode: tắt HSI và mọi clock trừ LSE/RTC, ổn áp công suất thấp.
+ *        Thức dậy bởi EXTI (nút nhấn) hoặc RTC wakeup (EXTI line 22).
+ *        Gọi khi PRIMASK = 1: CPU chạy tiếp sau WFI, ISR chỉ chạy sau HW_IRQ_Enable.
+ *
+ * Lưu ý: TIM4 cũng dừng, chân PWM giữ nguyên mức → chỉ dùng khi quạt đang tắt.
+ */
+static inline void HW_EnterStop(void) {
+    PWR->CR &= ~PWR_CR_PDDS;              // PDDS = 0: Stop, không phải Standby
+    PWR->CR |= PWR_CR_LPDS;               // LPDS = 1: ổn áp công suất thấp
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+    // Sau Stop clock hệ thống là HSI 16 MHz – trùng cấu hình đang dùng, không cần cấu hình lại.
+    // Thanh ghi shadow của lịch RTC phải được đồng bộ lại trước khi đọc (RM0368 §17.3.6)
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+    RTC->ISR &= ~RTC_ISR_RSF;
+    RTC->WPR = 0xFF;
+    while (!(RTC->ISR & RTC_ISR_RSF));
+}
+
+
+// =======================================
+// ============ LED (PA1–PA3) ============
+// =======================================
+
+/**
+ * @brief Cấu hình PA1, PA2, PA3 làm output push-pull
+ */
+static inline void HW_LED_Init(void) {
+    // Bật clock cho GPIOA (bit 0 của RCC->AHB1ENR)
+    RCC->AHB1ENR |= (1 << 0); // GPIOAEN
+
+    // Thiết lập PA1, PA2, PA3 là output mode (MODER = 01)
+    GPIOA->MODER &= ~((3 << (1 * 2)) | (3 << (2 * 2)) | (3 << (3 * 2))); // Xóa trước
+    GPIOA->MODER |=  (1 << (1 * 2)) | (1 << (2 * 2)) | (1 << (3 * 2));   // Đặt lại = 01
+
+    // Thiết lập kiểu output là push-pull (OTYPER = 0)
+    GPIOA->OTYPER &= ~((1 << 1) | (1 << 2) | (1 << 3));
+}
+
+
+/**
+ * @brief Ghi trạng thái 3 LED trong 1 lần ghi BSRR (nguyên tử, không cần read-modify-write)
+ * @param mask Bit 0: LED1 (PA1), bit 1: LED2 (PA2), bit 2: LED3 (PA3)
+ */
+static inline void HW_LED_Write(uint8_t mask) {
+    uint32_t on  = (uint32_t)(mask & 0x7) << 1;
+    uint32_t off = (uint32_t)(~mask & 0x7) << 1;
+    GPIOA->BSRR = on | (off << 16);
+}
+
+
+// =======================================
+// ====== PWM quạt (TIM4, PB6..PB9) ======
+// =======================================
+
+// TIM4 CHk ra chân PB(5 + k) với AF2. Quạt 0 giữ CH2/PB7 như bản 1 quạt, quạt 1 dùng
+// CH1/PB6. CH3/CH4 chỉ có trên PB8/PB9 (gói LQFP64 không có PD12–PD15 để remap),
+// trùng SCL/SDA của I2C1 nối OLED.
+#if HW_FAN_COUNT > 2
+#error "TIM4 CH3/CH4 (PB8/PB9) dang la I2C1 cua OLED: toi da 2 quat"
+#endif
+
+/**
+ * @brief Kênh TIM4 (1..4) của quạt `fan`
+ */
+static inline uint32_t HW_PWM_Channel(uint8_t fan) {
+    return (fan == 0) ? 2u : (fan == 1) ? 1u : fan + 1u;
+}
+
+/**
+ * @brief Clock thực tế của TIM4 (timer APB1), đọc từ cấu hình RCC hiện tại:
+ *        bằng PCLK1 nếu APB1 không chia, gấp đôi PCLK1 nếu có chia (RM0368 §6.2)
+ */
+static inline uint32_t HW_PWM_ClockHz(void) {
+    uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+
+    SystemCoreClockUpdate();               // HCLK theo nguồn clock + bộ chia AHB
+    if (ppre1 < 4) return SystemCoreClock; // PPRE1 = 0xx: APB1 không chia
+    return (SystemCoreClock >> (ppre1 - 3)) * 2;
+}
+
+
+/**
+ * @brief Khởi tạo TIM4 xuất PWM cho HW_FAN_COUNT quạt (cùng tần số, duty riêng)
+ *        f_PWM = f_TIM4 / ((PSC + 1) * (ARR + 1))
+ */
+static inline void HW_PWM_Init(uint16_t psc, uint16_t arr) {
+    // Bật clock cho GPIOB (PB6..PB9)
+    RCC->AHB1ENR |= (1 << 1);  // GPIOBEN = 1
+
+    // Bật clock cho TIM4 (trên bus APB1)
+    RCC->APB1ENR |= (1 << 2);  // TIM4EN = 1
+
+    // Cấu hình bộ định thời TIM4
+    TIM4->PSC = psc;   // Prescaler: f_TIM = f_APB1 / (PSC + 1)
+    TIM4->ARR = arr;   // Auto-reload value: xác định chu kỳ PWM
+
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        uint32_t ch = HW_PWM_Channel(fan);
+        uint32_t pin = 5 + ch;                                  // PB(5 + k)
+        volatile uint32_t* ccmr = (ch <= 2) ? &TIM4->CCMR1 : &TIM4->CCMR2;
+        uint32_t shift = (ch & 1) ? 0 : 8;                      // CH1/CH3: byte thấp, CH2/CH4: byte cao
+
+        // Chân ở chế độ Alternate Function, AF2 (TIM4_CHk)
+        GPIOB->MODER &= ~(3u << (pin * 2));                     // Xóa 2 bit MODERx
+        GPIOB->MODER |=  (2u << (pin * 2));                     // MODERx = 10 (AF mode)
+        GPIOB->AFR[pin >> 3] &= ~(0xFu << ((pin & 7) * 4));     // Xóa trước
+        GPIOB->AFR[pin >> 3] |=  (2u << ((pin & 7) * 4));       // AF2
+
+        (&TIM4->CCR1)[ch - 1] = 0;                              // Duty khởi đầu = 0%
+
+        // PWM mode 1 (OCxM = 110) và preload cho CCRx (OCxPE = 1, đồng bộ hóa cập nhật)
+        *ccmr &= ~(7u << (4 + shift));
+        *ccmr |=  (6u << (4 + shift)) | (1u << (3 + shift));
+
+        // Cho phép kênh xuất tín hiệu PWM ra chân
+        TIM4->CCER |= 1u << (4 * (ch - 1));                     // CCxE = 1
+    }
+
+    // Bật bộ đếm TIM4 để bắt đầu hoạt động
+    TIM4->CR1 |= (1 << 0);      // CEN = 1
+}
+
+static inline void HW_PWM_SetCompare(uint8_t fan, uint16_t ccr) {
+    (&TIM4->CCR1)[HW_PWM_Channel(fan) - 1] = ccr;
+}
+
+static inline uint16_t HW_PWM_GetCompare(uint8_t fan) {
+    return (uint16_t)(&TIM4->CCR1)[HW_PWM_Channel(fan) - 1];
+}
+
+
+// =======================================
+// ======= TIM5 (vòng điều khiển) ========
+// =======================================
+
+/**
+ * @brief TIM5 tạo ngắt update định kỳ cho vòng điều khiển
+ *        f_update = HW_TIM_HZ / ((PSC + 1) * (ARR + 1)). TIM5 dừng trong Stop mode.
+ */
+static inline void HW_TIM5_Init(uint16_t psc, uint32_t arr) {
+    RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;  // Bật clock TIM5 (APB1)
+
+    TIM5->PSC = psc;
+    TIM5->ARR = arr;                     // TIM5 là timer 32-bit
+    TIM5->EGR = TIM_EGR_UG;              // Nạp PSC/ARR ngay
+    TIM5->SR = 0;                        // Xóa cờ UIF do UG tạo ra
+    TIM5->DIER |= TIM_DIER_UIE;          // Cho phép ngắt update
+
+    // Chỉ sau SysTick (mức 0, giám sát watchdog): vòng điều khiển chen được vào ISR nút nhấn
+    NVIC_SetPriority(TIM5_IRQn, 1);
+    NVIC_EnableIRQ(TIM5_IRQn);
+
+    TIM5->CR1 |= TIM_CR1_CEN;            // Bắt đầu đếm
+}
+
+static inline void HW_TIM5_ClearUpdate(void) {
+    TIM5->SR = ~(uint32_t)TIM_SR_UIF;    // rc_w0: ghi 0 để xóa UIF
+}
+
+
+// =======================================
+// ===== Tach quạt (TIM3 CH1..CH4) =======
+// =======================================
+
+/**
+ * @brief Chân tach của quạt `fan` (TIM3 kênh fan + 1, AF2): PB4, PB5, PC8, PC9
+ */
+static inline GPIO_TypeDef* HW_TACH_Port(uint8_t fan) {
+    return (fan < 2) ? GPIOB : GPIOC;
+}
+
+static inline uint32_t HW_TACH_Pin(uint8_t fan) {
+    return (fan < 2) ? 4u + fan : 6u + fan;
+}
+
+
+/**
+ * @brief TIM3 đếm tự do 16-bit (ARR = 0xFFFF) ở HW_TIM_HZ / (PSC + 1), kênh fan + 1
+ *        bắt cạnh xuống của chân tach từng quạt có bit trong `mask`
+ * @param icpsc_log2 Bắt 1 lần mỗi 2^icpsc_log2 cạnh (0..3, ICxPSC)
+ * @param filter Bộ lọc số ICxF (0..15): bỏ xung nhiễu ngắn hơn vài µs
+ * @param mask Bit i: quạt i có dây tach (quạt 2/3 dây không có: kênh để tắt)
+ *
+ * Ngắt capture và ngắt update (tràn) cùng vào TIM3_IRQn: ISR ghép số lần tràn với
+ * CCRx thành thời điểm 32-bit. TIM3 dừng trong Stop mode.
+ */
+static inline void HW_TACH_Init(uint16_t psc, uint8_t icpsc_log2, uint8_t filter, uint8_t mask) {
+    uint32_t cfg = (1u << TIM_CCMR1_CC1S_Pos)                   // CCxS = 01: ICx nối TIx
+                 | ((uint32_t)(icpsc_log2 & 3) << TIM_CCMR1_IC1PSC_Pos)
+                 | ((uint32_t)(filter & 0xF) << TIM_CCMR1_IC1F_Pos);
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN | RCC_AHB1ENR_GPIOCEN;  // Bật clock GPIOB/GPIOC
+    RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;   // Bật clock TIM3 (APB1)
+
+    TIM3->CR1 = 0;
+    TIM3->PSC = psc;
+    TIM3->ARR = 0xFFFF;                   // Đếm hết 16 bit, phần cao do ISR đếm số lần tràn
+    TIM3->CCMR1 = 0;
+    TIM3->CCMR2 = 0;
+    TIM3->CCER = 0;
+    TIM3->DIER = TIM_DIER_UIE;
+
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        GPIO_TypeDef* port = HW_TACH_Port(fan);
+        uint32_t pin = HW_TACH_Pin(fan);
+
+        if (!(mask & (1u << fan))) continue;
+
+        // Alternate Function AF2 (TIM3_CHx), kéo lên vì tach của quạt là cực góp hở
+        port->MODER &= ~(3u << (pin * 2));
+        port->MODER |=  (2u << (pin * 2));                      // MODERx = 10 (AF mode)
+        port->PUPDR &= ~(3u << (pin * 2));
+        port->PUPDR |=  (1u << (pin * 2));                      // PUPDRx = 01 (pull-up)
+        port->AFR[pin >> 3] &= ~(0xFu << ((pin & 7) * 4));
+        port->AFR[pin >> 3] |=  (2u << ((pin & 7) * 4));        // AF2
+
+        // CH1/CH2 trong CCMR1, CH3/CH4 trong CCMR2 (byte thấp/cao như nhau)
+        if (fan < 2) TIM3->CCMR1 |= cfg << (8 * fan);
+        else TIM3->CCMR2 |= cfg << (8 * (fan - 2));
+        TIM3->CCER |= (TIM_CCER_CC1P | TIM_CCER_CC1E) << (4 * fan);   // Cạnh xuống, bật bắt kênh
+        TIM3->DIER |= TIM_DIER_CC1IE << fan;
+    }
+
+    TIM3->EGR = TIM_EGR_UG;               // Nạp PSC ngay, CNT = 0
+    TIM3->SR = 0;                         // Xóa cờ UIF do UG tạo ra
+
+    // Cùng mức với vòng điều khiển: không ngắt nhau, nên vòng điều khiển đọc bộ đệm
+    // tach nhất quán. CCRx giữ giá trị đã bắt nên trễ ISR không làm sai phép đo.
+    NVIC_SetPriority(TIM3_IRQn, 1);
+    NVIC_EnableIRQ(TIM3_IRQn);
+
+    TIM3->CR1 = TIM_CR1_CEN;              // Bắt đầu đếm
+}
+
+static inline uint32_t HW_TACH_Flags(void) {
+    return TIM3->SR;
+}
+
+/**
+ * @brief Giá trị đã bắt của quạt `fan` (đọc CCRx cũng xóa CCxIF)
+ */
+static inline uint16_t HW_TACH_Capture(uint8_t fan) {
+    return (uint16_t)(&TIM3->CCR1)[fan];
+}
+
+static inline uint16_t HW_TACH_Count(void) {
+    return (uint16_t)TIM3->CNT;
+}
+
+static inline void HW_TACH_Clear(uint32_t flags) {
+    TIM3->SR = ~flags;                    // rc_w0: chỉ xóa các cờ được chỉ định
+}
+
+
+// =======================================
+// ===== ADC1 + DMA2 (PA0, PA4, cảm biến nhiệt, VREFINT) ==
+// =======================================
+
+/**
+ * @brief Khởi tạo ADC1 quét liên tục 4 kênh, DMA2 Stream0 ghi vòng tròn vào `buf`
+ * @param buf Bộ đệm `count` ô 16-bit, mỗi vòng quét ghi 4 ô theo thứ tự SQ1..SQ4:
+ *            biến trở PA0 (ADC_IN0), NTC PA4 (ADC_IN4), cảm biến nhiệt (ADC_IN18), VREFINT (ADC_IN17)
+ * @param count Số ô, bội của 8 (ngắt ở nửa bộ đệm và cuối bộ đệm)
+ *
+ * Cảm biến bên trong cần thời gian lấy mẫu ≥ 10 µs: 480 chu kỳ ADCCLK (8 MHz) = 60 µs.
+ * CPU không phải khởi động hay chờ chuyển đổi nào: chỉ xử lý ngắt DMA.
+ */
+static inline void HW_ADC_Init(volatile uint16_t* buf, uint16_t count) {
+    // Bật clock cho ADC1 (bit 8 của RCC->APB2ENR)
+    RCC->APB2ENR |= (1 << 8); // ADC1EN
+
+    // Bật clock cho GPIOA (bit 0) và DMA2 (bit 22) của RCC->AHB1ENR
+    RCC->AHB1ENR |= (1 << 0) | (1 << 22); // GPIOAEN, DMA2EN
+
+    // PA0 và PA4 vào chế độ analog: MODER = 11
+    GPIOA->MODER |= (3 << (0 * 2)) | (3 << (4 * 2));
+
+    // Cài đặt thời gian lấy mẫu cho kênh 0 và 4 (SMPR2), kênh 17 và 18 (SMPR1): 480 chu kỳ
+    ADC1->SMPR2 |= (7 << 0) | (7 << 12);  // SMP0 = SMP4 = 111
+    ADC1->SMPR1 |= (7 << 21) | (7 << 24); // SMP17 = SMP18 = 111
+
+    // Nhóm regular 4 kênh (L = 0011)
+    ADC1->SQR1 = (3 << 20);               // L = 3: 4 lần chuyển đổi
+    ADC1->SQR3 = (0 << 0)                 // SQ1 = IN0 (biến trở)
+               | (4 << 5)                 // SQ2 = IN4 (NTC)
+               | (18 << 10)               // SQ3 = IN18 (cảm biến nhiệt)
+               | (17 << 15);              // SQ4 = IN17 (VREFINT)
+
+    // Bật cảm biến nhiệt và VREFINT (TSVREFE), VBATE phải để 0 vì dùng chung IN18
+    ADC->CCR = (ADC->CCR & ~(1u << 22)) | (1u << 23);
+
+    // Analog watchdog chỉ trên kênh biến trở, cửa sổ mở hết cho tới khi HW_ADC_WatchdogArm
+    ADC1->LTR = 0;
+    ADC1->HTR = 0xFFF;
+
+    // Chế độ quét, ngắt khi tràn (DMA không kịp đọc DR); analog watchdog bật nhưng chưa ngắt
+    ADC1->CR1 = (1 << 8)                  // SCAN = 1
+              | (1 << 9)                  // AWDSGL = 1: chỉ kênh AWDCH
+              | (0 << 0)                  // AWDCH = 0: IN0 (biến trở)
+              | (1 << 23)                 // AWDEN = 1: nhóm regular
+              | (1 << 26);                // OVRIE = 1
+
+    // Bật ADC1 trước (cần tSTAB ≈ 3 µs, phần cấu hình DMA dưới đây đủ lâu)
+    ADC1->CR2 = (1 << 0);                 // ADON = 1
+
+    // DMA2 Stream0 kênh 0 (ADC1): ngoại vi → bộ nhớ, 16-bit, vòng tròn
+    DMA2_Stream0->CR = 0;
+    while (DMA2_Stream0->CR & 1u);        // Chờ stream dừng hẳn
+    DMA2->LIFCR = 0x3Du;                  // Xóa mọi cờ của stream 0
+    DMA2_Stream0->PAR = (uint32_t)(uintptr_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)(uintptr_t)buf;
+    DMA2_Stream0->NDTR = count;
+    DMA2_Stream0->CR = (0 << 25)          // CHSEL = 0: ADC1
+                     | (1 << 13)          // MSIZE = 16 bit
+                     | (1 << 11)          // PSIZE = 16 bit
+                     | (1 << 10)          // MINC = 1
+                     | (1 << 8)           // CIRC = 1
+                     | (1 << 4)           // TCIE = 1
+                     | (1 << 3);          // HTIE = 1
+    DMA2_Stream0->CR |= (1 << 0);         // EN = 1
+
+    // Cùng mức với vòng điều khiển: không ngắt nhau, nên vòng điều khiển luôn đọc
+    // bộ giá trị của cùng 1 khối mẫu
+    NVIC_SetPriority(DMA2_Stream0_IRQn, 1);
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    NVIC_SetPriority(ADC_IRQn, 1);
+    NVIC_EnableIRQ(ADC_IRQn);
+
+    // Chuyển đổi liên tục, mỗi kết quả gửi 1 yêu cầu DMA (DDS: không dừng sau vòng DMA đầu)
+    ADC1->CR2 |= (1 << 1)                 // CONT = 1
+               | (1 << 8)                 // DMA = 1
+               | (1 << 9);                // DDS = 1
+    ADC1->CR2 |= (1 << 30);               // SWSTART = 1
+}
+
+/**
+ * @brief Cờ HW_ADC_DMA_HALF / HW_ADC_DMA_FULL đang bật
+ */
+static inline uint32_t HW_ADC_DmaFlags(void) {
+    return (DMA2->LISR >> 4) & 3u;        // HTIF0 (bit 4), TCIF0 (bit 5)
+}
+
+static inline void HW_ADC_DmaClear(uint32_t flags) {
+    DMA2->LIFCR = (flags & 3u) << 4;      // CHTIF0, CTCIF0
+}
+
+static inline uint8_t HW_ADC_Overrun(void) {
+    return (ADC1->SR & (1 << 5)) != 0;    // OVR = 1
+}
+
+/**
+ * @brief Ngắt khi 1 mẫu biến trở (12-bit, thô) ra ngoài [low, high]
+ *
+ * Xóa cờ AWD trước khi bật ngắt: cờ có thể đã bật từ lúc chưa bật ngắt; nếu có mẫu
+ * ra ngoài cửa sổ mới ngay trong lúc này thì cờ bật lại và ngắt chạy ngay.
+ */
+static inline void HW_ADC_WatchdogArm(uint16_t low, uint16_t high) {
+    ADC1->LTR = low;
+    ADC1->HTR = high;
+    ADC1->SR = ~(1u << 0);                // rc_w0: xóa AWD
+    ADC1->CR1 |= (1 << 6);                // AWDIE = 1
+}
+
+/**
+ * @brief Tắt ngắt analog watchdog (mọi mẫu ngoài cửa sổ đều bật cờ AWD, 1 lần là đủ)
+ */
+static inline void HW_ADC_WatchdogDisarm(void) {
+    ADC1->CR1 &= ~(1u << 6);              // AWDIE = 0
+    ADC1->SR = ~(1u << 0);                // rc_w0: xóa AWD
+}
+
+static inline uint8_t HW_ADC_WatchdogFired(void) {
+    return (ADC1->SR & (1 << 0)) && (ADC1->CR1 & (1 << 6));   // AWD = 1 và AWDIE = 1
+}
+
+/**
+ * @brief Khởi động lại vòng quét sau khi tràn: DMA đã dừng và không còn biết kết quả
+ *        kế tiếp thuộc kênh nào, nên ghi lại từ đầu bộ đệm `count` ô, bắt đầu từ SQ1
+ */
+static inline void HW_ADC_Restart(uint16_t count) {
+    ADC1->CR2 &= ~(1u << 8);              // DMA = 0
+    DMA2_Stream0->CR &= ~1u;              // EN = 0
+    while (DMA2_Stream0->CR & 1u);
+    DMA2->LIFCR = 0x3Du;
+    DMA2_Stream0->NDTR = count;
+    ADC1->SR = ~(1u << 5);                // rc_w0: xóa OVR
+    DMA2_Stream0->CR |= (1 << 0);         // EN = 1
+    ADC1->CR2 |= (1 << 8);                // DMA = 1
+    ADC1->CR2 |= (1 << 30);               // SWSTART = 1
+}
+
+// Giá trị hiệu chuẩn cảm biến nhiệt ghi trong ROM hệ thống lúc sản xuất (VDDA = 3,3 V)
+static inline uint16_t HW_TS_Cal30(void) {
+    return *(const volatile uint16_t*)0x1FFF7A2Cu;   // TS_CAL1: 30 °C
+}
+
+static inline uint16_t HW_TS_Cal110(void) {
+    return *(const volatile uint16_t*)0x1FFF7A2Eu;   // TS_CAL2: 110 °C
+}
+
+static inline uint16_t HW_VREFINT_Cal(void) {
+    return *(const volatile uint16_t*)0x1FFF7A2Au;   // VREFINT_CAL: 30 °C, VDDA = 3,3 V
+}
+
+
+// =======================================
+// ======== I2C1 (PB8 SCL, PB9 SDA) ======
+// =======================================
+
+/**
+ * @brief Khởi tạo I2C1 ở chế độ chuẩn (Standard mode - 100kHz)
+ */
+static inline void HW_I2C1_Init(void) {
+    // Bật clock cho GPIOB (chân PB8, PB9 dùng cho I2C)
+    RCC->AHB1ENR |= (1 << 1);  // GPIOBEN = 1
+
+    // Bật clock cho I2C1 (trên bus APB1)
+    RCC->APB1ENR |= (1 << 21); // I2C1EN = 1
+
+    // Đặt chế độ Alternate Function (AF) cho PB8 và PB9
+    GPIOB->MODER &= ~(0xF << (8 * 2));        // Clear MODER8 & MODER9
+    GPIOB->MODER |=  (0xA << (8 * 2));        // MODER = 10 (AF mode)
+
+    // Đặt kiểu output là Open-Drain (bắt buộc với I2C)
+    GPIOB->OTYPER |= (0x3 << 8);              // OTYPER8 & 9 = 1
+
+    // Đặt tốc độ rất cao cho hai chân này
+    GPIOB->OSPEEDR |= (0xF << (8 * 2));       // OSPEEDR = 11 (very high speed)
+
+    // Kích hoạt Pull-up nội để tránh trạng thái floating
+    GPIOB->PUPDR |= (0x5 << (8 * 2));         // PUPDR = 01 (pull-up)
+
+    // Gán AF4 (I2C1) cho PB8 và PB9
+    GPIOB->AFR[1] |= (0x44 << 0);             // PB8/9 → AF4 (I2C1)
+
+    // Tắt I2C trước khi cấu hình (PE = 0)
+    I2C1->CR1 &= ~(1 << 0);  // Disable I2C1
+
+    // Thiết lập CR2 = tốc độ bus APB1 (ở đây giả định = 16MHz)
+    I2C1->CR2 = 16;
+
+    // Cấu hình tốc độ chuẩn 100kHz (Standard Mode)
+    I2C1->CCR = 80; // CCR = Fpclk / (2 * I2C_speed) = 16MHz / (2*100kHz) = 80
+
+    // Thiết lập TRISE = Fpclk + 1 (theo datasheet)
+    I2C1->TRISE = 17;
+
+    // Bật lại I2C1 (PE = 1)
+    I2C1->CR1 |= (1 << 0);  // Enable I2C1
+}
+
+static inline void HW_I2C1_Start(void) {
+    I2C1->CR1 |= (1 << 8);   // START
+}
+
+static inline void HW_I2C1_Stop(void) {
+    I2C1->CR1 |= (1 << 9);   // STOP
+}
+
+static inline uint32_t HW_I2C1_Status(void) {
+    return I2C1->SR1;
+}
+
+static inline void HW_I2C1_ClearAddr(void) {
+    (void)I2C1->SR2;         // Đọc SR1 rồi SR2 để xóa cờ ADDR
+}
+
+static inline void HW_I2C1_Write(uint8_t data) {
+    I2C1->DR = data;
+}
+
+
+// =======================================
+// ===== EXTI (PA6, PA7, PB0, PB1) =======
+// =======================================
+
+/**
+ * @brief Cấu hình PA6, PA7, PB0, PB1 làm input pull-up, ngắt cạnh xuống
+ */
+static inline void HW_EXTI_Init(void) {
+    // Bật clock cho GPIOA và GPIOB
+    RCC->AHB1ENR |= (1 << 0) | (1 << 1);  // GPIOAEN, GPIOBEN
+
+    // Bật clock cho SYSCFG để cấu hình EXTI
+    RCC->APB2ENR |= (1 << 14);  // SYSCFGEN
+
+    // Thiết lập các chân PA6, PA7, PB0, PB1 là input (MODER = 00)
+    GPIOA->MODER &= ~((3 << (6 * 2)) | (3 << (7 * 2)));
+    GPIOB->MODER &= ~((3 << (0 * 2)) | (3 << (1 * 2)));
+
+    // Kích hoạt điện trở kéo lên (pull-up)
+    GPIOA->PUPDR |= (1 << (6 * 2)) | (1 << (7 * 2));
+    GPIOB->PUPDR |= (1 << (0 * 2)) | (1 << (1 * 2));
+
+    // Gán EXTI dòng 6, 7 cho chân PA6, PA7 (EXTICR[1])
+    SYSCFG->EXTICR[1] &= ~((0xF << 8) | (0xF << 12));  // PA = 0000
+
+    // Gán EXTI dòng 0, 1 cho chân PB0, PB1 (EXTICR[0])
+    SYSCFG->EXTICR[0] &= ~((0xF << 0) | (0xF << 4));
+    SYSCFG->EXTICR[0] |= (1 << 0) | (1 << 4);          // PB = 0001
+
+    // Cho phép ngắt từ EXTI dòng 0,1,6,7
+    EXTI->IMR |= HW_EXTI_PB0 | HW_EXTI_PB1 | HW_EXTI_PA6 | HW_EXTI_PA7;
+
+    // Kích hoạt ngắt cạnh xuống (falling edge)
+    EXTI->FTSR |= HW_EXTI_PB0 | HW_EXTI_PB1 | HW_EXTI_PA6 | HW_EXTI_PA7;
+
+    // Kích hoạt ngắt trong NVIC
+    NVIC_EnableIRQ(EXTI9_5_IRQn);  // PA6, PA7
+    NVIC_EnableIRQ(EXTI0_IRQn);    // PB0
+    NVIC_EnableIRQ(EXTI1_IRQn);    // PB1
+
+    // Thiết lập mức ưu tiên ngắt: cùng 1 mức để các ISR nút nhấn không ngắt lẫn
+    // nhau → hàng đợi sự kiện chỉ có 1 producer (xem evq.c)
+    NVIC_SetPriority(EXTI9_5_IRQn, 2);
+    NVIC_SetPriority(EXTI0_IRQn, 2);
+    NVIC_SetPriority(EXTI1_IRQn, 2);
+}
+
+static inline uint32_t HW_EXTI_Pending(uint32_t lines) {
+    return EXTI->PR & lines;
+}
+
+static inline void HW_EXTI_Clear(uint32_t lines) {
+    EXTI->PR = lines;        // Ghi 1 để xóa, chỉ các đường được chỉ định
+}
+
+static inline void HW_EXTI_Enable(uint32_t lines) {
+    EXTI->IMR |= lines;
+}
+
+static inline void HW_EXTI_Disable(uint32_t lines) {
+    EXTI->IMR &= ~lines;
+}
+
+
+// =======================================
+// ======= RTC (LSE 32.768 kHz) ==========
+// =======================================
+
+/**
+ * @brief Khởi tạo RTC làm đồng hồ khi CPU ở Stop mode
+ *        - Nguồn: LSE 32.768 kHz (thạch anh X2), chính xác hơn nhiều so với LSI
+ *        - PREDIV_A = 7 → ck_apre = 4096 Hz (bộ đếm SSR), PREDIV_S = 4095 → 1 Hz
+ *        - Wakeup timer: RTC/16 = 2048 Hz, ngắt qua EXTI line 22
+ */
+static inline void HW_RTC_Init(void) {
+    // Cho phép ghi vào vùng backup (RCC_BDCR và các thanh ghi RTC)
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    PWR->CR |= PWR_CR_DBP;
+
+    // Bật LSE và chọn làm clock RTC (chỉ làm 1 lần, vùng backup giữ qua reset)
+    if (!(RCC->BDCR & RCC_BDCR_RTCEN)) {
+        RCC->BDCR |= RCC_BDCR_LSEON;
+        while (!(RCC->BDCR & RCC_BDCR_LSERDY));
+        RCC->BDCR |= RCC_BDCR_RTCSEL_0;   // RTCSEL = 01: LSE
+        RCC->BDCR |= RCC_BDCR_RTCEN;
+    }
+
+    // Mở khóa ghi thanh ghi RTC
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+
+    // Cấu hình bộ chia trong chế độ INIT (ghi PREDIV_S trước, PREDIV_A sau)
+    RTC->ISR |= RTC_ISR_INIT;
+    while (!(RTC->ISR & RTC_ISR_INITF));
+    RTC->PRER = 4095;
+    RTC->PRER |= (7 << 16);
+    RTC->ISR &= ~RTC_ISR_INIT;
+
+    // Wakeup timer: tắt để cấu hình, WUCKSEL = 000 (RTC/16), bật ngắt
+    RTC->CR &= ~RTC_CR_WUTE;
+    while (!(RTC->ISR & RTC_ISR_WUTWF));
+    RTC->CR &= ~RTC_CR_WUCKSEL;
+    RTC->CR |= RTC_CR_WUTIE;
+
+    RTC->WPR = 0xFF;                      // Khóa lại
+
+    // Ngắt wakeup đi qua EXTI line 22, cạnh lên
+    EXTI->IMR |= (1 << 22);
+    EXTI->RTSR |= (1 << 22);
+    NVIC_EnableIRQ(RTC_WKUP_IRQn);
+}
+
+
+/**
+ * @brief Thời điểm hiện tại của RTC, đơn vị 1/HW_RTC_HZ giây, quay vòng sau HW_RTC_WRAP
+ */
+static inline uint32_t HW_RTC_Now(void) {
+    uint32_t ssr = RTC->SSR;   // Đọc SSR khóa TR/DR tới khi đọc DR → giá trị nhất quán
+    uint32_t tr = RTC->TR;
+    uint32_t sec;
+
+    (void)RTC->DR;
+
+    // TR ở dạng BCD 24h: HT[21:20] HU[19:16] MNT[14:12] MNU[11:8] ST[6:4] SU[3:0]
+    sec = (((tr >> 20) & 0x3) * 10 + ((tr >> 16) & 0xF)) * 3600 +
+          (((tr >> 12) & 0x7) * 10 + ((tr >> 8) & 0xF)) * 60 +
+          (((tr >> 4) & 0x7) * 10 + (tr & 0xF));
+
+    // SSR đếm lùi từ PREDIV_S về 0 trong mỗi giây
+    return sec * HW_RTC_HZ + (HW_RTC_HZ - 1 - ssr);
+}
+
+
+/**
+ * @brief Hẹn ngắt wakeup sau `ticks` chu kỳ 1/HW_RTC_WUT_HZ giây (1..HW_RTC_WUT_MAX)
+ */
+static inline void HW_RTC_WakeupStart(uint32_t ticks) {
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+
+    RTC->CR &= ~RTC_CR_WUTE;
+    while (!(RTC->ISR & RTC_ISR_WUTWF));
+    RTC->WUTR = ticks - 1;
+    RTC->ISR = ~(RTC_ISR_WUTF | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);  // Xóa WUTF (ghi 0)
+    EXTI->PR = (1 << 22);
+    RTC->CR |= RTC_CR_WUTE;
+
+    RTC->WPR = 0xFF;
+}
+
+
+/**
+ * @brief Xóa cờ ngắt wakeup (gọi trong RTC_WKUP_IRQHandler)
+ */
+static inline void HW_RTC_WakeupClear(void) {
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+    RTC->ISR = ~(RTC_ISR_WUTF | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+    RTC->WPR = 0xFF;
+    EXTI->PR = (1 << 22);
+}
+
+
+/**
+ * @brief Tắt wakeup timer (khi đã thức dậy sớm hơn hẹn, ví dụ do nút nhấn)
+ */
+static inline void HW_RTC_WakeupStop(void) {
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+    RTC->CR &= ~RTC_CR_WUTE;
+    RTC->WPR = 0xFF;
+    HW_RTC_WakeupClear();
+}
+
+
+// =======================================
+// ====== IWDG / nguyên nhân reset =======
+// =======================================
+
+/**
+ * @brief Bật independent watchdog (LSI ~32 kHz): timeout = 4·2^pr · (rlr + 1) / f_LSI.
+ *        Không tắt được cho tới lần reset kế tiếp; đứng yên khi core dừng ở breakpoint.
+ */
+static inline void HW_IWDG_Init(uint8_t pr, uint16_t rlr) {
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;  // Không reset khi đang debug
+
+    IWDG->KR = 0xCCCC;                    // Bật IWDG (tự bật LSI)
+    IWDG->KR = 0x5555;                    // Mở khóa ghi PR/RLR
+    IWDG->PR = pr;
+    IWDG->RLR = rlr;
+    while (IWDG->SR & (IWDG_SR_PVU | IWDG_SR_RVU));  // Chờ giá trị mới được nạp vào miền LSI
+    IWDG->KR = 0xAAAA;                    // Nạp lại bộ đếm với RLR mới
+}
+
+static inline void HW_IWDG_Feed(void) {
+    IWDG->KR = 0xAAAA;
+}
+
+
+/**
+ * @brief Nguyên nhân reset (cờ HW_RESET_*), rồi xóa cờ trong RCC_CSR cho lần sau
+ */
+static inline uint8_t HW_ResetCause(void) {
+    uint32_t csr = RCC->CSR;
+    uint8_t cause = 0;
+
+    if (csr & RCC_CSR_PINRSTF)  cause |= HW_RESET_PIN;
+    if (csr & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF)) cause |= HW_RESET_POWER;
+    if (csr & RCC_CSR_SFTRSTF)  cause |= HW_RESET_SOFT;
+    if (csr & RCC_CSR_IWDGRSTF) cause |= HW_RESET_IWDG;
+    if (csr & RCC_CSR_WWDGRSTF) cause |= HW_RESET_WWDG;
+    if (csr & RCC_CSR_LPWRRSTF) cause |= HW_RESET_LPWR;
+
+    RCC->CSR |= RCC_CSR_RMVF;
+    return cause;
+}
+
+
+/**
+ * @brief Thanh ghi backup RTC_BKPxR (0..19): giữ nguyên qua reset, chỉ mất khi mất cả VDD và VBAT
+ */
+static inline uint32_t HW_Backup_Read(uint8_t idx) {
+    return (&RTC->BKP0R)[idx];
+}
+
+static inline void HW_Backup_Write(uint8_t idx, uint32_t value) {
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;    // Có thể gọi trước RTC_Init
+    PWR->CR |= PWR_CR_DBP;                // Cho phép ghi vùng backup
+    (&RTC->BKP0R)[idx] = value;
+}
+
+#endif
@@ -3,12 +3,18 @@
 #define OLED_H
 
 #include <stdint.h>
+#include "cpuload.h"   // CpuLoad_Stats
 
 uint8_t SSD1306_Init(void);
-void SSD1306_SetCursor(uint8_t col, uint8_t page);
-void SSD1306_Clear(void);
-void SSD1306_PrintChar(char ch);
-void SSD1306_PrintTextCentered(uint8_t page, const char* str);
-void SSD1306_DisplayStatus(uint8_t current_mode, uint8_t seconds_left);
+uint8_t SSD1306_SetCursor(uint8_t col, uint8_t page);
+uint8_t SSD1306_Clear(void);
+uint8_t SSD1306_PrintChar(char ch);
+uint8_t SSD1306_PrintTextCentered(uint8_t page, const char* str);
+uint8_t SSD1306_DisplayStatus(uint8_t current_mode, uint8_t seconds_left);
+uint8_t SSD1306_DisplayState(uint8_t state, uint8_t current_mode, uint8_t seconds_left);
+uint8_t SSD1306_DisplayRpm(uint32_t rpm, uint32_t target);
+uint8_t SSD1306_DisplayTemp(uint8_t page, int16_t ntc_dc, int16_t die_dc, uint8_t automatic);
+uint8_t SSD1306_DisplayFans(const uint16_t* permille, const uint16_t* rpm, uint8_t tach_mask, uint8_t count);
+uint8_t SSD1306_DisplayCpuLoad(const CpuLoad_Stats* load);
 
 #endif
@@ -0,0 +1,40 @@
+// ====== pid.h ======
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+/**
+ * @brief Thông số chỉnh PID (số cố định Q16.16, không dùng float)
+ *
+ * Đầu ra là duty Q16 (65536 = 100 %), sai số tính bằng RPM. Ví dụ kp = 40 << 16
+ * (CONTROL_CONFIG_DEFAULT) nghĩa là mỗi 1 RPM sai số thêm 40/65536 ≈ 0,061 % duty.
+ */
+typedef struct {
+    int32_t kp;          // Q16: duty Q16 / RPM
+    int32_t ki;          // Q16: duty Q16 / (RPM · s)
+    int32_t kd;          // Q16: duty Q16 · s / RPM (đạo hàm theo giá trị đo, không theo setpoint)
+    uint32_t slew;       // Tốc độ thay đổi đầu ra tối đa, duty Q16 / s (0: không giới hạn)
+    uint32_t out_max;    // Duty Q16 tối đa (≤ 65536)
+} Pid_Tuning;
+
+/**
+ * @brief Trạng thái 1 bộ PID chạy với chu kỳ cố định
+ */
+typedef struct {
+    int32_t kp;          // Q16, như Pid_Tuning
+    int32_t ki_step;     // Q16: ki / tần số
+    int32_t kd_step;     // Q16: kd · tần số (bão hòa ở INT32_MAX)
+    int32_t slew_step;   // Duty Q16 mỗi lần chạy (65536: không giới hạn)
+    int32_t out_max;
+    int64_t integ;       // Tích phân, duty Q32 (duty Q16 << 16), luôn trong [0, out_max]
+    int32_t prev_meas;
+    int32_t out;         // Đầu ra lần trước (duty Q16)
+    uint8_t primed;      // Đã chạy ít nhất 1 bước kể từ Pid_Reset (có prev_meas)
+} Pid;
+
+void Pid_Init(Pid* pid, const Pid_Tuning* tuning, uint32_t rate_hz);
+void Pid_Reset(Pid* pid, int32_t out);
+int32_t Pid_Step(Pid* pid, int32_t setpoint, int32_t meas);
+
+#endif
@@ -4,7 +4,69 @@
 
 #include <stdint.h>
 
+// Tần số PWM mặc định: chuẩn quạt 4 dây (Intel) cho phép 21–28 kHz, ngoài vùng nghe thấy
+#define PWM_FREQ_HZ     25000u
+
+// Số tick tối đa của 1 chu kỳ (ARR + 1): CCR 16-bit phải ghi được ARR + 1 để có 100%
+#define PWM_PERIOD_MAX  65535u
+
+// Số bước ramp mỗi giây mặc định (PWM_RampStep gọi từ vòng điều khiển 1 kHz)
+#define PWM_RAMP_STEP_HZ  1000u
+
+/**
+ * @brief Loại chuyển duty, mỗi loại có 1 profile ramp riêng
+ */
+typedef enum {
+    PWM_RAMP_START = 0,   // Từ 0% (quạt đang tắt): khởi động mềm, tránh dòng khởi động
+    PWM_RAMP_UP,          // Tăng duty khi quạt đang chạy
+    PWM_RAMP_DOWN,        // Giảm duty (vẫn > 0%)
+    PWM_RAMP_STOP,        // Về 0%
+    PWM_RAMP_KIND_COUNT
+} Pwm_RampKind;
+
+/**
+ * @brief Dạng đường ramp theo tiến độ t ∈ [0, 1]
+ */
+typedef enum {
+    PWM_SHAPE_LINEAR = 0, // t
+    PWM_SHAPE_EASE_IN,    // t²: đầu ramp rất chậm
+    PWM_SHAPE_SCURVE,     // 3t² − 2t³: chậm ở 2 đầu, không giật
+    PWM_SHAPE_COUNT
+} Pwm_RampShape;
+
+/**
+ * @brief Profile ramp của 1 loại chuyển (dùng chung cho mọi quạt, trạng thái ramp riêng)
+ */
+typedef struct {
+    uint16_t full_ms;      // Thời gian cho thay đổi 0% ↔ 100% (bước nhỏ hơn: tỉ lệ theo), 0: tức thời
+    uint8_t shape;         // Pwm_RampShape
+} Pwm_Ramp;
+
+/**
+ * @brief Cấu hình TIM4 cho 1 tần số PWM (mọi quạt cùng tần số)
+ */
+typedef struct {
+    uint16_t psc;          // Giá trị thanh ghi PSC
+    uint16_t arr;          // Giá trị thanh ghi ARR (số mức duty = ARR + 1)
+    uint32_t freq_hz;      // Tần số thực = clock / ((PSC + 1) · (ARR + 1)), làm tròn
+} Pwm_Timing;
+
+extern Pwm_Timing pwm_timing;   // Cấu hình đang dùng
+extern Pwm_Ramp pwm_ramps[PWM_RAMP_KIND_COUNT];
+
+uint8_t PWM_Solve(uint32_t timer_hz, uint32_t target_hz, Pwm_Timing* out);
 void PWM_Init(void);
+uint8_t PWM_Config(uint32_t freq_hz);
+void PWM_SetPermille(uint8_t fan, uint16_t permille);
+void PWM_SetQ16(uint8_t fan, uint32_t duty_q16);
+uint16_t PWM_GetPermille(uint8_t fan);
 void Update_PWM_From_Mode(uint8_t mode);
+uint8_t PWM_IsIdle(void);
+void PWM_SetRampRate(uint32_t step_hz);
+uint8_t PWM_SetRamp(uint8_t kind, uint16_t full_ms, uint8_t shape);
+void PWM_RampTo(uint8_t fan, uint32_t duty_q16);
+void PWM_RampToMode(uint8_t fan, uint8_t mode);
+void PWM_RampStep(void);
+uint8_t PWM_RampActive(void);
 
 #endif
@@ -0,0 +1,69 @@
+// ====== sched.h ======
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS  8
+
+// Histogram độ trễ: ô 0 = trễ 0 µs, ô k = [2^(k-1), 2^k) µs, ô cuối gom mọi giá trị
+// từ 2^(SCHED_HIST_BUCKETS-2) µs (~262 ms) trở lên
+#define SCHED_HIST_BUCKETS  20
+#define SCHED_JITTER_MAGIC  0x5454494Au   // "JITT" – nhận dạng khối khi đọc từ bộ nhớ
+#define SCHED_NAME_LEN      12
+
+typedef void (*Sched_TaskFn)(void);
+
+/**
+ * @brief Một tác vụ trong bộ lập lịch hợp tác (cooperative)
+ */
+typedef struct {
+    const char* name;       // Tên hiển thị trong thống kê
+    Sched_TaskFn fn;        // Hàm thực thi, phải chạy xong rồi trả về
+    uint32_t period;        // Chu kỳ (µs), 0 = chạy 1 lần
+    uint64_t deadline;      // Thời điểm đến hạn kế tiếp (GetTimeUs64, luôn trên biên ms)
+    uint8_t active;
+    uint8_t forced;         // Lượt kế tiếp do Sched_RunNow gọi, không có deadline danh nghĩa
+
+    // ======== Thống kê (µs) ========
+    uint32_t runs;          // Số lần đã chạy
+    uint32_t run_max;       // Thời gian chạy lâu nhất
+    uint64_t run_total;     // Tổng thời gian chạy
+    uint32_t late_max;      // Độ trễ lớn nhất so với deadline
+    uint64_t late_total;    // Tổng độ trễ
+    uint32_t skipped;       // Số chu kỳ bị bỏ qua do trễ quá 1 chu kỳ
+    uint32_t forced_runs;   // Số lần chạy do Sched_RunNow (không tính vào độ trễ)
+} Sched_Task;
+
+/**
+ * @brief Độ trễ của 1 tác vụ định kỳ so với deadline danh nghĩa
+ *
+ * Toàn bộ là uint32_t/char nên bố cục giống hệt nhau trên ARM và host: công cụ
+ * jitter_dump đọc được trực tiếp bản dump bộ nhớ của `sched_jitter` từ debugger.
+ */
+typedef struct {
+    char name[SCHED_NAME_LEN];          // Tên tác vụ (cắt bớt, có thể không kết thúc bằng 0)
+    uint32_t period;                    // Chu kỳ (µs), 0 = ô trống
+    uint32_t samples;                   // Số lần chạy đã ghi nhận (không tính lần chạy ép)
+    uint32_t forced;                    // Số lần chạy ép bằng Sched_RunNow
+    uint32_t late_max;                  // Độ trễ lớn nhất (µs)
+    uint32_t hist[SCHED_HIST_BUCKETS];  // Số lần chạy theo từng khoảng độ trễ
+} Sched_Jitter;
+
+typedef struct {
+    uint32_t magic;                     // SCHED_JITTER_MAGIC
+    uint32_t slots;                     // SCHED_MAX_TASKS
+    Sched_Jitter job[SCHED_MAX_TASKS];  // Theo ID tác vụ
+} Sched_JitterLog;
+
+extern Sched_JitterLog sched_jitter;
+
+int8_t Sched_AddPeriodic(const char* name, Sched_TaskFn fn, uint32_t period, uint32_t first_delay);
+int8_t Sched_AddOneShot(const char* name, Sched_TaskFn fn, uint32_t delay);
+void Sched_Cancel(int8_t id);
+void Sched_RunNow(int8_t id);
+uint8_t Sched_RunNext(void);
+uint8_t Sched_NextDeadline(uint64_t* deadline);
+const Sched_Task* Sched_GetTask(int8_t id);
+
+#endif
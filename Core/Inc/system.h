@@ -4,11 +4,33 @@
 
 #include <stdint.h>
 
+// Sự kiện đánh thức vòng lặp chính (ISR gọi System_PostEvent)
+#define EVT_BUTTON   (1u << 0)   // Có nút nhấn: thức dậy để vòng điều khiển kịp chạy (TIM5 dừng trong Stop)
+#define EVT_UI       (1u << 1)   // Vòng điều khiển đổi trạng thái do nút nhấn: vẽ lại OLED ngay
+
+/**
+ * @brief Thống kê thời gian CPU ngủ trong Sleep_Until
+ */
+typedef struct {
+    uint32_t sleeps;            // Số lần vào WFI
+    uint64_t idle_cycles;       // Tổng số chu kỳ CPU ngủ
+    uint32_t wake_latency_max;  // Chu kỳ lớn nhất từ lúc SysTick tràn tới khi CPU chạy lại
+    uint32_t stops;             // Số lần vào Stop mode (SysTick tắt)
+    uint64_t stop_cycles;       // Tổng thời gian trong Stop, quy ra chu kỳ CPU (đo bằng RTC)
+} System_IdleStats;
+
 extern volatile uint32_t system_tick;
+extern System_IdleStats idle_stats;
 
 void SysTick_Init(void);
 void SysTick_Handler(void);
+void RTC_Init(void);
+void RTC_WKUP_IRQHandler(void);
 void Delay_ms(uint32_t ms);
+void Sleep_Until(uint64_t deadline, uint8_t allow_stop);
+void System_PostEvent(uint32_t events);
+uint32_t System_TakeEvents(void);
 uint32_t GetTick(void);
+uint64_t GetTimeUs64(void);
 
 #endif
@@ -0,0 +1,55 @@
+// ====== tach.h ======
+#ifndef TACH_H
+#define TACH_H
+
+#include <stdint.h>
+#include "hw.h"          // HW_FAN_COUNT
+
+// TIM3 đếm 1 MHz: chu kỳ tach đo chính xác tới 1 µs
+#define TACH_TICK_HZ         1000000u
+
+// Quạt có dây tach (bit i: quạt i). Quạt 2 dây không có: bỏ bit, kênh TIM3 để tắt,
+// Tach_GetRpm luôn 0 và trang quạt hiện "NO TACH"
+#ifndef TACH_FAN_MASK
+#define TACH_FAN_MASK        ((1u << HW_FAN_COUNT) - 1)
+#endif
+
+// Số xung tach mỗi vòng quay mặc định (quạt 3/4 dây chuẩn: 2)
+#define TACH_PPR_DEFAULT     2u
+
+// Bắt 1 lần mỗi 2^TACH_EDGES_LOG2 cạnh (IC1PSC): tăng lên nếu quạt rất nhanh để ISR thưa hơn
+#define TACH_EDGES_LOG2      0u
+
+// Bộ lọc số IC1F = 15: lấy mẫu 16 MHz / 32, cần 8 mẫu giống nhau → bỏ gai < 16 µs
+#define TACH_IC_FILTER       15u
+
+// Không có cạnh nào trong bấy lâu (thời gian thức) → quạt đứng, 0 RPM
+// (2 xung/vòng: dưới 60 RPM coi như đứng)
+#define TACH_STALL_US        500000u
+
+// Số chu kỳ gần nhất lấy trung bình khi đổi ra RPM
+#define TACH_AVG             4u
+
+// Bộ đệm vòng chứa chu kỳ đo được (lũy thừa của 2, > TACH_AVG)
+#define TACH_RING_SIZE       8u
+
+/**
+ * @brief Thống kê tach, cộng chung mọi quạt (đọc bằng debugger hoặc chương trình giả lập)
+ */
+typedef struct {
+    uint32_t captures;       // Số lần bắt cạnh
+    uint32_t overcaptures;   // Số lần mất cạnh vì ISR chưa kịp đọc CCRx (chu kỳ đó bị bỏ)
+    uint32_t starts;         // Số lần quạt bắt đầu quay lại (cạnh đầu tiên sau khi đứng)
+    uint32_t stalls;         // Số lần quá TACH_STALL_US không có cạnh
+} Tach_Stats;
+
+extern Tach_Stats tach_stats;
+
+void Tach_Init(void);
+void Tach_SetPulsesPerRev(uint8_t ppr);
+void Tach_Restart(void);
+uint32_t Tach_GetRpm(uint8_t fan);
+uint8_t Tach_Present(uint8_t fan);
+void TIM3_IRQHandler(void);
+
+#endif
@@ -0,0 +1,79 @@
+// ====== temp.h ======
+#ifndef TEMP_H
+#define TEMP_H
+
+#include <stdint.h>
+#include "adc.h"       // ADC_BITS: độ phân giải sau oversampling
+
+// Nhiệt độ tính bằng 0,1 °C (int16_t, hậu tố _dc): 345 = 34,5 °C
+// Giá trị ADC đưa vào là ADC_BITS bit (khối oversampling của adc.c)
+
+// NTC 10 kΩ @ 25 °C, B = 3950, nối PA4 (ADC1_IN4) xuống GND; điện trở kéo lên
+// 10 kΩ tới VDDA. Bảng tra trong temp.c được tính sẵn từ các hằng số này
+// (curve_bench so lại với công thức Beta): đổi linh kiện thì phải tính lại bảng.
+#define TEMP_NTC_R25         10000u
+#define TEMP_NTC_BETA        3950u
+#define TEMP_NTC_R_FIXED     10000u
+
+// Bảng tra NTC: 1 ô mỗi 2^TEMP_NTC_LUT_SHIFT giá trị ADC (32 LSB ở thang 12-bit),
+// nội suy tuyến tính giữa 2 ô
+#define TEMP_NTC_LUT_SHIFT   (5u + ADC_BITS - 12u)
+
+// Ngoài dải này NTC coi như chập (nóng hơn ~160 °C) hoặc hở mạch (lạnh hơn ~−45 °C):
+// 64..4031 ở thang 12-bit
+#define TEMP_NTC_ADC_MIN     (64u << (ADC_BITS - 12))
+#define TEMP_NTC_ADC_MAX     ((4032u << (ADC_BITS - 12)) - 1)
+
+// Giá trị hiệu chuẩn cảm biến bên trong điển hình (V25 = 0,76 V, 2,5 mV/°C, VDDA = 3,3 V),
+// dùng khi ROM hệ thống không có giá trị hợp lệ
+#define TEMP_TS_CAL30_TYP    959u
+#define TEMP_TS_CAL110_TYP   1207u
+
+// VREFINT (1,21 V điển hình) đo ở VDDA = 3,3 V, dùng khi ROM không có giá trị hợp lệ.
+// Cảm biến bên trong cho điện áp tuyệt đối, nên giá trị ADC của nó được quy về
+// VDDA = 3,3 V (điều kiện hiệu chuẩn) theo tỉ số VREFINT_CAL / VREFINT đo được.
+#define TEMP_VREFINT_CAL_TYP 1502u
+#define TEMP_VREFINT_CAL_MIN 1400u
+#define TEMP_VREFINT_CAL_MAX 1600u
+
+// Không có cảm biến hợp lệ
+#define TEMP_INVALID         INT16_MIN
+
+// Trễ nhiệt: nhiệt độ giảm bấy nhiêu (0,1 °C) dưới mức cao nhất gần đây thì duty mới giảm theo
+#define TEMP_HYST_DC         20
+
+// Số điểm tối đa của đường cong nhiệt độ → duty (tìm tuần tự)
+#define TEMP_CURVE_MAX_POINTS 8u
+
+/**
+ * @brief 1 điểm của đường cong nhiệt độ → duty
+ */
+typedef struct {
+    int16_t temp_dc;       // Nhiệt độ (0,1 °C), tăng dần nghiêm ngặt
+    uint16_t permille;     // Duty tại điểm đó (0..1000 ‰)
+} Temp_CurvePoint;
+
+/**
+ * @brief Thống kê cảm biến nhiệt (đọc bằng debugger hoặc chương trình giả lập)
+ */
+typedef struct {
+    uint32_t samples;      // Số lần Temp_Update
+    uint32_t ntc_faults;   // Số mẫu NTC ngoài dải (chập/hở), khi đó dùng cảm biến bên trong
+    uint16_t ts_cal30;     // Giá trị hiệu chuẩn đang dùng
+    uint16_t ts_cal110;
+    uint16_t vrefint_cal;
+} Temp_Stats;
+
+extern Temp_Stats temp_stats;
+
+void Temp_Init(void);
+int16_t Temp_FromNtc(uint16_t adc);
+int16_t Temp_FromDie(uint16_t adc);
+uint8_t Temp_SetCurve(const Temp_CurvePoint* points, uint8_t count);
+void Temp_Update(uint16_t ntc_adc, uint16_t die_adc, uint16_t vref_adc);
+int16_t Temp_Ntc(void);
+int16_t Temp_Die(void);
+int16_t Temp_Control(void);
+uint32_t Temp_DutyQ16(void);
+
+#endif
@@ -0,0 +1,60 @@
+// ====== wdg.h ======
+#ifndef WDG_H
+#define WDG_H
+
+#include <stdint.h>
+
+/**
+ * @brief Các tác vụ phải báo còn sống (Wdg_CheckIn) trước deadline của mình
+ */
+typedef enum {
+    WDG_CONTROL = 0,      // Vòng điều khiển TIM5 (chỉ tính lần chạy có mẫu ADC mới)
+    WDG_INPUT,            // Xử lý hàng đợi nút nhấn
+    WDG_DISPLAY,          // Tác vụ vẽ OLED (kẹt bus I2C → quá hạn)
+    WDG_COUNT,
+    WDG_NONE = 0xFF
+} Wdg_Id;
+
+// Timeout IWDG: LSI ~32 kHz / 64 = 500 Hz, RLR = 999 → ~2 s (LSI 17–47 kHz: 1,4–3,8 s)
+#define WDG_IWDG_PRESCALER  4u        // PR = 4: chia 64
+#define WDG_IWDG_RELOAD     999u
+#define WDG_TIMEOUT_MS      2000u     // Giá trị danh nghĩa ứng với 2 hằng trên
+
+// IWDG vẫn chạy trong Stop mode nhưng không ai nạp lại: mỗi lần ngủ tối đa bấy nhiêu
+// (nhỏ hơn hẳn timeout ngắn nhất 1,4 s)
+#define WDG_SLEEP_MAX_US    1000000u
+
+// Thanh ghi backup RTC (giữ qua reset): nửa cao là WDG_BKP_MAGIC để nhận dạng
+//   WDG_BKP_STALL:  ghi ngay khi phát hiện tác vụ quá hạn ([7:0] = Wdg_Id)
+//   WDG_BKP_REPORT: ghi lúc khởi động, mô tả lần reset vừa rồi
+//                   ([15:8] = cờ HW_RESET_*, [7:0] = tác vụ bị treo hoặc WDG_NONE)
+#define WDG_BKP_REPORT      0u
+#define WDG_BKP_STALL       1u
+#define WDG_BKP_MAGIC       0x57440000u   // "WD"
+
+/**
+ * @brief Thống kê watchdog (đọc bằng debugger hoặc chương trình giả lập)
+ *
+ * Tuổi của 1 lần báo là số ms CPU thức kể từ lần báo trước: SysTick dừng trong
+ * Stop mode cùng với TIM5 và vòng lặp chính, nên ngủ sâu không làm tác vụ quá hạn.
+ */
+typedef struct {
+    uint8_t reset_cause;              // Cờ HW_RESET_* của lần reset vừa rồi
+    uint8_t iwdg_reset;               // 1: lần reset vừa rồi do IWDG
+    uint8_t last_stalled;             // Tác vụ bị treo gây ra lần reset đó (WDG_NONE: không rõ)
+    uint8_t stalled;                  // Tác vụ quá hạn trong lần chạy này (WDG_NONE: chưa có)
+    uint32_t feeds;                   // Số lần nạp lại IWDG
+    uint16_t deadline[WDG_COUNT];     // Deadline đã đăng ký (ms thức), 0 = không giám sát
+    uint16_t age_max[WDG_COUNT];      // Khoảng cách lớn nhất giữa 2 lần báo (ms thức)
+} Wdg_Stats;
+
+extern Wdg_Stats wdg_stats;
+
+void Wdg_Init(void);
+void Wdg_Register(uint8_t id, uint16_t deadline_ms);
+void Wdg_CheckIn(uint8_t id);
+void Wdg_Service(void);
+void Wdg_LimitSleep(uint64_t* deadline);
+const char* Wdg_Name(uint8_t id);
+
+#endif
@@ -2,8 +2,36 @@
 // ========== FILE INCLUDE =======
 // ===============================
 
-#include "stm32f4xx.h"
+#include "hw.h"
 #include "adc.h"
+#include "cpuload.h"     // Tính chu kỳ CPU của ISR
+
+
+// ADC1 quét liên tục mọi kênh, DMA ghi vòng tròn vào `dma_buf` mà không cần CPU.
+// Mỗi khi đầy 1 nửa, ISR DMA lọc các mẫu của nửa đó theo kênh và ghi kết quả vào
+// `value`; trong lúc đó DMA ghi nửa còn lại. Chuỗi lọc của mỗi kênh:
+//   median 3 mẫu liên tiếp (bỏ gai 1 mẫu) → cộng 1 khối (oversampling) → EMA,
+// riêng biến trở còn qua khe trễ quanh các ngưỡng mode (`pot`).
+// Biến trở chỉ được lọc sau khi analog watchdog báo có mẫu ra khỏi cửa sổ quanh giá
+// trị đang giữ (ISR ADC nạp `pot_active`); lọc xong thì đặt lại cửa sổ.
+// Chỉ ISR DMA ghi `value`/`pot`; người đọc cùng mức ưu tiên (vòng điều khiển) nên
+// luôn thấy các kênh của cùng 1 khối. ISR ADC cũng cùng mức đó.
+Adc_Stats adc_stats;
+
+static volatile uint16_t dma_buf[ADC_SCAN_FRAMES][ADC_CH_COUNT];
+static volatile uint16_t value[ADC_CH_COUNT];    // Giá trị ADC_BITS bit mới nhất, đã lọc
+static volatile uint16_t pot;                    // Biến trở 12-bit sau khe trễ
+static uint8_t pot_mode;                         // Mode ứng với `pot`
+static uint8_t pot_active;                       // Số khối còn phải lọc biến trở (0: chờ analog watchdog)
+static uint8_t mode_event;                       // `pot_mode` vừa đổi, vòng điều khiển chưa lấy
+
+// Trạng thái lọc, chỉ ISR DMA dùng
+static uint16_t median_win[ADC_CH_COUNT][2];     // 2 mẫu thô cuối của khối trước (cửa sổ median)
+static uint32_t ema[ADC_CH_COUNT];               // EMA, ADC_BITS + ADC_EMA_FRAC bit
+
+static const uint8_t ema_shift[ADC_CH_COUNT] = ADC_EMA_SHIFTS;
+static const uint16_t mode_threshold[3] = ADC_MODE_THRESHOLDS;   // ~0.16V / 1.1V / 2.2V
+static const uint16_t mode_hyst[3] = ADC_MODE_HYST;
 
 
 // ======================================
@@ -11,56 +39,205 @@
 // ======================================
 
 /**
- * @brief Khởi tạo ADC1 đọc từ chân PA0 (kênh ADC_IN0)
+ * @brief Khởi tạo ADC1 + DMA: quét biến trở (PA0), NTC (PA4), cảm biến nhiệt bên trong
+ *        và VREFINT liên tục; kết quả đầu tiên có sau 1 khối (~4 ms)
  */
 void ADC_Init(void) {
-    // Bật clock cho ADC1 (bit 8 của RCC->APB2ENR)
-    RCC->APB2ENR |= (1 << 8); // ADC1EN
+    pot_active = ADC_POT_ACTIVE_BLOCKS;   // Lọc các khối đầu, rồi mới đặt cửa sổ
+    HW_ADC_Init(&dma_buf[0][0], ADC_SCAN_FRAMES * ADC_CH_COUNT);
+}
+
+
+/**
+ * @brief Giá trị mới nhất của 1 kênh (ADC_BITS bit, trung bình 1 khối), không chờ
+ */
+uint16_t ADC_Get(Adc_Channel ch) {
+    return value[ch];
+}
+
+
+/**
+ * @brief Giá trị biến trở mới nhất (12-bit) sau khe trễ, không chờ: luôn nằm trong
+ *        dải của mode hiện tại, nên đường cong quạt kiểu bậc thang cũng không nhảy
+ */
+uint16_t ADC_GetPot(void) {
+    return pot;
+}
+
+
+/**
+ * @brief Mode của biến trở đã đổi kể từ lần gọi trước (gọi từ vòng điều khiển)
+ */
+uint8_t ADC_TakeModeEvent(void) {
+    uint8_t ev = mode_event;
+
+    mode_event = 0;
+    return ev;
+}
+
+
+/**
+ * @brief Số khối mẫu đã xử lý: người đọc so với lần trước để biết có giá trị mới
+ *        (0: chưa có giá trị nào)
+ */
+uint32_t ADC_Sequence(void) {
+    return adc_stats.blocks;
+}
 
-    // Bật clock cho GPIOA (bit 0 của RCC->AHB1ENR)
-    RCC->AHB1ENR |= (1 << 0); // GPIOAEN
 
-    // PA0 vào chế độ analog: MODER0 = 11
-    GPIOA->MODER |= (3 << (0 * 2)); // Bit 1:0 = 11
+/**
+ * @brief Trung vị của 3 giá trị (2 phép so sánh + kẹp, không rẽ nhánh trên Cortex-M4)
+ */
+static inline uint32_t ADC_Median3(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t lo = (a < b) ? a : b;
+    uint32_t hi = (a < b) ? b : a;
+    return (c < lo) ? lo : (c > hi) ? hi : c;
+}
 
-    // Chọn kênh chuyển đổi: ADC1_IN0 -> SQR3[4:0] = 00000
-    ADC1->SQR3 = 0;
 
-    // Cài đặt thời gian lấy mẫu cho kênh 0: 480 chu kỳ (SMPR2)
-    ADC1->SMPR2 |= (7 << 0); // SMP0 = 111
+/**
+ * @brief Lọc 1 khối của 1 kênh: median 3 → cộng 2^ADC_OVERSAMPLE_LOG2 mẫu → ADC_BITS bit
+ *        → EMA (bậc lớn thì nhảy thẳng, khối đầu tiên cũng vậy)
+ *
+ * Vòng trong chỉ có 1 lần đọc, trung vị và 1 phép cộng cho mỗi mẫu (~12 chu kỳ,
+ * < 1 µs ở 16 MHz); EMA chạy 1 lần mỗi khối.
+ */
+static uint16_t ADC_FilterBlock(uint32_t ch, const volatile uint16_t (*frame)[ADC_CH_COUNT]) {
+    uint32_t a = median_win[ch][0], b = median_win[ch][1], sum = 0;
+    int32_t diff;
+
+    if (!adc_stats.blocks) a = b = frame[0][ch];   // Khối đầu: chưa có mẫu trước
+
+    for (uint32_t f = 0; f < ADC_SCAN_FRAMES / 2; f++) {
+        uint32_t c = frame[f][ch];
+        sum += ADC_Median3(a, b, c);
+        a = b;
+        b = c;
+    }
+    median_win[ch][0] = (uint16_t)a;
+    median_win[ch][1] = (uint16_t)b;
+
+    sum = (sum + (1u << (ADC_OVERSAMPLE_LOG2 - (ADC_BITS - 12) - 1))) >> (ADC_OVERSAMPLE_LOG2 - (ADC_BITS - 12));
+    diff = (int32_t)(sum << ADC_EMA_FRAC) - (int32_t)ema[ch];
+    if (!adc_stats.blocks || diff > (int32_t)(ADC_EMA_SNAP << ADC_EMA_FRAC) ||
+        diff < -(int32_t)(ADC_EMA_SNAP << ADC_EMA_FRAC)) {
+        ema[ch] = sum << ADC_EMA_FRAC;
+    } else {
+        ema[ch] = (uint32_t)((int32_t)ema[ch] + (diff >> ema_shift[ch]));
+    }
+    return (uint16_t)((ema[ch] + (1u << (ADC_EMA_FRAC - 1))) >> ADC_EMA_FRAC);
+}
+
 
-    // Bật ADC1 (bit ADON trong CR2)
-    ADC1->CR2 |= (1 << 0); // ADON = 1
+/**
+ * @brief Khe trễ của biến trở: mode chỉ đổi khi giá trị vượt ngưỡng ± mode_hyst, rồi
+ *        kẹp giá trị vào dải của mode đó
+ * @param v Biến trở đã lọc (12-bit)
+ */
+static void ADC_PotHysteresis(uint16_t v) {
+    uint8_t m = adc_stats.blocks ? pot_mode : Mode_From_ADC(v);
+    uint16_t lo, hi;
+
+    while (m < 3 && v >= mode_threshold[m] + mode_hyst[m]) m++;
+    while (m > 0 && v + mode_hyst[m - 1] < mode_threshold[m - 1]) m--;
+    if (m != pot_mode) {
+        adc_stats.pot_modes++;
+        mode_event = 1;
+    }
+    pot_mode = m;
+
+    lo = m ? mode_threshold[m - 1] : 0;
+    hi = (m < 3) ? (uint16_t)(mode_threshold[m] - 1) : 4095;
+    pot = (v < lo) ? lo : (v > hi) ? hi : v;
 }
 
 
 /**
- * @brief Đọc giá trị từ kênh ADC đã cấu hình
- * @return Giá trị 12-bit từ ADC1->DR
+ * @brief Đặt cửa sổ analog watchdog quanh giá trị biến trở vừa lọc: dải của `pot_mode`
+ *        mở rộng theo khe trễ (ra khỏi đó là đổi mode), thu hẹp còn ± ADC_AWD_DEADBAND
  */
-uint16_t ADC_Read(void) {
-    // Bắt đầu chuyển đổi (SWSTART = 1, bit 30 của CR2)
-    ADC1->CR2 |= (1 << 30);
+static void ADC_PotArm(void) {
+    uint16_t v = ADC_TO_12BIT(value[ADC_CH_POT]);
+    uint16_t lo = pot_mode ? (uint16_t)(mode_threshold[pot_mode - 1] - mode_hyst[pot_mode - 1]) : 0;
+    uint16_t hi = (pot_mode < 3) ? (uint16_t)(mode_threshold[pot_mode] + mode_hyst[pot_mode] - 1) : 4095;
+
+    if (v > lo + ADC_AWD_DEADBAND) lo = (uint16_t)(v - ADC_AWD_DEADBAND);
+    if (v + ADC_AWD_DEADBAND < hi) hi = (uint16_t)(v + ADC_AWD_DEADBAND);
+    HW_ADC_WatchdogArm(lo, hi);
+}
 
-    // Chờ đến khi hoàn tất chuyển đổi (EOC = 1, bit 1 của SR)
-    while (!(ADC1->SR & (1 << 1)));
 
-    // Trả về kết quả đọc được
-    return ADC1->DR;
+/**
+ * @brief Ngắt DMA2 Stream0: 1 nửa bộ đệm vừa đầy, lọc 2^ADC_OVERSAMPLE_LOG2 mẫu mỗi
+ *        kênh (không chia); biến trở chỉ khi đang hoạt động (sau analog watchdog)
+ *
+ * Nếu ISR trễ tới mức cả 2 cờ cùng bật thì nửa sau (TC) là khối mới nhất.
+ */
+void DMA2_Stream0_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_ADC);
+    uint32_t flags = HW_ADC_DmaFlags();
+
+    HW_ADC_DmaClear(flags);
+    if (flags & (HW_ADC_DMA_HALF | HW_ADC_DMA_FULL)) {
+        const volatile uint16_t (*frame)[ADC_CH_COUNT] =
+            &dma_buf[(flags & HW_ADC_DMA_FULL) ? ADC_SCAN_FRAMES / 2 : 0];
+
+        for (uint32_t ch = ADC_CH_POT + 1; ch < ADC_CH_COUNT; ch++) value[ch] = ADC_FilterBlock(ch, frame);
+        if (pot_active) {
+            value[ADC_CH_POT] = ADC_FilterBlock(ADC_CH_POT, frame);
+            ADC_PotHysteresis(ADC_TO_12BIT(value[ADC_CH_POT]));
+            adc_stats.pot_blocks++;
+            if (!--pot_active) ADC_PotArm();
+        }
+        adc_stats.blocks++;
+    }
+
+    CpuLoad_Leave(prev);
+}
+
+
+/**
+ * @brief Ngắt ADC1: analog watchdog (mẫu biến trở ra khỏi cửa sổ) bắt đầu lọc biến trở
+ *        từ khối đang ghi, khối đó đã chứa mẫu vừa vượt; tràn (OVR) làm DMA dừng,
+ *        quét lại từ đầu bộ đệm
+ */
+void ADC_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_ADC);
+
+    if (HW_ADC_WatchdogFired()) {
+        HW_ADC_WatchdogDisarm();   // Mọi mẫu ngoài cửa sổ đều bật cờ: tới ADC_PotArm mới bật lại
+        pot_active = ADC_POT_ACTIVE_BLOCKS;
+        adc_stats.awd_events++;
+    }
+    if (HW_ADC_Overrun()) {
+        adc_stats.overruns++;
+        HW_ADC_Restart(ADC_SCAN_FRAMES * ADC_CH_COUNT);
+    }
+
+    CpuLoad_Leave(prev);
 }
 
 
 /**
- * @brief Cập nhật mode dựa trên giá trị ADC
+ * @brief Mode ứng với giá trị biến trở mới nhất, đã lọc và qua khe trễ (không chờ,
+ *        không tính lại)
  * @return Mode tương ứng (0 đến 3)
  */
 uint8_t Mode_Update_From_ADC(void) {
-    uint16_t adc_value = ADC_Read();
+    return pot_mode;
+}
+
+
+/**
+ * @brief Đổi giá trị ADC (12-bit) thành mode, không trễ: 0 là vùng tắt, rồi mỗi
+ *        ngưỡng vượt qua thêm 1 mode
+ * @return Mode tương ứng (0 đến 3)
+ */
+uint8_t Mode_From_ADC(uint16_t adc_value) {
+    uint8_t m = 0;
 
-    if (adc_value < 200) return 0;         // Vùng tắt
-    else if (adc_value < 1365) return 1;   // 0.8V ~ mode 1
-    else if (adc_value < 2730) return 2;   // ~1.65V ~ mode 2
-    else return 3;                         // >2.2V ~ mode 3
+    while (m < 3 && adc_value >= mode_threshold[m]) m++;
+    return m;
 }
 
 
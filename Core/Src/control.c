@@ -0,0 +1,393 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // TIM5, DWT CYCCNT, che ngắt
+#include "control.h"
+#include "system.h"      // GetTimeUs64(), System_PostEvent()
+#include "adc.h"         // Giá trị ADC mới nhất (DMA), không chờ
+#include "pwm.h"         // PWM_SetQ16, PWM_RampTo, PWM_IsIdle (theo quạt)
+#include "fancurve.h"    // Đường cong ADC → duty
+#include "led.h"         // LED_Update
+#include "exti.h"        // Buttons_Process
+#include "fsm.h"         // Máy trạng thái thiết bị
+#include "cpuload.h"     // Tính chu kỳ CPU của ISR
+#include "wdg.h"         // Báo còn sống cho watchdog
+#include "tach.h"        // Tốc độ quạt đo được
+#include "pid.h"         // PID tốc độ (vòng kín)
+#include "temp.h"        // Nhiệt độ NTC/chip, đường cong nhiệt độ → duty
+
+
+// Vòng điều khiển chạy trong ISR TIM5 và là nơi duy nhất chạy máy trạng thái, đọc
+// ADC, ghi PWM/LED. Vòng lặp chính chỉ đọc `snapshot` (qua Control_GetSnapshot),
+// nên OLED vẽ chậm bao lâu cũng không làm trễ điều khiển.
+Control_Stats control_stats;
+Control_Config control_config = CONTROL_CONFIG_DEFAULT;
+
+static Control_Snapshot snapshot;
+static uint32_t second_div = 0;       // Đếm số lần chạy để phát FSM_EV_SECOND mỗi giây
+static uint32_t adc_seq = 0;          // ADC_Sequence() của khối mẫu đã dùng
+static uint16_t adc_last = 0;         // Biến trở (12-bit, đã lọc và qua khe trễ) của khối đó
+static uint32_t runs_at_stop = 0;     // control_stats.runs lúc cho phép Stop lần gần nhất
+static Pid pid;                       // PID tốc độ, chỉ vòng điều khiển dùng
+static uint32_t pid_div = 0;          // Đếm chu kỳ điều khiển tới lần chạy PID kế tiếp
+static uint16_t target_rpm = 0;
+static uint8_t temp_auto = 0;         // Chu kỳ này quạt chạy theo nhiệt độ
+
+// Đầu vào của lần tính duty đích và LED gần nhất: không đổi thì vòng điều khiển bỏ
+// qua đường cong, ramp và LED (biến trở đứng yên thì mỗi chu kỳ gần như không tốn gì)
+static struct {
+    uint8_t valid;
+    uint8_t state;
+    uint8_t mode;
+    uint8_t from_adc;
+    uint8_t temp_auto;
+    uint8_t fan_mode;
+    uint16_t adc;
+    uint32_t curves;                  // FanCurve_Version()
+} applied;
+
+// Deadline watchdog của vòng điều khiển và xử lý nút nhấn, tính bằng số chu kỳ điều khiển
+#define CONTROL_WDG_PERIODS  20u
+
+// Vòng điều khiển chỉ báo còn sống khi có khối mẫu ADC mới (mỗi nửa bộ đệm DMA,
+// ~3,9 ms), nên deadline của nó cũng không ngắn hơn bấy nhiêu khối
+#define CONTROL_WDG_ADC_BLOCKS  4u
+#define CONTROL_ADC_BLOCK_US    ((uint32_t)((uint64_t)(ADC_SCAN_FRAMES / 2) * ADC_CH_COUNT * \
+                                            HW_ADC_CONV_CYCLES * 1000000 / HW_ADC_CLK_HZ))
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Tần số chạy PID (Hz)
+ */
+static uint32_t Control_PidRate(void) {
+    uint32_t rate = control_stats.rate_hz / CONTROL_PID_DIV;
+    return rate ? rate : 1;
+}
+
+
+/**
+ * @brief Lấy khối mẫu ADC mới nhất nếu có: biến trở và nhiệt độ
+ * @return 1 nếu có khối mới kể từ lần trước (mỗi ~4 ms), 0 nếu chưa
+ */
+static uint8_t Control_TakeAdc(void) {
+    uint32_t seq = ADC_Sequence();
+
+    if (seq == adc_seq) return 0;
+    adc_seq = seq;
+    adc_last = ADC_GetPot();
+    Temp_Update(ADC_Get(ADC_CH_NTC), ADC_Get(ADC_CH_DIE), ADC_Get(ADC_CH_VREF));
+    return 1;
+}
+
+
+/**
+ * @brief Cấu hình TIM5 tạo ngắt update với tần số `rate_hz` và bắt đầu vòng điều khiển
+ *        (gọi sau Fsm_Init, khi ADC/PWM/LED/nút nhấn đã khởi tạo)
+ * @param rate_hz Tần số (Hz), 1..1000000; 0 = CONTROL_RATE_HZ
+ *
+ * TIM5 đếm ở 1 MHz (PSC = HW_TIM_HZ / 1 MHz − 1), ARR = 1e6 / rate_hz − 1.
+ */
+void Control_Init(uint32_t rate_hz) {
+    uint32_t deadline_ms, adc_ms;
+    uint64_t wait_until;
+
+    if (rate_hz == 0 || rate_hz > 1000000) rate_hz = CONTROL_RATE_HZ;
+    control_stats.rate_hz = rate_hz;
+    Pid_Init(&pid, &control_config.pid, Control_PidRate());
+    PWM_SetRampRate(rate_hz);
+
+    // Chờ khối mẫu đầu tiên (~4 ms sau ADC_Init), để chu kỳ đầu đã có mode đúng.
+    // ADC không chạy thì chỉ chờ bằng deadline watchdog của vòng điều khiển rồi chạy
+    // tiếp với mode 0 (adc_last = 0): vòng điều khiển không báo còn sống, watchdog bắt.
+    wait_until = GetTimeUs64() + CONTROL_WDG_ADC_BLOCKS * CONTROL_ADC_BLOCK_US;
+    while (!ADC_Sequence() && GetTimeUs64() < wait_until) HW_Spin();
+    Control_TakeAdc();
+    snapshot.adc = adc_last;
+
+    // Từ đây vòng điều khiển (và hàng đợi nút nhấn mà nó xử lý) phải báo đều đặn.
+    // Deadline tính theo ms (độ phân giải SysTick) nên cộng thêm 1 ms.
+    deadline_ms = CONTROL_WDG_PERIODS * 1000 / rate_hz + 1;
+    if (deadline_ms > 0xFFFF) deadline_ms = 0xFFFF;
+    adc_ms = CONTROL_WDG_ADC_BLOCKS * CONTROL_ADC_BLOCK_US / 1000 + 1;
+    Wdg_Register(WDG_CONTROL, (uint16_t)(deadline_ms > adc_ms ? deadline_ms : adc_ms));
+    Wdg_Register(WDG_INPUT, (uint16_t)deadline_ms);
+
+    HW_TIM5_Init(HW_TIM_HZ / 1000000 - 1, 1000000 / rate_hz - 1);
+}
+
+
+/**
+ * @brief RPM đặt theo biến trở: 0 ở vùng tắt (mode 0), rồi tuyến tính
+ *        rpm_min..rpm_max trên phần còn lại của dải ADC
+ */
+static uint16_t Control_TargetRpm(uint16_t adc) {
+    uint32_t span = control_config.rpm_max - control_config.rpm_min;
+
+    if (device.mode == 0) return 0;
+    if (adc < ADC_MODE_ON_MIN) adc = ADC_MODE_ON_MIN;   // Mode do nút đặt khi biến trở còn ở vùng tắt
+    return (uint16_t)(control_config.rpm_min +
+                      (span * (adc - ADC_MODE_ON_MIN) + (FANCURVE_ADC_MAX - ADC_MODE_ON_MIN) / 2) /
+                      (FANCURVE_ADC_MAX - ADC_MODE_ON_MIN));
+}
+
+
+/**
+ * @brief Vòng kín tốc độ của quạt 0: mỗi CONTROL_PID_DIV chu kỳ chạy 1 bước PID với
+ *        RPM đo bằng tach, ghi duty Q16 ra PWM (chỉ số nguyên, không chia trong Pid_Step)
+ */
+static void Control_RpmLoop(void) {
+    target_rpm = Control_TargetRpm(adc_last);
+    if (++pid_div < CONTROL_PID_DIV) return;
+    pid_div = 0;
+
+    if (!target_rpm) {
+        Pid_Reset(&pid, 0);
+        PWM_SetQ16(0, 0);
+    } else {
+        PWM_SetQ16(0, (uint32_t)Pid_Step(&pid, target_rpm, (int32_t)Tach_GetRpm(0)));
+    }
+}
+
+
+/**
+ * @brief Duty đích vòng hở của các quạt từ `first` tới hết, trong 1 lượt: mỗi quạt
+ *        theo đường cong riêng, hoặc theo mode khi mode do nút nhấn đặt; chuyển mềm
+ *        qua ramp riêng của quạt đó (PWM_RampStep chạy sau, cũng 1 lượt cho mọi quạt)
+ */
+static void Control_CurveFans(uint8_t first, uint8_t from_adc) {
+    for (uint8_t fan = first; fan < HW_FAN_COUNT; fan++) {
+        if (from_adc) PWM_RampTo(fan, FanCurve_Eval(fan, adc_last));
+        else PWM_RampToMode(fan, device.mode);
+    }
+}
+
+
+/**
+ * @brief Đầu vào của duty đích và LED có đổi kể từ lần tính trước không (và ghi nhận
+ *        đầu vào mới)
+ *
+ * adc_last chỉ đổi ở khối mẫu mà ADC lọc biến trở (sau ngắt analog watchdog), nên
+ * biến trở đứng yên thì chỉ nút nhấn, máy trạng thái, cấu hình hoặc đường cong mới
+ * làm hàm này trả về 1.
+ */
+static uint8_t Control_InputsChanged(uint8_t from_adc) {
+    uint32_t curves = FanCurve_Version();
+
+    if (applied.valid && applied.state == device.state && applied.mode == device.mode &&
+        applied.from_adc == from_adc && applied.temp_auto == temp_auto &&
+        applied.fan_mode == control_config.fan_mode && applied.adc == adc_last &&
+        applied.curves == curves) {
+        return 0;
+    }
+    applied.valid = 1;
+    applied.state = device.state;
+    applied.mode = device.mode;
+    applied.from_adc = from_adc;
+    applied.temp_auto = temp_auto;
+    applied.fan_mode = control_config.fan_mode;
+    applied.adc = adc_last;
+    applied.curves = curves;
+    return 1;
+}
+
+
+/**
+ * @brief Mode (4 mức, cho LED, màn hình và máy trạng thái) ứng với duty tự động,
+ *        theo các mức 0 / 40 / 70 / 100 % của đường cong STEP
+ */
+static uint8_t Control_ModeFromDuty(uint32_t q16) {
+    if (!q16) return 0;
+    if (q16 <= 26214) return 1;   // ≤ 40 %
+    if (q16 <= 45875) return 2;   // ≤ 70 %
+    return 3;
+}
+
+
+/**
+ * @brief 1 lần chạy vòng điều khiển: nút nhấn → máy trạng thái → ADC → đường cong/PID/nhiệt độ
+ *        → PWM/LED
+ *
+ * Thời gian chạy có giới hạn: hàng đợi nút nhấn có tối đa EVQ_SIZE phần tử, và
+ * ADC không bị chờ (DMA quét liên tục, chỉ đọc khối mẫu mới nhất nếu có).
+ */
+static void Control_Step(void) {
+    uint8_t handled = Buttons_Process();
+    uint8_t fresh = 0;
+    uint8_t pot_event = 0;
+
+    if (++second_div >= control_stats.rate_hz) {
+        second_div = 0;
+        Fsm_Dispatch(FSM_EV_SECOND);
+    }
+
+    if (device.state != FSM_ST_OFF) {
+        uint8_t from_adc = !device.hold_mode;
+        uint8_t retarget;
+
+        fresh = Control_TakeAdc();
+        pot_event = ADC_TakeModeEvent();
+
+        // Chế độ nhiệt độ: biến trở ở vùng tắt nghĩa là AUTO, mode lấy theo duty tự động
+        temp_auto = 0;
+        if (from_adc) {
+            device.mode = Mode_Update_From_ADC();   // Mode sau khe trễ, ADC đã tính sẵn
+            if (control_config.fan_mode == CONTROL_FAN_TEMP && device.mode == 0) {
+                temp_auto = 1;
+                device.mode = Control_ModeFromDuty(Temp_DutyQ16());
+            }
+        } else {
+            device.hold_mode = 0;  // Giữ mode do nút nhấn đặt trong 1 chu kỳ
+        }
+
+        // Quạt và LED chạy chỉ ở các trạng thái cho phép (xem fsm_states). Duty lấy
+        // từ đường cong của từng quạt (chuyển mềm qua ramp của PWM); ở chế độ RPM,
+        // quạt 0 theo PID tốc độ, các quạt còn lại vẫn theo đường cong; ở AUTO mọi
+        // quạt theo đường cong nhiệt độ. Mode (4 mức) vẫn dùng cho LED, màn hình và
+        // máy trạng thái.
+        // Duty đích và LED chỉ tính lại khi đầu vào đổi; ở AUTO thì thêm mỗi khối mẫu
+        // mới (nhiệt độ đổi theo). PID tốc độ vẫn chạy mỗi chu kỳ vì bám theo tach.
+        retarget = Control_InputsChanged(from_adc) || (temp_auto && fresh);
+
+        if (!Fsm_FanEnabled()) {
+            if (retarget) {
+                for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) PWM_RampToMode(fan, 0);
+                LED_Update(0);
+                Pid_Reset(&pid, 0);
+                target_rpm = 0;
+            }
+        } else if (temp_auto) {
+            if (retarget) {
+                uint32_t duty = Temp_DutyQ16();
+                for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) PWM_RampTo(fan, duty);
+                LED_Update(device.mode);
+                target_rpm = 0;
+            }
+        } else if (control_config.fan_mode == CONTROL_FAN_RPM) {
+            Control_RpmLoop();
+            if (retarget) {
+                Control_CurveFans(1, from_adc);
+                LED_Update(device.mode);
+            }
+        } else if (retarget) {
+            Control_CurveFans(0, from_adc);
+            LED_Update(device.mode);
+            target_rpm = 0;
+        }
+    } else {
+        Pid_Reset(&pid, 0);
+        target_rpm = 0;
+        temp_auto = 0;
+        applied.valid = 0;     // Bật lại thì tính duty đích ngay chu kỳ đầu
+    }
+    PWM_RampStep();   // Ramp do PWM_RampTo đặt (vòng hở); PID tự giới hạn slew
+
+    // Chỉ báo còn sống khi đã điều khiển theo mẫu ADC mới: ADC treo cũng bị watchdog bắt
+    if (fresh || device.state == FSM_ST_OFF) Wdg_CheckIn(WDG_CONTROL);
+
+    snapshot.state = device.state;
+    snapshot.mode = device.mode;
+    snapshot.countdown = device.countdown;
+    snapshot.adc = adc_last;
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        snapshot.rpm[fan] = (uint16_t)Tach_GetRpm(fan);
+        snapshot.permille[fan] = PWM_GetPermille(fan);
+    }
+    snapshot.target_rpm = target_rpm;
+    snapshot.ntc_dc = Temp_Ntc();
+    snapshot.die_dc = Temp_Die();
+    snapshot.temp_auto = temp_auto;
+
+    // Nút nhấn được chấp nhận, hoặc biến trở vừa đổi mode: nhờ vòng lặp chính vẽ lại ngay
+    // (không đợi chu kỳ vẽ 500 ms)
+    if (handled || pot_event) System_PostEvent(EVT_UI);
+}
+
+
+/**
+ * @brief Ngắt update TIM5: chạy vòng điều khiển và đo thời gian thực thi
+ */
+void TIM5_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_CONTROL);
+    uint32_t start = HW_CycleCount();
+    uint32_t elapsed;
+
+    HW_TIM5_ClearUpdate();
+    Control_Step();
+
+    elapsed = HW_CycleCount() - start;
+    if (elapsed > control_stats.exec_max) control_stats.exec_max = elapsed;
+    control_stats.runs++;
+
+    CpuLoad_Leave(prev);
+}
+
+
+/**
+ * @brief Chép trạng thái điều khiển mới nhất (gọi từ vòng lặp chính)
+ */
+void Control_GetSnapshot(Control_Snapshot* snap) {
+    uint32_t primask = HW_IRQ_Save();
+    *snap = snapshot;
+    HW_IRQ_Restore(primask);
+}
+
+
+/**
+ * @brief Quyết định vòng lặp chính có được ngủ Stop mode tới `deadline` không
+ * @param deadline Deadline của bộ lập lịch, có thể bị rút ngắn
+ * @return 1 nếu được vào Stop mode
+ *
+ * Stop chỉ khi không có xung PWM. TIM5 dừng trong Stop, nên:
+ *   - Sau mỗi lần Stop phải thức (WFI) tới khi vòng điều khiển chạy lại ít nhất
+ *     1 lần (xử lý nút nhấn đã đánh thức CPU) rồi mới được Stop tiếp.
+ *   - Khi chưa OFF, mỗi lần Stop tối đa CONTROL_IDLE_POLL_US để vẫn đọc biến trở.
+ */
+uint8_t Control_StopAllowed(uint64_t* deadline) {
+    uint64_t now = GetTimeUs64();
+    uint64_t limit;
+
+    if (!PWM_IsIdle()) return 0;
+
+    if (control_stats.runs == runs_at_stop) {
+        limit = now + 1000000 / control_stats.rate_hz;
+        if (*deadline > limit) *deadline = limit;
+        return 0;
+    }
+    runs_at_stop = control_stats.runs;
+
+    if (snapshot.state != FSM_ST_OFF) {
+        limit = now + CONTROL_IDLE_POLL_US;
+        if (*deadline > limit) *deadline = limit;
+    }
+    Tach_Restart();   // TIM3 cũng dừng trong Stop: chu kỳ qua lần ngủ không dùng được
+    return 1;
+}
+
+
+/**
+ * @brief Đổi cấu hình vòng điều khiển (chế độ quạt, dải RPM, hệ số PID)
+ *
+ * PID được tính lại hệ số và tiếp tục từ duty đang chạy, nên chuyển giữa vòng hở
+ * và vòng kín không làm quạt giật.
+ */
+void Control_SetConfig(const Control_Config* config) {
+    uint32_t primask = HW_IRQ_Save();
+
+    control_config = *config;
+    if (control_config.fan_mode >= CONTROL_FAN_MODE_COUNT) control_config.fan_mode = CONTROL_FAN_CURVE;
+    if (control_config.rpm_max < control_config.rpm_min) control_config.rpm_max = control_config.rpm_min;
+    Pid_Init(&pid, &control_config.pid, Control_PidRate());
+    Pid_Reset(&pid, (int32_t)(((uint32_t)PWM_GetPermille(0) * 65536 + 500) / 1000));
+    pid_div = 0;
+    HW_IRQ_Restore(primask);
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
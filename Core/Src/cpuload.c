@@ -0,0 +1,124 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // DWT CYCCNT, che ngắt
+#include "cpuload.h"
+#include "system.h"      // GetTimeUs64()
+
+
+// Chu kỳ tích lũy của cửa sổ đang mở, theo ngữ cảnh
+static uint32_t window_acc[CPU_SLOT_COUNT];
+static uint64_t window_start;      // GetTimeUs64() lúc mở cửa sổ
+static uint32_t cycle_last;        // CYCCNT lần tính gần nhất
+static uint8_t current = CPU_SLOT_MAIN;
+
+CpuLoad_Stats cpu_load;
+volatile uint8_t cpu_load_page = 0;
+
+static const char* const slot_names[CPU_SLOT_TASK] = {
+    "idle", "main", "systick", "exti", "rtc", "control", "tach", "adc", "i2c"
+};
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Cộng số chu kỳ từ lần tính trước vào ngữ cảnh hiện tại. Gọi khi PRIMASK = 1.
+ */
+static void CpuLoad_Charge(void) {
+    uint32_t now = HW_CycleCount();
+    uint32_t delta = now - cycle_last;   // Đúng cả khi CYCCNT tràn 32-bit (~268 s)
+
+    cycle_last = now;
+    window_acc[current] += delta;
+    cpu_load.total_cycles[current] += delta;
+}
+
+
+/**
+ * @brief Bật bộ đếm chu kỳ DWT và mở cửa sổ đo đầu tiên (sau SysTick_Init)
+ */
+void CpuLoad_Init(void) {
+    HW_CycleCounter_Init();
+    cycle_last = HW_CycleCount();
+    window_start = GetTimeUs64();
+}
+
+
+/**
+ * @brief Chuyển sang ngữ cảnh `slot` (gọi được từ ISR)
+ * @return Ngữ cảnh trước đó, truyền lại cho CpuLoad_Leave
+ */
+uint8_t CpuLoad_Enter(uint8_t slot) {
+    uint32_t primask = HW_IRQ_Save();
+    uint8_t prev = current;
+
+    CpuLoad_Charge();
+    current = slot;
+
+    HW_IRQ_Restore(primask);
+    return prev;
+}
+
+
+/**
+ * @brief Trở về ngữ cảnh `prev` (giá trị trả về của CpuLoad_Enter)
+ */
+void CpuLoad_Leave(uint8_t prev) {
+    CpuLoad_Enter(prev);
+}
+
+
+/**
+ * @brief Đóng cửa sổ đo khi đã đủ CPU_WINDOW_US (gọi từ vòng lặp chính)
+ *
+ * Sau Stop mode cửa sổ có thể dài hơn 1 s; tỉ lệ vẫn tính theo độ dài thực.
+ */
+void CpuLoad_Update(void) {
+    uint64_t now = GetTimeUs64();
+    uint64_t total;
+    uint32_t busy = 0;
+    uint32_t primask;
+
+    if (now - window_start < CPU_WINDOW_US) return;
+
+    total = (now - window_start) * (HW_CPU_HZ / 1000000);
+
+    primask = HW_IRQ_Save();
+    CpuLoad_Charge();
+    for (uint8_t slot = 0; slot < CPU_SLOT_COUNT; slot++) {
+        cpu_load.cycles[slot] = window_acc[slot];
+        window_acc[slot] = 0;
+    }
+    HW_IRQ_Restore(primask);
+
+    for (uint8_t slot = 0; slot < CPU_SLOT_COUNT; slot++) {
+        cpu_load.permille[slot] = (uint16_t)((uint64_t)cpu_load.cycles[slot] * 1000 / total);
+        if (slot != CPU_SLOT_IDLE) busy += cpu_load.cycles[slot];
+    }
+    cpu_load.busy_permille = (uint16_t)((uint64_t)busy * 1000 / total);
+    if (cpu_load.busy_permille > 1000) cpu_load.busy_permille = 1000;
+
+    cpu_load.window_us = (uint32_t)(now - window_start);
+    cpu_load.windows++;
+    window_start = now;
+}
+
+
+/**
+ * @brief Tên ngữ cảnh để hiển thị
+ * @return NULL nếu là ô tác vụ chưa từng được đăng ký
+ */
+const char* CpuLoad_SlotName(uint8_t slot) {
+    if (slot < CPU_SLOT_TASK) return slot_names[slot];
+    if (slot < CPU_SLOT_COUNT) return Sched_GetTask(slot - CPU_SLOT_TASK)->name;
+    return 0;
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
@@ -0,0 +1,66 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "evq.h"
+
+
+// Hàng đợi vòng 1 producer / 1 consumer, không cần khóa:
+//   - Producer: các ISR EXTI (cùng mức ưu tiên NVIC nên không ngắt lẫn nhau)
+//   - Consumer: vòng điều khiển (ISR TIM5, ưu tiên cao hơn nên không bị producer chen vào)
+// Chỉ producer ghi `head`, chỉ consumer ghi `tail`. Phần tử được ghi xong trước
+// khi `head` tăng, nên consumer không bao giờ đọc phải phần tử đang ghi dở.
+// Trên Cortex-M4 một nhân, truy cập volatile giữ đúng thứ tự này (không cần DMB).
+static volatile Evq_Event buf[EVQ_SIZE];
+static volatile uint8_t head = 0;   // Tổng số phần tử đã ghi (chạy tự do, mod 256)
+static volatile uint8_t tail = 0;   // Tổng số phần tử đã đọc
+
+Evq_Stats evq_stats;
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Ghi 1 sự kiện vào hàng đợi (chỉ gọi từ ISR producer)
+ * @return 1 nếu thành công, 0 nếu hàng đợi đầy (sự kiện bị bỏ và được đếm)
+ */
+uint8_t Evq_Push(uint8_t type, uint64_t time) {
+    uint8_t h = head;
+    uint8_t used = (uint8_t)(h - tail);
+
+    if (used >= EVQ_SIZE) {
+        evq_stats.dropped++;
+        return 0;
+    }
+
+    buf[h & (EVQ_SIZE - 1)].time = time;
+    buf[h & (EVQ_SIZE - 1)].type = type;
+    head = (uint8_t)(h + 1);   // Công bố phần tử cho consumer
+
+    evq_stats.pushed++;
+    if (used + 1 > evq_stats.high_water) evq_stats.high_water = used + 1;
+    return 1;
+}
+
+
+/**
+ * @brief Lấy sự kiện cũ nhất ra khỏi hàng đợi (chỉ gọi từ consumer: vòng điều khiển)
+ * @return 1 nếu có sự kiện, 0 nếu hàng đợi rỗng
+ */
+uint8_t Evq_Pop(Evq_Event* ev) {
+    uint8_t t = tail;
+
+    if (t == head) return 0;
+
+    ev->time = buf[t & (EVQ_SIZE - 1)].time;
+    ev->type = buf[t & (EVQ_SIZE - 1)].type;
+    tail = (uint8_t)(t + 1);   // Trả ô nhớ lại cho producer
+    return 1;
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
@@ -2,16 +2,16 @@
 // ========== FILE INCLUDE =========
 // =================================
 
-#include "stm32f4xx.h"  // Thư viện CMSIS cho STM32F4
+#include "hw.h"         // Lớp truy cập phần cứng
 #include "exti.h"       // Header cho exti.c (khai báo GPIO_EXTI_Init, các IRQ handler)
-#include "system.h"     // Hàm GetTick()
+#include "system.h"     // Hàm GetTimeUs64(), System_PostEvent()
+#include "evq.h"        // Hàng đợi sự kiện ISR → vòng lặp chính
+#include "fsm.h"        // Máy trạng thái thiết bị (mã sự kiện nút nhấn)
+#include "cpuload.h"    // Tính chu kỳ CPU của ISR
+#include "wdg.h"        // Báo còn sống cho watchdog
 
-// Biến toàn cục được định nghĩa bên ngoài
-volatile uint8_t countdown = 0;       // Bộ đếm thời gian (giây)
-volatile uint8_t mode = 1;            // Chế độ hoạt động hiện tại
-volatile uint8_t button_pressed = 0;  // Cờ nhấn nút
-volatile uint8_t system_active = 1;   // Trạng thái hệ thống (ON/OFF)
-volatile uint8_t oled_state = 3;      // Trạng thái hiển thị OLED
+// Thời gian chống dội nút (µs)
+#define DEBOUNCE_US  50000u
 
 
 // ======================================
@@ -25,134 +25,95 @@ volatile uint8_t oled_state = 3;      // Trạng thái hiển thị OLED
  *        Tất cả được cấu hình để kích hoạt ngắt cạnh xuống.
  */
 void GPIO_EXTI_Init(void) {
-    // Bật clock cho GPIOA và GPIOB
-    RCC->AHB1ENR |= (1 << 0) | (1 << 1);  // GPIOAEN, GPIOBEN
-
-    // Bật clock cho SYSCFG để cấu hình EXTI
-    RCC->APB2ENR |= (1 << 14);  // SYSCFGEN
-
-    // Thiết lập các chân PA6, PA7, PB0, PB1 là input (MODER = 00)
-    GPIOA->MODER &= ~((3 << (6 * 2)) | (3 << (7 * 2)));
-    GPIOB->MODER &= ~((3 << (0 * 2)) | (3 << (1 * 2)));
-
-    // Kích hoạt điện trở kéo lên (pull-up)
-    GPIOA->PUPDR |= (1 << (6 * 2)) | (1 << (7 * 2));
-    GPIOB->PUPDR |= (1 << (0 * 2)) | (1 << (1 * 2));
-
-    // Gán EXTI dòng 6, 7 cho chân PA6, PA7 (EXTICR[1])
-    SYSCFG->EXTICR[1] &= ~((0xF << 8) | (0xF << 12));  // PA = 0000
-
-    // Gán EXTI dòng 0, 1 cho chân PB0, PB1 (EXTICR[0])
-    SYSCFG->EXTICR[0] &= ~((0xF << 0) | (0xF << 4));
-    SYSCFG->EXTICR[0] |= (1 << 0) | (1 << 4);          // PB = 0001
-
-    // Cho phép ngắt từ EXTI dòng 0,1,6,7
-    EXTI->IMR |= (1 << 0) | (1 << 1) | (1 << 6) | (1 << 7);
-
-    // Kích hoạt ngắt cạnh xuống (falling edge)
-    EXTI->FTSR |= (1 << 0) | (1 << 1) | (1 << 6) | (1 << 7);
-
-    // Kích hoạt ngắt trong NVIC
-    NVIC_EnableIRQ(EXTI9_5_IRQn);  // PA6, PA7
-    NVIC_EnableIRQ(EXTI0_IRQn);    // PB0
-    NVIC_EnableIRQ(EXTI1_IRQn);    // PB1
-
-    // Thiết lập mức ưu tiên ngắt
-    NVIC_SetPriority(EXTI9_5_IRQn, 0);  // Cao nhất
-    NVIC_SetPriority(EXTI0_IRQn, 1);
-    NVIC_SetPriority(EXTI1_IRQn, 1);
+    HW_EXTI_Init();
 }
 
 
 /**
- * @brief Xử lý sự kiện nhấn nút tại PA6 hoặc PA7
- *        - PA6: Bật/tắt hệ thống
- *        - PA7: Bắt đầu đếm lùi 10s
+ * @brief Bật/tắt ngắt của các nút countdown (PA7, PB0, PB1)
  */
-void EXTI9_5_IRQHandler(void) {
-    static uint32_t last_press_time = 0;
-    uint32_t current_time = GetTick();
-
-    // Chống dội nút (debounce) trong 50 ms
-    if ((current_time - last_press_time) < 50) {
-        EXTI->PR |= (1 << 6) | (1 << 7);  // Xóa cờ ngắt
-        return;
+void Buttons_EnableCountdown(uint8_t enable) {
+    if (enable) {
+        HW_EXTI_Enable(HW_EXTI_PA7 | HW_EXTI_PB0 | HW_EXTI_PB1);
+    } else {
+        HW_EXTI_Disable(HW_EXTI_PA7 | HW_EXTI_PB0 | HW_EXTI_PB1);
     }
+}
 
-    // Xử lý PA6: Tắt/Bật hệ thống
-    if (EXTI->PR & (1 << 6)) {
-        system_active ^= 1;  // Đảo trạng thái hệ thống
-
-        if (!system_active) {
-            countdown = 0;
-            mode = 0;
-            oled_state = 2;
 
-            GPIOA->ODR &= ~((1 << 1) | (1 << 2) | (1 << 3));  // Tắt LED
-            TIM4->CCR2 = 0;  // Dừng PWM
+/**
+ * @brief Ghi sự kiện nút nhấn kèm thời điểm và đánh thức vòng lặp chính
+ */
+static void Buttons_Post(uint8_t event) {
+    Evq_Push(event, GetTimeUs64());
+    System_PostEvent(EVT_BUTTON);
+}
 
-            // Tạm thời tắt các ngắt khác
-            EXTI->IMR &= ~((1 << 7) | (1 << 0) | (1 << 1));
-        } else {
-            countdown = 0;
-            mode = 1;
-            oled_state = 3;
 
-            // Cho phép lại các ngắt khác
-            EXTI->IMR |= (1 << 7) | (1 << 0) | (1 << 1);
-        }
+/**
+ * @brief Ngắt nút tại PA6 (bật/tắt) hoặc PA7 (countdown 10 s)
+ */
+void EXTI9_5_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_EXTI);
 
-        button_pressed = 1;
-        EXTI->PR |= (1 << 6);  // Xóa cờ ngắt
+    if (HW_EXTI_Pending(HW_EXTI_PA6)) {
+        HW_EXTI_Clear(HW_EXTI_PA6);  // Xóa cờ ngắt
+        Buttons_Post(FSM_EV_POWER);
     }
 
-    // Xử lý PA7: Đặt countdown = 10s
-    if (EXTI->PR & (1 << 7)) {
-        if (system_active) {
-            countdown = 10;
-            oled_state = 1;
-            button_pressed = 1;
-        }
-        EXTI->PR |= (1 << 7);  // Xóa cờ ngắt
+    if (HW_EXTI_Pending(HW_EXTI_PA7)) {
+        HW_EXTI_Clear(HW_EXTI_PA7);  // Xóa cờ ngắt
+        Buttons_Post(FSM_EV_10S);
     }
 
-    last_press_time = current_time;
+    CpuLoad_Leave(prev);
 }
 
 
 /**
- * @brief Xử lý nhấn nút tại PB0 → Đặt countdown = 20s
+ * @brief Ngắt nút tại PB0 → countdown 20 s
  */
 void EXTI0_IRQHandler(void) {
-    static uint32_t last_press_time = 0;
-    uint32_t current_time = GetTick();
-
-    if ((current_time - last_press_time) > 50) {
-        countdown = 20;
-        oled_state = 1;
-        button_pressed = 1;
-        last_press_time = current_time;
-    }
-
-    EXTI->PR |= (1 << 0);  // Xóa cờ ngắt
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_EXTI);
+    HW_EXTI_Clear(HW_EXTI_PB0);  // Xóa cờ ngắt
+    Buttons_Post(FSM_EV_20S);
+    CpuLoad_Leave(prev);
 }
 
 
 /**
- * @brief Xử lý nhấn nút tại PB1 → Đặt countdown = 30s
+ * @brief Ngắt nút tại PB1 → countdown 30 s
  */
 void EXTI1_IRQHandler(void) {
-    static uint32_t last_press_time = 0;
-    uint32_t current_time = GetTick();
-
-    if ((current_time - last_press_time) > 50) {
-        countdown = 30;
-        oled_state = 1;
-        button_pressed = 1;
-        last_press_time = current_time;
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_EXTI);
+    HW_EXTI_Clear(HW_EXTI_PB1);  // Xóa cờ ngắt
+    Buttons_Post(FSM_EV_30S);
+    CpuLoad_Leave(prev);
+}
+
+
+/**
+ * @brief Lấy hết sự kiện nút nhấn trong hàng đợi, chống dội rồi đưa vào máy
+ *        trạng thái theo thứ tự (gọi từ vòng điều khiển, ISR TIM5)
+ * @return 1 nếu có ít nhất 1 sự kiện được máy trạng thái chấp nhận
+ */
+uint8_t Buttons_Process(void) {
+    static uint64_t last_press_time[FSM_EV_BUTTONS];
+    Evq_Event ev;
+    uint8_t handled = 0;
+
+    while (Evq_Pop(&ev)) {
+        if (ev.type >= FSM_EV_BUTTONS) continue;
+
+        // Chống dội nút theo thời điểm ISR ghi nhận, riêng cho từng nút
+        if ((ev.time - last_press_time[ev.type]) < DEBOUNCE_US) continue;
+        last_press_time[ev.type] = ev.time;
+
+        handled |= Fsm_Dispatch(ev.type);
     }
 
-    EXTI->PR |= (1 << 1);  // Xóa cờ ngắt
+    Wdg_CheckIn(WDG_INPUT);   // Hàng đợi đã được lấy hết
+    return handled;
 }
 
 
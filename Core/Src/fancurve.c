@@ -0,0 +1,190 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // Che ngắt khi thay bảng
+#include "fancurve.h"
+
+
+/**
+ * @brief Đường cong đã biên dịch, luôn đủ FANCURVE_MAX_POINTS ô để tìm nhị phân
+ *        không có nhánh phụ thuộc số điểm
+ *
+ * Ô thừa lặp lại điểm cuối với x = 0xFFFF (không bao giờ ≤ ADC 12-bit), độ dốc của
+ * điểm cuối bằng 0 nên ADC vượt điểm cuối giữ nguyên duty cuối.
+ */
+typedef struct {
+    uint16_t x[FANCURVE_MAX_POINTS];       // ADC của từng điểm
+    uint32_t y[FANCURVE_MAX_POINTS];       // Duty Q16 (65536 = 100 %) tại điểm đó
+    int32_t slope[FANCURVE_MAX_POINTS];    // Độ dốc tới điểm kế tiếp (xem FANCURVE_SLOPE_SHIFT)
+} FanCurve_Table;
+
+static FanCurve_Table table[HW_FAN_COUNT];   // Mỗi quạt 1 bảng, đọc trong ISR TIM5 (FanCurve_Eval)
+static uint8_t preset_current[HW_FAN_COUNT];
+static volatile uint32_t version;             // Tăng mỗi lần thay bảng (vòng điều khiển tính lại duty)
+
+// Điểm đứng liền nhau (199 → 200) tạo bậc thang đúng như Mode_From_ADC
+static const FanCurve_Point curve_step[] = {
+    {0, 0}, {199, 0}, {200, 400}, {1364, 400}, {1365, 700}, {2729, 700}, {2730, 1000},
+};
+
+static const FanCurve_Point curve_linear[] = {
+    {199, 0}, {200, 200}, {FANCURVE_ADC_MAX, 1000},
+};
+
+static const FanCurve_Point curve_quiet[] = {
+    {199, 0}, {200, 200}, {1365, 300}, {2730, 500}, {3500, 750}, {FANCURVE_ADC_MAX, 1000},
+};
+
+static const struct {
+    const char* name;
+    const FanCurve_Point* points;
+    uint8_t count;
+} presets[FANCURVE_PRESET_COUNT] = {
+    [FANCURVE_PRESET_STEP]   = { "step",   curve_step,   sizeof(curve_step) / sizeof(curve_step[0]) },
+    [FANCURVE_PRESET_LINEAR] = { "linear", curve_linear, sizeof(curve_linear) / sizeof(curve_linear[0]) },
+    [FANCURVE_PRESET_QUIET]  = { "quiet",  curve_quiet,  sizeof(curve_quiet) / sizeof(curve_quiet[0]) },
+};
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Nạp đường cong mặc định FANCURVE_DEFAULT_PRESET cho mọi quạt (gọi trước Control_Init)
+ */
+void FanCurve_Init(void) {
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) FanCurve_SelectPreset(fan, FANCURVE_DEFAULT_PRESET);
+}
+
+
+/**
+ * @brief Đặt đường cong tuyến tính từng đoạn qua `count` điểm cho quạt `fan`
+ * @param points Các điểm, ADC tăng dần nghiêm ngặt, duty ≤ 1000 ‰
+ * @param count 2..FANCURVE_MAX_POINTS
+ * @return 1 nếu hợp lệ, 0 nếu không (giữ đường cong cũ)
+ *
+ * Mọi phép chia làm ở đây (ngoài vòng điều khiển). Dưới điểm đầu giữ duty điểm đầu,
+ * trên điểm cuối giữ duty điểm cuối. Gọi được từ vòng lặp chính lúc đang chạy:
+ * bảng được dựng riêng rồi chép vào trong lúc che ngắt.
+ */
+uint8_t FanCurve_Set(uint8_t fan, const FanCurve_Point* points, uint8_t count) {
+    FanCurve_Table t;
+    uint32_t primask;
+    uint8_t i;
+
+    if (fan >= HW_FAN_COUNT || count < 2 || count > FANCURVE_MAX_POINTS) return 0;
+
+    for (i = 0; i < count; i++) {
+        if (points[i].adc > FANCURVE_ADC_MAX || points[i].permille > 1000) return 0;
+        if (i > 0 && points[i].adc <= points[i - 1].adc) return 0;
+
+        t.x[i] = points[i].adc;
+        t.y[i] = ((uint32_t)points[i].permille * 65536 + 500) / 1000;
+    }
+
+    for (i = 0; i + 1 < count; i++) {
+        int32_t dy = (int32_t)t.y[i + 1] - (int32_t)t.y[i];
+        int32_t dx = (int32_t)t.x[i + 1] - (int32_t)t.x[i];
+        int32_t num = dy * (1 << FANCURVE_SLOPE_SHIFT);            // |num| ≤ 2^28
+
+        t.slope[i] = (num + (num < 0 ? -dx / 2 : dx / 2)) / dx;    // Làm tròn về gần nhất
+    }
+    t.slope[count - 1] = 0;
+
+    for (i = count; i < FANCURVE_MAX_POINTS; i++) {
+        t.x[i] = 0xFFFF;
+        t.y[i] = t.y[count - 1];
+        t.slope[i] = 0;
+    }
+
+    primask = HW_IRQ_Save();
+    table[fan] = t;
+    preset_current[fan] = FANCURVE_PRESET_COUNT;
+    version++;
+    HW_IRQ_Restore(primask);
+    return 1;
+}
+
+
+/**
+ * @brief Chọn 1 đường cong dựng sẵn cho quạt `fan`
+ * @return 1 nếu thành công, 0 nếu `fan` hoặc `preset` không hợp lệ
+ */
+uint8_t FanCurve_SelectPreset(uint8_t fan, uint8_t preset) {
+    if (preset >= FANCURVE_PRESET_COUNT) return 0;
+    if (!FanCurve_Set(fan, presets[preset].points, presets[preset].count)) return 0;
+    preset_current[fan] = preset;
+    return 1;
+}
+
+
+/**
+ * @brief Đường cong quạt `fan` đang dùng (FANCURVE_PRESET_COUNT: do FanCurve_Set đặt)
+ */
+uint8_t FanCurve_GetPreset(uint8_t fan) {
+    return (fan < HW_FAN_COUNT) ? preset_current[fan] : FANCURVE_PRESET_COUNT;
+}
+
+
+/**
+ * @brief Số lần bảng của bất kỳ quạt nào bị thay: khác lần đọc trước nghĩa là duty
+ *        đích tính theo đường cong phải tính lại
+ */
+uint32_t FanCurve_Version(void) {
+    return version;
+}
+
+
+/**
+ * @brief Duty Q16 (65536 = 100 %) của quạt `fan` ứng với giá trị biến trở `adc`
+ *
+ * Chạy trong ISR TIM5 mỗi chu kỳ điều khiển nên không chia, không vòng lặp:
+ * tìm nhị phân 4 bước cố định trên bảng 16 ô (mỗi bước là 1 so sánh + cộng có
+ * điều kiện, trình biên dịch sinh lệnh IT/CSEL thay cho nhánh), rồi nội suy bằng
+ * 1 phép nhân 32-bit. Sai số so với nội suy chính xác < 1 LSB Q16 (curve_bench
+ * kiểm tra toàn bộ 4096 giá trị ADC). `fan` không kiểm tra (< HW_FAN_COUNT).
+ */
+uint32_t FanCurve_Eval(uint8_t fan, uint16_t adc) {
+    const FanCurve_Table* t = &table[fan];
+    uint32_t i = 0;
+    int32_t dx, y;
+
+    i += (t->x[i + 8] <= adc) ? 8 : 0;
+    i += (t->x[i + 4] <= adc) ? 4 : 0;
+    i += (t->x[i + 2] <= adc) ? 2 : 0;
+    i += (t->x[i + 1] <= adc) ? 1 : 0;
+
+    // ADC dưới điểm đầu: dx < 0 → xóa về 0 bằng mặt nạ dấu (giữ duty điểm đầu)
+    dx = (int32_t)adc - (int32_t)t->x[i];
+    dx &= ~(dx >> 31);
+
+    y = (int32_t)t->y[i] + ((t->slope[i] * dx + (1 << (FANCURVE_SLOPE_SHIFT - 1))) >> FANCURVE_SLOPE_SHIFT);
+    y &= ~(y >> 31);      // Đoạn đi xuống tới 0 %: sai số làm tròn không được thành số âm
+    return (uint32_t)y;
+}
+
+
+/**
+ * @brief Các điểm của đường cong dựng sẵn (NULL nếu `preset` không hợp lệ)
+ */
+const FanCurve_Point* FanCurve_PresetPoints(uint8_t preset, uint8_t* count) {
+    if (preset >= FANCURVE_PRESET_COUNT) return 0;
+    *count = presets[preset].count;
+    return presets[preset].points;
+}
+
+
+/**
+ * @brief Tên đường cong dựng sẵn để hiển thị
+ */
+const char* FanCurve_PresetName(uint8_t preset) {
+    if (preset < FANCURVE_PRESET_COUNT) return presets[preset].name;
+    return "custom";
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
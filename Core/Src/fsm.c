@@ -0,0 +1,212 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "fsm.h"
+#include "exti.h"     // Buttons_EnableCountdown
+#include "led.h"      // LED_Update
+#include "pwm.h"      // Update_PWM_From_Mode
+
+Fsm_Device device = { FSM_ST_RUN, 1, 0, 0 };
+
+// Sự kiện nội bộ phát ra trong lúc đang chuyển trạng thái (run-to-completion)
+#define FSM_EV_NONE  0xFF
+static uint8_t fsm_pending = FSM_EV_NONE;
+
+
+// ======================================
+// ====== GUARD / ACTION / ENTRY-EXIT ===
+// ======================================
+
+/**
+ * @brief Countdown chỉ chạy khi quạt đang quay (mode != 0)
+ */
+static uint8_t Guard_FanRunning(void) {
+    return device.mode != 0;
+}
+
+
+/**
+ * @brief Nút PA7/PB0/PB1: đặt countdown 10/20/30 s
+ */
+static void Act_StartCountdown(uint8_t event) {
+    static const uint8_t seconds[FSM_EV_BUTTONS] = { 0, 10, 20, 30 };
+
+    device.countdown = seconds[event];
+    device.hold_mode = 1;
+}
+
+
+/**
+ * @brief Mỗi giây trong COUNTDOWN: giảm bộ đếm, về 0 thì phát FSM_EV_TIMEOUT
+ */
+static void Act_CountdownTick(uint8_t event) {
+    (void)event;
+    if (--device.countdown == 0) fsm_pending = FSM_EV_TIMEOUT;
+}
+
+
+/**
+ * @brief Bật lại hệ thống: bắt đầu ở mode 1 cho tới lần đọc ADC kế tiếp
+ */
+static void Act_PowerOn(uint8_t event) {
+    (void)event;
+    device.mode = 1;
+    device.hold_mode = 1;
+}
+
+
+static void Entry_ClearCountdown(void) {
+    device.countdown = 0;
+}
+
+
+/**
+ * @brief Vào OFF: dừng quạt, tắt LED và tắt các nút countdown
+ *        (không đánh thức CPU khỏi Stop mode khi đang OFF)
+ */
+static void Entry_Off(void) {
+    device.countdown = 0;
+    device.mode = 0;
+
+    LED_Update(0);            // Tắt LED
+    Update_PWM_From_Mode(0);  // Dừng PWM
+    Buttons_EnableCountdown(0);
+}
+
+
+static void Exit_Off(void) {
+    Buttons_EnableCountdown(1);
+}
+
+
+// ======================================
+// ============ BẢNG TRẠNG THÁI ==========
+// ======================================
+
+const Fsm_StateInfo fsm_states[FSM_ST_COUNT] = {
+    [FSM_ST_READY]     = { "READY",     Entry_ClearCountdown, 0,        0 },
+    [FSM_ST_COUNTDOWN] = { "COUNTDOWN", 0,                    0,        1 },
+    [FSM_ST_OFF]       = { "OFF",       Entry_Off,            Exit_Off, 0 },
+    [FSM_ST_RUN]       = { "RUN",       Entry_ClearCountdown, 0,        1 },
+};
+
+const char* const fsm_event_names[FSM_EV_COUNT] = {
+    [FSM_EV_POWER]   = "POWER",
+    [FSM_EV_10S]     = "10S",
+    [FSM_EV_20S]     = "20S",
+    [FSM_EV_30S]     = "30S",
+    [FSM_EV_SECOND]  = "SECOND",
+    [FSM_EV_TIMEOUT] = "TIMEOUT",
+};
+
+#define NONE         { FSM_ST_NONE, 0, 0 }
+#define GO(st)       { (st), 0, 0 }
+#define COUNT_FROM   { FSM_ST_COUNTDOWN, 0, Act_StartCountdown }
+
+// Ghi rõ mọi ô: ô bị bỏ sót sẽ là {0} = chuyển sang READY (sim -s kiểm tra toàn bộ bảng)
+const Fsm_Transition fsm_table[FSM_ST_COUNT][FSM_EV_COUNT] = {
+    [FSM_ST_READY] = {
+        [FSM_EV_POWER]   = GO(FSM_ST_OFF),
+        [FSM_EV_10S]     = COUNT_FROM,
+        [FSM_EV_20S]     = COUNT_FROM,
+        [FSM_EV_30S]     = COUNT_FROM,
+        [FSM_EV_SECOND]  = NONE,
+        [FSM_EV_TIMEOUT] = NONE,
+    },
+    [FSM_ST_COUNTDOWN] = {
+        [FSM_EV_POWER]   = GO(FSM_ST_OFF),
+        [FSM_EV_10S]     = COUNT_FROM,      // Nhấn lại: đặt lại thời gian (chuyển nội bộ)
+        [FSM_EV_20S]     = COUNT_FROM,
+        [FSM_EV_30S]     = COUNT_FROM,
+        [FSM_EV_SECOND]  = { FSM_ST_COUNTDOWN, Guard_FanRunning, Act_CountdownTick },
+        [FSM_EV_TIMEOUT] = GO(FSM_ST_READY),
+    },
+    [FSM_ST_OFF] = {
+        [FSM_EV_POWER]   = { FSM_ST_RUN, 0, Act_PowerOn },
+        [FSM_EV_10S]     = NONE,
+        [FSM_EV_20S]     = NONE,
+        [FSM_EV_30S]     = NONE,
+        [FSM_EV_SECOND]  = NONE,
+        [FSM_EV_TIMEOUT] = NONE,
+    },
+    [FSM_ST_RUN] = {
+        [FSM_EV_POWER]   = GO(FSM_ST_OFF),
+        [FSM_EV_10S]     = COUNT_FROM,
+        [FSM_EV_20S]     = COUNT_FROM,
+        [FSM_EV_30S]     = COUNT_FROM,
+        [FSM_EV_SECOND]  = NONE,
+        [FSM_EV_TIMEOUT] = NONE,
+    },
+};
+
+#undef NONE
+#undef GO
+#undef COUNT_FROM
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Đặt trạng thái ban đầu và chạy entry action của nó
+ */
+void Fsm_Init(uint8_t state) {
+    device.state = state;
+    fsm_pending = FSM_EV_NONE;
+    if (fsm_states[state].entry) fsm_states[state].entry();
+}
+
+
+/**
+ * @brief Tra bảng và thực hiện 1 chuyển trạng thái: exit → action → entry
+ * @return 1 nếu sự kiện được chấp nhận
+ */
+static uint8_t Fsm_Step(uint8_t event) {
+    const Fsm_Transition* t = &fsm_table[device.state][event];
+    uint8_t from = device.state;
+
+    if (t->next == FSM_ST_NONE) return 0;
+    if (t->guard && !t->guard()) return 0;
+
+    if (t->next != from && fsm_states[from].exit) fsm_states[from].exit();
+    if (t->action) t->action(event);
+    device.state = t->next;
+    if (t->next != from && fsm_states[t->next].entry) fsm_states[t->next].entry();
+
+    return 1;
+}
+
+
+/**
+ * @brief Đưa 1 sự kiện vào máy trạng thái (O(1): tra trực tiếp bảng)
+ *        Sự kiện nội bộ do action phát ra được xử lý ngay sau đó.
+ * @return 1 nếu sự kiện được chấp nhận
+ */
+uint8_t Fsm_Dispatch(uint8_t event) {
+    uint8_t accepted;
+
+    if (event >= FSM_EV_COUNT) return 0;
+
+    accepted = Fsm_Step(event);
+    while (fsm_pending != FSM_EV_NONE) {
+        uint8_t next_event = fsm_pending;
+        fsm_pending = FSM_EV_NONE;
+        Fsm_Step(next_event);
+    }
+    return accepted;
+}
+
+
+/**
+ * @brief Trạng thái hiện tại có cho phép quạt/LED chạy theo mode không
+ */
+uint8_t Fsm_FanEnabled(void) {
+    return fsm_states[device.state].fan_on;
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
@@ -2,119 +2,120 @@
 // ========== FILE INCLUDE =========
 // =================================
 
-#include "stm32f4xx.h"
-#include "system.h"    // SysTick, Delay_ms, GetTick
+#include "system.h"    // SysTick, Delay_ms, Sleep_Until, sự kiện
 #include "i2c.h"       // Giao tiếp I2C
 #include "oled.h"      // OLED hiển thị
 #include "adc.h"       // Đọc ADC điều chỉnh mode
 #include "pwm.h"       // PWM output theo mode
 #include "led.h"       // LED hiển thị mode
-#include "exti.h"      // Ngắt ngoài từ nút nhấn
-
-// Biến toàn cục được định nghĩa bên ngoài
-extern volatile uint8_t mode;
-extern volatile uint8_t countdown;
-extern volatile uint8_t button_pressed;
-
+#include "exti.h"      // Nút nhấn: ngắt ngoài + hàng đợi sự kiện
+#include "sched.h"     // Bộ lập lịch tác vụ
+#include "fsm.h"       // Máy trạng thái thiết bị
+#include "cpuload.h"   // Đo tải CPU (DWT)
+#include "control.h"   // Vòng điều khiển trong ngắt TIM5
+#include "wdg.h"       // Watchdog IWDG + giám sát tác vụ
+#include "fancurve.h"  // Đường cong biến trở → duty quạt
+#include "tach.h"      // Đo tốc độ quạt (TIM3 CH1..CH4)
+#include "temp.h"      // NTC + cảm biến nhiệt bên trong, đường cong nhiệt độ
+
+// Chu kỳ vẽ OLED (µs, theo GetTimeUs64)
+#define DISPLAY_PERIOD_US     500000u
+
+// Deadline watchdog của tác vụ vẽ (ms thức): 1 frame ~0,1 s ở I2C 100 kHz, chu kỳ 0,5 s
+#define DISPLAY_WDG_DEADLINE_MS  1500u
 
 // ======================================
 // ======== FUNCTION DEFINITIONS ========
 // ======================================
 
+/**
+ * @brief Tác vụ cập nhật OLED (500 ms), luôn hiển thị kể cả khi hệ thống bị tắt.
+ *        Vẽ theo bản chụp trạng thái của vòng điều khiển (kèm nhiệt độ và tốc độ quạt 0
+ *        khi quạt được phép chạy); cpu_load_page chọn trang debug tải CPU hoặc trang tóm tắt
+ *        các quạt thay cho trạng thái.
+ *
+ * Chỉ báo còn sống cho watchdog khi mọi byte của frame đều ghi được qua I2C: bus
+ * kẹt hay OLED không trả lời ACK đều làm frame dừng ở byte lỗi đầu tiên và bị bắt,
+ * dù lỗi đó đến nhanh hay chậm.
+ */
+static void Task_Display(void) {
+    Control_Snapshot snap;
+    uint8_t tach_mask = 0;
+    uint8_t ok;
+
+    if (cpu_load_page == CPU_PAGE_LOAD) {
+        ok = SSD1306_DisplayCpuLoad(&cpu_load);
+    } else if (cpu_load_page == CPU_PAGE_FANS) {
+        Control_GetSnapshot(&snap);
+        for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) tach_mask |= (uint8_t)(Tach_Present(fan) << fan);
+        ok = SSD1306_DisplayFans(snap.permille, snap.rpm, tach_mask, HW_FAN_COUNT) &&
+             SSD1306_DisplayTemp(7, snap.ntc_dc, snap.die_dc, snap.temp_auto);
+    } else {
+        Control_GetSnapshot(&snap);
+        ok = SSD1306_DisplayState(snap.state, snap.mode, snap.countdown);
+        if (ok && fsm_states[snap.state].fan_on) {
+            ok = SSD1306_DisplayTemp(6, snap.ntc_dc, snap.die_dc, snap.temp_auto) &&
+                 SSD1306_DisplayRpm(snap.rpm[0], snap.target_rpm);
+        }
+    }
+
+    if (ok) Wdg_CheckIn(WDG_DISPLAY);   // Vẽ xong cả frame: bus I2C không bị kẹt
+}
+
+
 /**
  * @brief Hàm main – khởi tạo hệ thống và xử lý vòng lặp chính
  */
 int main(void) {
     // ======== Khởi tạo toàn bộ ngoại vi ========
     SysTick_Init();        // Delay + GetTick
+    CpuLoad_Init();        // Bộ đếm chu kỳ DWT
+    Wdg_Init();            // Nguyên nhân reset + bật IWDG (SysTick nạp lại)
     I2C1_Init();           // Giao tiếp OLED
-    ADC_Init();            // Đọc biến trở
+    ADC_Init();            // Quét biến trở, NTC, cảm biến nhiệt (DMA)
     PWM_Init();            // PWM qua TIM4
+    FanCurve_Init();       // Đường cong quạt mặc định
+    Temp_Init();           // Hiệu chuẩn cảm biến nhiệt, đường cong nhiệt độ mặc định
+    Tach_Init();           // Tach quạt qua TIM3 input capture
     LED_Init();            // PA1, PA2, PA3
     GPIO_EXTI_Init();      // Ngắt ngoài từ nút nhấn
+    SSD1306_Init();        // Chuỗi lệnh khởi tạo OLED (bật charge pump, Display ON)
+    RTC_Init();            // Đồng hồ LSE cho Stop mode
 
     // ======== Hiển thị khởi động ban đầu ========
     SSD1306_Clear();
     SSD1306_PrintTextCentered(3, "SYSTEM READY");
+    if (wdg_stats.iwdg_reset) {
+        // Lần chạy trước bị watchdog reset: báo tác vụ đã treo
+        SSD1306_PrintTextCentered(5, "WDG RESET");
+        SSD1306_PrintTextCentered(6, Wdg_Name(wdg_stats.last_stalled));
+    }
     Delay_ms(2000);
-    oled_state = 3;  // Chuyển sang trạng thái "INFINITE"
+    Fsm_Init(FSM_ST_RUN);  // Chuyển sang trạng thái "INFINITE"
 
-    // ======== Biến thời gian ========
-    uint32_t last_update = 0;       // Cập nhật PWM/LED
-    uint32_t last_countdown = 0;    // Giảm countdown
-    uint32_t last_display = 0;      // Cập nhật OLED
+    // ======== Vòng điều khiển: nút nhấn, máy trạng thái, ADC → PWM/LED ========
+    Control_Init(CONTROL_RATE_HZ);
 
-    // ======== Vòng lặp chính ========
-    while (1) {
-        uint32_t current_time = GetTick();
-
-        // Cập nhật OLED mỗi 500ms, luôn hiển thị kể cả khi hệ thống bị tắt
-        if ((current_time - last_display) >= 500) {
-            switch (oled_state) {
-                case 0: // READY
-                    SSD1306_Clear();
-                    SSD1306_PrintTextCentered(3, "SYSTEM READY");
-                    break;
-                case 1: // COUNTDOWN
-                    SSD1306_DisplayStatus(mode, countdown);
-                    break;
-                case 2: // SYSTEM STOPPED
-                    SSD1306_Clear();
-                    SSD1306_PrintTextCentered(3, "SYSTEM STOPPED");
-                    break;
-                case 3: // INFINITE MODE
-                    SSD1306_Clear();
-                    SSD1306_PrintTextCentered(2, "TIME: INF");
-
-                    char mode_str[16];
-                    sprintf(mode_str, "MODE: %d", mode);
-                    SSD1306_PrintTextCentered(4, mode_str);
-                    break;
-            }
-            last_display = current_time;
-        }
-
-        // Nếu hệ thống đang bị tắt, bỏ qua toàn bộ xử lý logic
-        if (!system_active) {
-            Delay_ms(10);
-            continue;
-        }
+    // ======== Đăng ký tác vụ giao diện ========
+    int8_t task_display = Sched_AddPeriodic("display", Task_Display, DISPLAY_PERIOD_US, 0);
+    Wdg_Register(WDG_DISPLAY, DISPLAY_WDG_DEADLINE_MS);
 
-        // Cập nhật PWM và LED mỗi 100ms
-        if ((current_time - last_update) >= 100) {
-            if (!button_pressed) {
-                // Đọc từ ADC để cập nhật mode
-                mode = Mode_Update_From_ADC();
-            } else {
-                button_pressed = 0; // Đã xử lý nút nhấn
-            }
-
-            // Cập nhật PWM và LED tương ứng nếu OLED đang hiển thị trạng thái hợp lệ
-            if (oled_state == 1 || oled_state == 3) {
-                Update_PWM_From_Mode(mode);
-                LED_Update(mode);
-            } else {
-                // Dừng PWM và tắt LED nếu không ở trạng thái active
-                TIM4->CCR2 = 0;
-                LED_Update(0);
-            }
-
-            last_update = current_time;
-        }
-
-        // Xử lý countdown mỗi 1000ms
-        if ((current_time - last_countdown) >= 1000) {
-            if (oled_state == 1 && countdown > 0 && mode != 0) {
-                countdown--;
-                if (countdown == 0) {
-                    oled_state = 0; // Trở lại trạng thái "READY"
-                }
-            }
-            last_countdown = current_time;
+    // ======== Vòng lặp chính (chỉ còn giao diện) ========
+    while (1) {
+        uint64_t next;
+
+        // Vòng điều khiển đã xử lý nút nhấn: vẽ lại màn hình ngay, không đợi chu kỳ kế
+        CpuLoad_Update();
+        if (System_TakeEvents() & EVT_UI) Sched_RunNow(task_display);
+
+        // Chạy đúng 1 tác vụ đến hạn, rồi ngủ tới deadline kế tiếp hoặc sự kiện.
+        // Khi quạt tắt (hệ thống OFF hoặc mode 0) được ngủ sâu ở Stop mode.
+        if (Sched_RunNext()) continue;
+        if (Sched_NextDeadline(&next)) {
+            uint8_t allow_stop = Control_StopAllowed(&next);
+            Wdg_LimitSleep(&next);
+            Sleep_Until(next, allow_stop);
         }
-
-        // Delay nhỏ để giảm tần suất vòng lặp
-        Delay_ms(10);
     }
 }
 
@@ -7,6 +7,9 @@
 #include <string.h>      // Dùng strlen để tính độ dài chuỗi
 #include <stdio.h>       // Dùng sprintf để format văn bản
 #include "system.h"      // Hàm Delay_ms (trì hoãn sau khi khởi tạo)
+#include "fsm.h"         // Tên các trạng thái thiết bị
+#include "cpuload.h"     // Trang debug tải CPU
+#include "temp.h"        // TEMP_INVALID
 
 
 // =======================================
@@ -15,7 +18,7 @@
 
 /**
  * @brief Bảng font 5x8: mỗi ký tự được biểu diễn bằng 5 byte, mỗi byte là 1 cột pixel (8 dòng).
- *        Dùng để hiển thị ký tự cơ bản: chữ cái, số, khoảng trắng.
+ *        Dùng để hiển thị ký tự cơ bản: chữ cái, số, khoảng trắng, dấu trừ (nhiệt độ âm).
  *        Ví dụ: chữ 'A' ứng với 5 cột dữ liệu hiển thị.
  */
 const uint8_t font5x8[][5] = {
@@ -88,7 +91,10 @@ const uint8_t font5x8[][5] = {
     {0x06,0x49,0x49,0x29,0x1E}, // 9
 
     // Space (62)
-    {0x00,0x00,0x00,0x00,0x00}
+    {0x00,0x00,0x00,0x00,0x00},
+
+    // Dấu trừ (63)
+    {0x08,0x08,0x08,0x08,0x08}
 };
 
 
@@ -153,45 +159,65 @@ uint8_t SSD1306_Init(void) {
  * @brief Đặt con trỏ pixel tại vị trí (col, page) để chuẩn bị vẽ dữ liệu
  * @param col Cột (0–127)
  * @param page Dòng theo trang (0–7), mỗi trang là 8 pixel theo chiều dọc
+ * @return 1 nếu thành công, 0 nếu lỗi
  */
-void SSD1306_SetCursor(uint8_t col, uint8_t page) {
-    SSD1306_Command(0xB0 + page);             // Lệnh chọn page (dòng)
-    SSD1306_Command(0x00 + (col & 0x0F));     // Cột - 4 bit thấp
-    SSD1306_Command(0x10 + ((col >> 4) & 0x0F)); // Cột - 4 bit cao
+uint8_t SSD1306_SetCursor(uint8_t col, uint8_t page) {
+    return SSD1306_Command(0xB0 + page) &&              // Lệnh chọn page (dòng)
+           SSD1306_Command(0x00 + (col & 0x0F)) &&      // Cột - 4 bit thấp
+           SSD1306_Command(0x10 + ((col >> 4) & 0x0F)); // Cột - 4 bit cao
 }
 
 
 /**
  * @brief Xóa toàn bộ màn hình OLED (vẽ toàn bộ bằng màu đen)
+ * @return 1 nếu thành công, 0 nếu lỗi (dừng ngay ở byte lỗi đầu tiên)
  */
-void SSD1306_Clear(void) {
+uint8_t SSD1306_Clear(void) {
     for (uint8_t page = 0; page < 8; page++) {
-        SSD1306_SetCursor(0, page); // Di chuyển tới đầu mỗi dòng
+        if (!SSD1306_SetCursor(0, page)) return 0;   // Di chuyển tới đầu mỗi dòng
         for (uint8_t col = 0; col < 128; col++) {
-            SSD1306_Data(0x00);     // Gửi giá trị 0 để tắt tất cả pixel
+            if (!SSD1306_Data(0x00)) return 0;       // Gửi giá trị 0 để tắt tất cả pixel
         }
     }
+    return 1;
 }
 
 
 /**
  * @brief In 1 ký tự ra màn hình OLED tại vị trí hiện tại
  * @param ch Ký tự ASCII cần hiển thị ('A'–'Z', 'a'–'z', '0'–'9', ...)
+ * @return 1 nếu thành công, 0 nếu lỗi
  */
-void SSD1306_PrintChar(char ch) {
+uint8_t SSD1306_PrintChar(char ch) {
     const uint8_t* chr;
 
     // Chọn dữ liệu font tương ứng với ký tự
     if (ch >= 'A' && ch <= 'Z')       chr = font5x8[ch - 'A'];
     else if (ch >= 'a' && ch <= 'z')  chr = font5x8[ch - 'a' + 26];
     else if (ch >= '0' && ch <= '9')  chr = font5x8[ch - '0' + 52];
+    else if (ch == '-')               chr = font5x8[63];
     else                              chr = font5x8[62];  // space
 
     // Gửi 5 byte bitmap của ký tự
-    for (int i = 0; i < 5; i++) SSD1306_Data(chr[i]);
+    for (int i = 0; i < 5; i++) {
+        if (!SSD1306_Data(chr[i])) return 0;
+    }
 
     // Gửi thêm 1 cột trắng (khoảng cách giữa các ký tự)
-    SSD1306_Data(0x00);
+    return SSD1306_Data(0x00);
+}
+
+
+/**
+ * @brief In chuỗi ký tự bắt đầu từ cột `col` tại dòng `page`
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+static uint8_t SSD1306_PrintTextAt(uint8_t col, uint8_t page, const char* str) {
+    if (!SSD1306_SetCursor(col, page)) return 0;        // Di chuyển con trỏ tới cột đầu
+    while (*str) {
+        if (!SSD1306_PrintChar(*str++)) return 0;       // In từng ký tự
+    }
+    return 1;
 }
 
 
@@ -199,12 +225,12 @@ void SSD1306_PrintChar(char ch) {
  * @brief In một chuỗi ký tự canh giữa theo chiều ngang tại 1 dòng (page)
  * @param page Dòng cần in (0–7)
  * @param str Chuỗi ký tự cần hiển thị
+ * @return 1 nếu thành công, 0 nếu lỗi
  */
-void SSD1306_PrintTextCentered(uint8_t page, const char* str) {
+uint8_t SSD1306_PrintTextCentered(uint8_t page, const char* str) {
     uint8_t len = strlen(str);                 // Tính độ dài chuỗi
-    uint8_t col = (128 - len * 6) / 2;         // Tính vị trí canh giữa (5 byte font + 1 byte khoảng trắng)
-    SSD1306_SetCursor(col, page);              // Di chuyển con trỏ tới vị trí canh giữa
-    while (*str) SSD1306_PrintChar(*str++);    // In từng ký tự
+    uint8_t col = (len * 6 < 128) ? (128 - len * 6) / 2 : 0;   // Canh giữa (5 byte font + 1 byte khoảng trắng); dài quá thì từ cột 0
+    return SSD1306_PrintTextAt(col, page, str);
 }
 
 
@@ -212,23 +238,150 @@ void SSD1306_PrintTextCentered(uint8_t page, const char* str) {
  * @brief Hiển thị trạng thái thiết bị (mode hiện tại và thời gian)
  * @param current_mode Chế độ hiện tại (ví dụ: 1–3)
  * @param seconds_left Số giây còn lại (nếu = 0 thì hiển thị READY)
+ * @return 1 nếu thành công, 0 nếu lỗi
  */
-void SSD1306_DisplayStatus(uint8_t current_mode, uint8_t seconds_left) {
+uint8_t SSD1306_DisplayStatus(uint8_t current_mode, uint8_t seconds_left) {
     char buffer[32];                        // Chuỗi tạm để format thông tin
 
-    SSD1306_Clear();                        // Xóa toàn bộ màn hình
+    if (!SSD1306_Clear()) return 0;         // Xóa toàn bộ màn hình
 
-    SSD1306_PrintTextCentered(1, "DEVICE STATUS"); // In tiêu đề
+    if (!SSD1306_PrintTextCentered(1, "DEVICE STATUS")) return 0; // In tiêu đề
 
     sprintf(buffer, "MODE %d", current_mode);      // Ghi mode hiện tại
-    SSD1306_PrintTextCentered(3, buffer);
+    if (!SSD1306_PrintTextCentered(3, buffer)) return 0;
 
     if (seconds_left > 0)
         sprintf(buffer, "TIME %ds", seconds_left); // Ghi thời gian đếm ngược
     else
         sprintf(buffer, "READY");                  // Nếu hết giờ thì báo sẵn sàng
 
-    SSD1306_PrintTextCentered(5, buffer);
+    return SSD1306_PrintTextCentered(5, buffer);
+}
+
+
+/**
+ * @brief Vẽ lại toàn bộ màn hình theo trạng thái thiết bị
+ * @param state Trạng thái (Fsm_State): READY, COUNTDOWN, OFF (SYSTEM STOPPED), RUN (INFINITE)
+ * @param current_mode Chế độ hiện tại (0–3)
+ * @param seconds_left Số giây đếm ngược còn lại (chỉ dùng ở trạng thái COUNTDOWN)
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+uint8_t SSD1306_DisplayState(uint8_t state, uint8_t current_mode, uint8_t seconds_left) {
+    char mode_str[16];
+
+    switch (state) {
+        case FSM_ST_READY:
+            return SSD1306_Clear() && SSD1306_PrintTextCentered(3, "SYSTEM READY");
+        case FSM_ST_COUNTDOWN:
+            return SSD1306_DisplayStatus(current_mode, seconds_left);
+        case FSM_ST_OFF:
+            return SSD1306_Clear() && SSD1306_PrintTextCentered(3, "SYSTEM STOPPED");
+        case FSM_ST_RUN:
+            sprintf(mode_str, "MODE: %d", current_mode);
+            return SSD1306_Clear() &&
+                   SSD1306_PrintTextCentered(2, "TIME: INF") &&
+                   SSD1306_PrintTextCentered(4, mode_str);
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Ghi tốc độ quạt đo bằng tach ở dòng cuối (gọi sau SSD1306_DisplayState)
+ * @param rpm Vòng/phút, 0 khi quạt đứng
+ * @param target RPM đặt của vòng kín ("RPM <đo> SET <đặt>"; font không có '/'),
+ *               0: chỉ in RPM đo
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+uint8_t SSD1306_DisplayRpm(uint32_t rpm, uint32_t target) {
+    char buffer[32];
+
+    if (target) sprintf(buffer, "RPM %lu SET %lu", (unsigned long)rpm, (unsigned long)target);
+    else sprintf(buffer, "RPM %lu", (unsigned long)rpm);
+    return SSD1306_PrintTextCentered(7, buffer);
+}
+
+
+/**
+ * @brief Ghi nhiệt độ NTC và chip ở dòng `page`, kèm "AUTO" khi quạt chạy theo
+ *        nhiệt độ ("NTC ERR" khi NTC chập/hở, "CPU ERR" khi chưa đo được nhiệt độ chip)
+ * @param ntc_dc, die_dc Nhiệt độ (0,1 °C), in làm tròn tới 1 °C
+ *
+ * Dòng chỉ chứa 21 ký tự: khi cả 2 nhiệt độ đều 3 ký tự ("105", "-12") thì "AUTO"
+ * rút lại còn "A".
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+uint8_t SSD1306_DisplayTemp(uint8_t page, int16_t ntc_dc, int16_t die_dc, uint8_t automatic) {
+    char buffer[32];
+    char ntc_str[12];
+    char die_str[12];
+
+    if (ntc_dc == TEMP_INVALID) sprintf(ntc_str, "NTC ERR");
+    else sprintf(ntc_str, "NTC %dC", (ntc_dc >= 0 ? ntc_dc + 5 : ntc_dc - 5) / 10);
+
+    // Chưa có khối mẫu ADC nào (ADC không chạy từ lúc khởi động) thì chưa có nhiệt độ chip
+    if (die_dc == TEMP_INVALID) sprintf(die_str, "CPU ERR");
+    else sprintf(die_str, "CPU %dC", (die_dc >= 0 ? die_dc + 5 : die_dc - 5) / 10);
+
+    sprintf(buffer, "%s %s%s", ntc_str, die_str, automatic ? " AUTO" : "");
+    if (strlen(buffer) > 21) sprintf(buffer, "%s %s A", ntc_str, die_str);
+    return SSD1306_PrintTextCentered(page, buffer);
+}
+
+
+/**
+ * @brief Trang tóm tắt các quạt: dòng 0 tiêu đề, rồi mỗi quạt 1 dòng
+ *        "F<n> <duty> PCT <rpm> RPM" ("NO TACH" khi quạt không có tach; font
+ *        chỉ có chữ và số nên không dùng '%')
+ * @param permille Duty từng quạt (‰)
+ * @param rpm Tốc độ từng quạt đo bằng tach
+ * @param tach_mask Bit i: quạt i có tach
+ * @param count Số quạt (≤ 6 dòng; tới 3 quạt thì cách 1 dòng cho dễ đọc)
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+uint8_t SSD1306_DisplayFans(const uint16_t* permille, const uint16_t* rpm, uint8_t tach_mask, uint8_t count) {
+    char buffer[32];
+    uint8_t step = (count <= 3) ? 2 : 1;
+
+    if (!SSD1306_Clear() || !SSD1306_PrintTextCentered(0, "FANS")) return 0;
+
+    for (uint8_t fan = 0; fan < count && fan < 6; fan++) {
+        if (tach_mask & (1u << fan)) {
+            sprintf(buffer, "F%u %3u PCT %5u RPM", fan + 1, (permille[fan] + 5) / 10, rpm[fan]);
+        } else {
+            sprintf(buffer, "F%u %3u PCT   NO TACH", fan + 1, (permille[fan] + 5) / 10);
+        }
+        if (!SSD1306_PrintTextAt(0, 2 + fan * step, buffer)) return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief Trang debug: tải CPU của cửa sổ 1 s gần nhất
+ *        Dòng 0: tổng tỉ lệ bận (%); dòng 2–7: từng ngữ cảnh (trừ idle) theo 2 cột,
+ *        mỗi ô "tên(7 ký tự) + %" rộng 60 pixel
+ * @param load Thống kê từ CpuLoad_Update
+ * @return 1 nếu thành công, 0 nếu lỗi
+ */
+uint8_t SSD1306_DisplayCpuLoad(const CpuLoad_Stats* load) {
+    char buffer[24];
+    uint8_t cell = 0;
+
+    if (!SSD1306_Clear()) return 0;
+
+    sprintf(buffer, "CPU BUSY %u PCT", (load->busy_permille + 5) / 10);
+    if (!SSD1306_PrintTextCentered(0, buffer)) return 0;
+
+    for (uint8_t slot = CPU_SLOT_IDLE + 1; slot < CPU_SLOT_COUNT && cell < 12; slot++) {
+        const char* name = CpuLoad_SlotName(slot);
+        if (!name) continue;
+
+        sprintf(buffer, "%-7.7s%3u", name, (load->permille[slot] + 5) / 10);
+        if (!SSD1306_PrintTextAt((cell & 1) ? 64 : 0, 2 + cell / 2, buffer)) return 0;
+        cell++;
+    }
+    return 1;
 }
 
 
@@ -0,0 +1,96 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "pid.h"
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+static int32_t Pid_Saturate(int64_t v) {
+    if (v > INT32_MAX) return INT32_MAX;
+    if (v < INT32_MIN) return INT32_MIN;
+    return (int32_t)v;
+}
+
+
+/**
+ * @brief Đổi thông số chỉnh sang hệ số theo bước cho tần số chạy `rate_hz`, rồi
+ *        đặt lại trạng thái với đầu ra 0 (gọi ngoài ISR hoặc khi đã che ngắt)
+ *
+ * Mọi phép chia làm ở đây; Pid_Step chỉ còn nhân, cộng và dịch.
+ */
+void Pid_Init(Pid* pid, const Pid_Tuning* tuning, uint32_t rate_hz) {
+    if (!rate_hz) rate_hz = 1;
+
+    pid->kp = tuning->kp;
+    pid->ki_step = (int32_t)(((int64_t)tuning->ki + (int64_t)(rate_hz / 2)) / (int64_t)rate_hz);
+    pid->kd_step = Pid_Saturate((int64_t)tuning->kd * rate_hz);
+    pid->out_max = (int32_t)(tuning->out_max > 65536u ? 65536u : tuning->out_max);
+    pid->slew_step = (int32_t)((tuning->slew + rate_hz / 2) / rate_hz);
+    if (!tuning->slew || pid->slew_step > 65536) pid->slew_step = 65536;   // Không giới hạn
+    if (!pid->slew_step) pid->slew_step = 1;
+
+    Pid_Reset(pid, 0);
+}
+
+
+/**
+ * @brief Đặt lại bộ PID để lần chạy kế tiếp tiếp tục từ đầu ra `out` (chuyển chế độ
+ *        không giật: tích phân nhận luôn giá trị đó). Pid_Reset(pid, 0): quạt vừa bật.
+ */
+void Pid_Reset(Pid* pid, int32_t out) {
+    if (out < 0) out = 0;
+    if (out > pid->out_max) out = pid->out_max;
+
+    pid->out = out;
+    pid->integ = (int64_t)out << 16;
+    pid->primed = 0;
+}
+
+
+/**
+ * @brief 1 bước PID
+ * @param setpoint Giá trị đặt (RPM)
+ * @param meas Giá trị đo (RPM)
+ * @return Duty Q16 trong [0, out_max]
+ *
+ * u = kp·e + ∑ki·e − kd·Δmeas. Chống bão hòa tích phân: tích phân bị kẹp trong
+ * [0, out_max] và không được cộng thêm khi đầu ra đang bị giới hạn (biên hoặc slew)
+ * theo đúng chiều của sai số.
+ * Tất cả tính bằng số nguyên 64-bit (SMULL/SMLAL trên Cortex-M4), không có float.
+ */
+int32_t Pid_Step(Pid* pid, int32_t setpoint, int32_t meas) {
+    int32_t err = setpoint - meas;
+    int64_t integ = pid->integ + (int64_t)pid->ki_step * err;
+    int64_t u = (int64_t)pid->kp * err + integ;   // Q32
+    int32_t want, out;
+
+    if (pid->primed) u -= (int64_t)pid->kd_step * (meas - pid->prev_meas);
+    pid->prev_meas = meas;
+    pid->primed = 1;
+
+    want = Pid_Saturate(u >> 16);
+    out = want;
+    if (out > pid->out_max) out = pid->out_max;
+    if (out < 0) out = 0;
+    if (out > pid->out + pid->slew_step) out = pid->out + pid->slew_step;
+    if (out < pid->out - pid->slew_step) out = pid->out - pid->slew_step;
+
+    // Đầu ra bị chặn phía trên mà sai số còn dương (hoặc ngược lại): giữ nguyên tích phân
+    if (!((want > out && err > 0) || (want < out && err < 0))) {
+        if (integ < 0) integ = 0;
+        if (integ > ((int64_t)pid->out_max << 16)) integ = (int64_t)pid->out_max << 16;
+        pid->integ = integ;
+    }
+
+    pid->out = out;
+    return out;
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
@@ -2,74 +2,313 @@
 // ========== FILE INCLUDE =======
 // ===============================
 
-#include "stm32f4xx.h"   // Thư viện CMSIS cho STM32F4
+#include "hw.h"          // Lớp truy cập phần cứng
 #include "pwm.h"         // Header cho pwm.c (khai báo PWM_Init, Update_PWM_From_Mode)
 
 
+Pwm_Timing pwm_timing;
+
+// Duty (‰) của từng mode
+static const uint16_t mode_permille[4] = { 0, 400, 700, 1000 };
+
+// Profile ramp mặc định: khởi động mềm chữ S, tăng/giảm giới hạn tốc độ, dừng tức thời
+// (OFF và quạt kẹt cần cắt ngay)
+Pwm_Ramp pwm_ramps[PWM_RAMP_KIND_COUNT] = {
+    [PWM_RAMP_START] = { 1000, PWM_SHAPE_SCURVE },
+    [PWM_RAMP_UP]    = { 600,  PWM_SHAPE_SCURVE },
+    [PWM_RAMP_DOWN]  = { 600,  PWM_SHAPE_LINEAR },
+    [PWM_RAMP_STOP]  = { 0,    PWM_SHAPE_LINEAR },
+};
+
+// Ramp đang chạy của từng quạt: chỉ vòng điều khiển (TIM5) gọi PWM_RampTo/PWM_RampStep;
+// các hàm ghi duty trực tiếp (PWM_SetQ16, PWM_SetPermille) hủy ramp của quạt đó.
+// Dạng mảng theo quạt để PWM_RampStep đi qua mọi quạt trong 1 vòng lặp ngắn.
+static struct {
+    uint32_t from[HW_FAN_COUNT], to[HW_FAN_COUNT];   // Duty Q16 đầu và cuối
+    uint32_t out[HW_FAN_COUNT];                      // Duty Q16 ghi lần gần nhất
+    uint32_t pos[HW_FAN_COUNT], inc[HW_FAN_COUNT];   // Tiến độ Q16 (65536 = xong) và bước tăng mỗi lần PWM_RampStep
+    uint8_t shape[HW_FAN_COUNT];
+    uint8_t active;                                  // Bit i: quạt i đang ramp
+} ramp;
+static uint32_t ramp_step_hz = PWM_RAMP_STEP_HZ;
+
+
 // =======================================
 // ========== FUNCTION DEFINITIONS =======
 // =======================================
 
 /**
- * @brief Khởi tạo TIM4 kênh 2 để tạo tín hiệu PWM trên chân PB7
+ * @brief Tìm PSC/ARR cho tần số `target_hz` với độ phân giải lớn nhất
+ *
+ *     f_PWM = timer_hz / ((PSC + 1) * (ARR + 1))
+ *
+ * Chọn PSC nhỏ nhất để số tick 1 chu kỳ (ARR + 1) vừa ≤ PWM_PERIOD_MAX, rồi chọn
+ * ARR + 1 (làm tròn lên hoặc xuống) cho tần số gần target nhất. Chỉ nhân 64-bit
+ * để so sánh, không có phép chia 64-bit (tốn kém trên Cortex-M4).
  *
- * TIM4_CH2 được ánh xạ với PB7 (Alternate Function 2 - AF2)
- * Tần số PWM được tính bởi:
- *     f_PWM = f_APB1 / ((PSC + 1) * (ARR + 1))
- * Với f_APB1 = 16 MHz, PSC = 1599, ARR = 100 → f_PWM ≈ 100 Hz
+ * @return 1 nếu tìm được (ít nhất 2 mức duty), 0 nếu target quá cao hoặc quá thấp
+ */
+uint8_t PWM_Solve(uint32_t timer_hz, uint32_t target_hz, Pwm_Timing* out) {
+    uint32_t ticks, div, unit, period;
+
+    if (!target_hz || target_hz > timer_hz / 2) return 0;
+
+    // Tổng số tick timer trong 1 chu kỳ PWM (làm tròn)
+    ticks = (timer_hz + target_hz / 2) / target_hz;
+
+    div = (ticks + PWM_PERIOD_MAX - 1) / PWM_PERIOD_MAX;   // PSC + 1 nhỏ nhất
+    if (div > 65536u) return 0;
+
+    // f(p) = timer_hz / (div · p) với p = ARR + 1. Giữa p và p + 1, chọn p + 1 khi
+    // f(p) − target > target − f(p + 1) ⇔ timer_hz · (2p + 1) > 2 · unit · p · (p + 1)
+    unit = div * target_hz;                                // ≤ timer_hz + target_hz: không tràn
+    period = timer_hz / unit;                              // ≥ 2 vì target ≤ timer_hz / 2
+    if ((uint64_t)timer_hz * (2 * period + 1) > 2ull * unit * period * (period + 1)) period++;
+    if (period > PWM_PERIOD_MAX) period = PWM_PERIOD_MAX;
+    if (period < 2) return 0;
+
+    out->psc = (uint16_t)(div - 1);
+    out->arr = (uint16_t)(period - 1);
+    out->freq_hz = (timer_hz + div * period / 2) / (div * period);
+    return 1;
+}
+
+
+/**
+ * @brief Khởi tạo TIM4 để tạo tín hiệu PWM PWM_FREQ_HZ cho mọi quạt
+ *
+ * Quạt 0: TIM4_CH2 trên PB7, quạt 1: TIM4_CH1 trên PB6 (Alternate Function 2 - AF2).
+ * Với clock timer 16 MHz: PSC = 0, ARR = 639 → đúng 25 kHz, 640 mức duty.
  */
 void PWM_Init(void) {
-    // Bật clock cho GPIOB (PB7)
-    RCC->AHB1ENR |= (1 << 1);  // GPIOBEN = 1
+    PWM_Config(PWM_FREQ_HZ);
+}
 
-    // Bật clock cho TIM4 (trên bus APB1)
-    RCC->APB1ENR |= (1 << 2);  // TIM4EN = 1
 
-    // Cấu hình PB7 ở chế độ Alternate Function
-    GPIOB->MODER &= ~(3 << (7 * 2));   // Xóa 2 bit MODER7
-    GPIOB->MODER |=  (2 << (7 * 2));   // MODER7 = 10 (AF mode)
+/**
+ * @brief Cấu hình lại TIM4 cho tần số `freq_hz`, tính từ clock timer thực tế
+ *        (duty về 0%)
+ * @return 1 nếu thành công, 0 nếu tần số không đạt được (giữ cấu hình cũ)
+ */
+uint8_t PWM_Config(uint32_t freq_hz) {
+    Pwm_Timing t;
 
-    // Gán chức năng AF2 (TIM4_CH2) cho PB7
-    GPIOB->AFR[0] &= ~(0xF << (7 * 4)); // Xóa trước
-    GPIOB->AFR[0] |=  (2 << (7 * 4));   // AF2 cho PB7
+    if (!PWM_Solve(HW_PWM_ClockHz(), freq_hz, &t)) return 0;
 
-    // Cấu hình bộ định thời TIM4
-    TIM4->PSC = 1599;  // Prescaler: f_TIM = f_APB1 / (PSC + 1)
-    TIM4->ARR = 100;   // Auto-reload value: xác định chu kỳ PWM
-    TIM4->CCR2 = 0;    // Giá trị khởi đầu cho duty cycle = 0%
+    pwm_timing = t;
+    ramp.active = 0;
+    HW_PWM_Init(t.psc, t.arr);
+    return 1;
+}
 
-    // Cấu hình chế độ PWM mode 1 cho kênh 2
-    TIM4->CCMR1 &= ~(7 << 12);  // Xóa OC2M
-    TIM4->CCMR1 |=  (6 << 12);  // OC2M = 110 → PWM mode 1
 
-    // Kích hoạt preload cho CCR2 (đồng bộ hóa cập nhật)
-    TIM4->CCMR1 |= (1 << 11);   // OC2PE = 1
+/**
+ * @brief Đặt duty quạt `fan` theo phần nghìn (0–1000, lớn hơn bị giới hạn ở 100%),
+ *        ngay lập tức
+ *
+ * PWM mode 1: chân ở mức cao khi CNT < CCRx, nên CCRx = ARR + 1 là 100%.
+ */
+void PWM_SetPermille(uint8_t fan, uint16_t permille) {
+    uint32_t period = (uint32_t)pwm_timing.arr + 1;
 
-    // Cho phép kênh 2 xuất tín hiệu PWM ra chân PB7
-    TIM4->CCER |= (1 << 4);     // CC2E = 1
+    if (fan >= HW_FAN_COUNT) return;
+    if (permille > 1000) permille = 1000;
+    ramp.active &= (uint8_t)~(1u << fan);
+    HW_PWM_SetCompare(fan, (uint16_t)((permille * period + 500) / 1000));
+}
+
+
+/**
+ * @brief Ghi duty Q16 ra CCR của quạt `fan` (không đụng tới ramp)
+ */
+static void PWM_WriteQ16(uint8_t fan, uint32_t duty_q16) {
+    uint32_t period = (uint32_t)pwm_timing.arr + 1;
+
+    if (duty_q16 > 65536u) duty_q16 = 65536u;
+    HW_PWM_SetCompare(fan, (uint16_t)((duty_q16 * period + 32768) >> 16));  // ≤ 65536 · 65535: vừa 32-bit
+}
+
+
+/**
+ * @brief Đặt duty quạt `fan` dạng Q16 (65536 = 100%) ngay lập tức, cho bộ điều khiển
+ *        tính bằng số cố định (đã tự giới hạn tốc độ thay đổi, như PID)
+ */
+void PWM_SetQ16(uint8_t fan, uint32_t duty_q16) {
+    if (fan >= HW_FAN_COUNT) return;
+    ramp.active &= (uint8_t)~(1u << fan);
+    PWM_WriteQ16(fan, duty_q16);
+}
 
-    // Bật bộ đếm TIM4 để bắt đầu hoạt động
-    TIM4->CR1 |= (1 << 0);      // CEN = 1
+
+/**
+ * @brief Duty hiện tại của quạt `fan` theo phần nghìn (làm tròn)
+ */
+uint16_t PWM_GetPermille(uint8_t fan) {
+    uint32_t period = (uint32_t)pwm_timing.arr + 1;
+
+    if (fan >= HW_FAN_COUNT) return 0;
+    return (uint16_t)(((uint32_t)HW_PWM_GetCompare(fan) * 1000 + period / 2) / period);
 }
 
 
 /**
- * @brief Cập nhật độ rộng xung PWM theo chế độ (mode)
+ * @brief Cập nhật độ rộng xung PWM của mọi quạt theo chế độ (mode)
  *
  * @param mode Giá trị từ 0 đến 3, ứng với mức độ duty cycle:
  *             - 0: 0% (tắt)
  *             - 1: 40%
  *             - 2: 70%
  *             - 3: 100%
+ *             Giá trị không hợp lệ → OFF
  */
 void Update_PWM_From_Mode(uint8_t mode) {
-    switch (mode) {
-        case 3: TIM4->CCR2 = 100; break;  // 100% duty
-        case 2: TIM4->CCR2 = 70;  break;  // 70%
-        case 1: TIM4->CCR2 = 40;  break;  // 40%
-        case 0: TIM4->CCR2 = 0;   break;  // 0% duty (OFF)
-        default: TIM4->CCR2 = 0;  break;  // Giá trị không hợp lệ → OFF
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) PWM_SetPermille(fan, mode < 4 ? mode_permille[mode] : 0);
+}
+
+
+/**
+ * @brief Kiểm tra PWM của mọi quạt đang ở 0% (tất cả quạt tắt)
+ *
+ * Dùng để quyết định có được vào Stop mode hay không: trong Stop, TIM4 mất clock
+ * và các chân PWM bị giữ nguyên mức, nên chỉ an toàn khi không có xung ra.
+ */
+uint8_t PWM_IsIdle(void) {
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        if (HW_PWM_GetCompare(fan)) return 0;
     }
+    return 1;
+}
+
+
+/**
+ * @brief Đặt số lần gọi PWM_RampStep mỗi giây (tần số vòng điều khiển)
+ */
+void PWM_SetRampRate(uint32_t step_hz) {
+    ramp_step_hz = step_hz ? step_hz : PWM_RAMP_STEP_HZ;
+}
+
+
+/**
+ * @brief Đổi profile ramp của 1 loại chuyển
+ * @return 0 nếu loại hoặc dạng không hợp lệ (giữ profile cũ)
+ */
+uint8_t PWM_SetRamp(uint8_t kind, uint16_t full_ms, uint8_t shape) {
+    if (kind >= PWM_RAMP_KIND_COUNT || shape >= PWM_SHAPE_COUNT) return 0;
+
+    uint32_t primask = HW_IRQ_Save();
+    pwm_ramps[kind].full_ms = full_ms;
+    pwm_ramps[kind].shape = shape;
+    HW_IRQ_Restore(primask);
+    return 1;
+}
+
+
+/**
+ * @brief Giá trị dạng ramp tại tiến độ t (Q16, 0..65536), kết quả Q16
+ */
+static uint32_t PWM_Shape(uint8_t shape, uint32_t t) {
+    uint32_t t2 = (t * t) >> 16;   // t < 65536 (ramp chưa xong): vừa 32-bit
+
+    switch (shape) {
+        case PWM_SHAPE_EASE_IN: return t2;
+        case PWM_SHAPE_SCURVE:  return 3 * t2 - 2 * ((t2 * t) >> 16);
+        default:                return t;
+    }
+}
+
+
+/**
+ * @brief Chuyển duty quạt `fan` tới `duty_q16` theo profile của loại chuyển
+ *        (START/UP/DOWN/STOP)
+ *
+ * Thời gian ramp tỉ lệ với độ lớn bước: full_ms cho 0% ↔ 100%, nên profile đồng thời
+ * là giới hạn tốc độ thay đổi duty. Đích đổi khi đang ramp (biến trở vặn liên tục):
+ * đi tiếp từ duty hiện tại theo đường thẳng, vì bắt đầu lại đường cong mỗi chu kỳ sẽ
+ * làm duty gần như đứng yên. Gọi trước PWM_RampStep trong cùng chu kỳ điều khiển.
+ */
+void PWM_RampTo(uint8_t fan, uint32_t duty_q16) {
+    uint32_t period = (uint32_t)pwm_timing.arr + 1;
+    uint8_t bit = (uint8_t)(1u << fan);
+    uint32_t from, delta, steps;
+    const Pwm_Ramp* profile;
+
+    if (fan >= HW_FAN_COUNT) return;
+    if (duty_q16 > 65536u) duty_q16 = 65536u;
+    if (ramp.active & bit) {
+        if (duty_q16 == ramp.to[fan]) return;
+        from = ramp.out[fan];
+    } else {
+        uint32_t ccr = HW_PWM_GetCompare(fan);
+
+        // Cùng mức CCR với đích: không cần ramp (trường hợp thường gặp mỗi chu kỳ)
+        if (((duty_q16 * period + 32768) >> 16) == ccr) return;
+        // Duty đang ra (có thể do PWM_SetQ16/SetPermille ghi): tính ngược từ CCR
+        from = ((ccr << 16) + period / 2) / period;
+        if (from > 65536u) from = 65536u;
+    }
+
+    if (from == 0) profile = &pwm_ramps[PWM_RAMP_START];
+    else if (duty_q16 == 0) profile = &pwm_ramps[PWM_RAMP_STOP];
+    else if (duty_q16 > from) profile = &pwm_ramps[PWM_RAMP_UP];
+    else profile = &pwm_ramps[PWM_RAMP_DOWN];
+
+    delta = (duty_q16 > from) ? duty_q16 - from : from - duty_q16;
+    steps = (uint32_t)(((uint64_t)profile->full_ms * ramp_step_hz * delta + 500ull * 65536) / (1000ull * 65536));
+    if (steps <= 1) {
+        ramp.active &= (uint8_t)~bit;
+        PWM_WriteQ16(fan, duty_q16);
+        return;
+    }
+
+    ramp.shape[fan] = (ramp.active & bit) ? PWM_SHAPE_LINEAR : profile->shape;
+    ramp.from[fan] = from;
+    ramp.to[fan] = duty_q16;
+    ramp.out[fan] = from;
+    ramp.pos[fan] = 0;
+    ramp.inc[fan] = 65536u / steps;
+    if (!ramp.inc[fan]) ramp.inc[fan] = 1;
+    ramp.active |= bit;
+}
+
+
+/**
+ * @brief Ramp quạt `fan` theo mode (0–3) như Update_PWM_From_Mode
+ */
+void PWM_RampToMode(uint8_t fan, uint8_t mode) {
+    PWM_RampTo(fan, mode < 4 ? ((uint32_t)mode_permille[mode] * 65536 + 500) / 1000 : 0);
+}
+
+
+/**
+ * @brief 1 bước ramp của mọi quạt: gọi 1 lần mỗi chu kỳ điều khiển (ISR TIM5), không chia
+ */
+void PWM_RampStep(void) {
+    if (!ramp.active) return;
+
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        uint32_t s, from = ramp.from[fan], to = ramp.to[fan];
+
+        if (!(ramp.active & (1u << fan))) continue;
+
+        ramp.pos[fan] += ramp.inc[fan];
+        if (ramp.pos[fan] >= 65536u) {
+            ramp.out[fan] = to;
+            ramp.active &= (uint8_t)~(1u << fan);
+        } else {
+            s = PWM_Shape(ramp.shape[fan], ramp.pos[fan]);
+            if (to >= from) ramp.out[fan] = from + (uint32_t)(((uint64_t)(to - from) * s) >> 16);
+            else ramp.out[fan] = from - (uint32_t)(((uint64_t)(from - to) * s) >> 16);
+        }
+        PWM_WriteQ16(fan, ramp.out[fan]);
+    }
+}
+
+
+/**
+ * @brief Các quạt còn đang ramp (bit i: quạt i)
+ */
+uint8_t PWM_RampActive(void) {
+    return ramp.active;
 }
 
 
@@ -0,0 +1,267 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "sched.h"
+#include "system.h"   // GetTimeUs64()
+#include "cpuload.h"  // Tính chu kỳ CPU theo tác vụ
+
+
+// Bảng tác vụ và min-heap chỉ số tác vụ, sắp theo deadline (gốc = đến hạn sớm nhất)
+static Sched_Task tasks[SCHED_MAX_TASKS];
+static uint8_t heap[SCHED_MAX_TASKS];
+static uint8_t heap_size = 0;
+
+// Histogram độ trễ của các tác vụ định kỳ (đọc bằng debugger: dump binary value … sched_jitter)
+Sched_JitterLog sched_jitter = { SCHED_JITTER_MAGIC, SCHED_MAX_TASKS };
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief So sánh 2 tác vụ theo deadline (µs 64-bit, không tràn).
+ *        Cùng deadline thì tác vụ đăng ký trước chạy trước.
+ */
+static uint8_t Sched_Before(uint8_t a, uint8_t b) {
+    return (tasks[a].deadline < tasks[b].deadline)
+        || (tasks[a].deadline == tasks[b].deadline && a < b);
+}
+
+
+/**
+ * @brief Làm tròn lên tới biên ms kế tiếp. CPU chỉ thức dậy ở ngắt SysTick (đầu
+ *        mỗi ms), nên deadline lệch biên sẽ bị trễ thêm gần 1 ms mỗi lần chạy.
+ */
+static uint64_t Sched_AlignMs(uint64_t t) {
+    return (t + 999) / 1000 * 1000;
+}
+
+
+static void Sched_Swap(uint8_t i, uint8_t j) {
+    uint8_t tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+
+static void Sched_SiftUp(uint8_t i) {
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!Sched_Before(heap[i], heap[parent])) break;
+        Sched_Swap(i, parent);
+        i = parent;
+    }
+}
+
+
+static void Sched_SiftDown(uint8_t i) {
+    while (1) {
+        uint8_t left = 2 * i + 1;
+        uint8_t right = left + 1;
+        uint8_t best = i;
+
+        if (left < heap_size && Sched_Before(heap[left], heap[best])) best = left;
+        if (right < heap_size && Sched_Before(heap[right], heap[best])) best = right;
+        if (best == i) break;
+
+        Sched_Swap(i, best);
+        i = best;
+    }
+}
+
+
+/**
+ * @brief Xóa phần tử thứ i khỏi heap
+ */
+static void Sched_HeapRemove(uint8_t i) {
+    heap_size--;
+    if (i == heap_size) return;
+
+    heap[i] = heap[heap_size];
+    Sched_SiftDown(i);
+    Sched_SiftUp(i);
+}
+
+
+/**
+ * @brief Chỉ số ô histogram cho độ trễ `late` (µs): số bit có nghĩa, tối đa ô cuối
+ */
+static uint8_t Sched_HistBucket(uint32_t late) {
+    uint8_t bucket = late ? (uint8_t)(32 - __builtin_clz(late)) : 0;
+    return (bucket < SCHED_HIST_BUCKETS) ? bucket : SCHED_HIST_BUCKETS - 1;
+}
+
+
+/**
+ * @brief Đăng ký tác vụ mới vào ô trống đầu tiên
+ * @return ID tác vụ, -1 nếu hết chỗ
+ */
+static int8_t Sched_Add(const char* name, Sched_TaskFn fn, uint32_t period, uint32_t delay) {
+    for (uint8_t id = 0; id < SCHED_MAX_TASKS; id++) {
+        if (tasks[id].active) continue;
+
+        tasks[id] = (Sched_Task){0};
+        tasks[id].name = name;
+        tasks[id].fn = fn;
+        tasks[id].period = period;
+        tasks[id].deadline = Sched_AlignMs(GetTimeUs64() + delay);
+        tasks[id].active = 1;
+
+        sched_jitter.job[id] = (Sched_Jitter){0};
+        sched_jitter.job[id].period = period;
+        for (uint8_t i = 0; i < SCHED_NAME_LEN && name[i]; i++) sched_jitter.job[id].name[i] = name[i];
+
+        heap[heap_size] = id;
+        Sched_SiftUp(heap_size++);
+        return (int8_t)id;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Đăng ký tác vụ chạy định kỳ
+ * @param period Chu kỳ (µs, bội số của 1000), phải > 0
+ * @param first_delay Thời gian chờ trước lần chạy đầu tiên (µs)
+ * @return ID tác vụ, -1 nếu lỗi
+ */
+int8_t Sched_AddPeriodic(const char* name, Sched_TaskFn fn, uint32_t period, uint32_t first_delay) {
+    if (period == 0) return -1;
+    return Sched_Add(name, fn, period, first_delay);
+}
+
+
+/**
+ * @brief Đăng ký tác vụ chạy 1 lần sau `delay` µs
+ * @return ID tác vụ, -1 nếu hết chỗ
+ */
+int8_t Sched_AddOneShot(const char* name, Sched_TaskFn fn, uint32_t delay) {
+    return Sched_Add(name, fn, 0, delay);
+}
+
+
+/**
+ * @brief Hủy tác vụ (không gọi từ trong ISR)
+ */
+void Sched_Cancel(int8_t id) {
+    if (id < 0 || id >= SCHED_MAX_TASKS || !tasks[id].active) return;
+
+    for (uint8_t i = 0; i < heap_size; i++) {
+        if (heap[i] == (uint8_t)id) {
+            Sched_HeapRemove(i);
+            break;
+        }
+    }
+    tasks[id].active = 0;
+}
+
+
+/**
+ * @brief Đưa deadline của tác vụ về thời điểm hiện tại (chạy ở lượt kế tiếp).
+ *        Tác vụ định kỳ sau đó tiếp tục với nhịp mới tính từ lần chạy này.
+ *        Lần chạy ép này được đếm riêng, không vào thống kê độ trễ (trễ ~0 µs
+ *        theo deadline vừa đặt, sẽ làm loãng histogram).
+ */
+void Sched_RunNow(int8_t id) {
+    if (id < 0 || id >= SCHED_MAX_TASKS || !tasks[id].active) return;
+
+    tasks[id].deadline = GetTimeUs64();
+    tasks[id].forced = 1;
+    for (uint8_t i = 0; i < heap_size; i++) {
+        if (heap[i] == (uint8_t)id) {
+            Sched_SiftUp(i);
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Chạy đúng 1 tác vụ đến hạn sớm nhất (nếu đã đến hạn)
+ * @return 1 nếu đã chạy 1 tác vụ, 0 nếu chưa có tác vụ nào đến hạn
+ */
+uint8_t Sched_RunNext(void) {
+    uint64_t now = GetTimeUs64();
+    uint8_t id;
+    Sched_Task* t;
+    uint32_t late, elapsed;
+    uint8_t prev;
+
+    if (heap_size == 0) return 0;
+
+    id = heap[0];
+    t = &tasks[id];
+    if (now < t->deadline) return 0;
+
+    // Ghi nhận độ trễ so với deadline (lần chạy ép không có deadline danh nghĩa)
+    if (t->forced) {
+        t->forced = 0;
+        t->forced_runs++;
+        if (t->period) sched_jitter.job[id].forced++;
+    } else {
+        late = (uint32_t)(now - t->deadline);
+        t->late_total += late;
+        if (late > t->late_max) t->late_max = late;
+        if (t->period) {
+            Sched_Jitter* j = &sched_jitter.job[id];
+            j->samples++;
+            j->hist[Sched_HistBucket(late)]++;
+            if (late > j->late_max) j->late_max = late;
+        }
+    }
+
+    // Lập lịch lần kế tiếp trước khi chạy, để tác vụ có thể tự hủy
+    if (t->period) {
+        // Giữ đúng nhịp, không cộng dồn trễ (sau Sched_RunNow thì căn lại biên ms)
+        t->deadline = Sched_AlignMs(t->deadline + t->period);
+        if (now >= t->deadline) {
+            // Đã trễ hơn 1 chu kỳ: bỏ các lần lỡ thay vì chạy dồn
+            uint32_t missed = (uint32_t)((now - t->deadline) / t->period) + 1;
+            t->skipped += missed;
+            t->deadline += (uint64_t)missed * t->period;
+        }
+        Sched_SiftDown(0);
+    } else {
+        Sched_HeapRemove(0);
+        t->active = 0;
+    }
+
+    prev = CpuLoad_Enter(CPU_SLOT_TASK + id);
+    t->fn();
+    CpuLoad_Leave(prev);
+
+    elapsed = (uint32_t)(GetTimeUs64() - now);
+    t->runs++;
+    t->run_total += elapsed;
+    if (elapsed > t->run_max) t->run_max = elapsed;
+
+    return 1;
+}
+
+
+/**
+ * @brief Lấy thời điểm đến hạn sớm nhất
+ * @return 1 nếu có tác vụ đang chờ, 0 nếu hàng đợi rỗng
+ */
+uint8_t Sched_NextDeadline(uint64_t* deadline) {
+    if (heap_size == 0) return 0;
+    *deadline = tasks[heap[0]].deadline;
+    return 1;
+}
+
+
+/**
+ * @brief Đọc thông tin và thống kê của tác vụ
+ * @return NULL nếu ID không hợp lệ
+ */
+const Sched_Task* Sched_GetTask(int8_t id) {
+    if (id < 0 || id >= SCHED_MAX_TASKS) return 0;
+    return &tasks[id];
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
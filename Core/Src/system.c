@@ -2,8 +2,10 @@
 // ========== FILE INCLUDE =======
 // ===============================
 
-#include "stm32f4xx.h"   // Thư viện CMSIS định nghĩa thanh ghi và cấu trúc của STM32F4
+#include "hw.h"          // Lớp truy cập phần cứng (SysTick, ngắt)
 #include "system.h"
+#include "cpuload.h"     // Tính chu kỳ CPU cho ISR và vòng ngủ
+#include "wdg.h"         // Giám sát tác vụ, nạp lại IWDG mỗi tick
 
 
 // =======================================
@@ -13,6 +15,33 @@
 // Biến đếm số lần ngắt SysTick – tương ứng với số ms đã trôi qua kể từ lúc khởi động
 volatile uint32_t system_tick = 0;
 
+// Số lần system_tick tràn 32-bit (~49,7 ngày) – 32 bit cao của bộ đếm ms 64-bit
+static volatile uint32_t system_tick_hi = 0;
+
+// Giá trị GetTimeUs64() lớn nhất đã trả về (đảm bảo đơn điệu, xem GetTimeUs64)
+static uint64_t time_us_last = 0;
+
+// Các sự kiện ISR đã báo nhưng vòng lặp chính chưa xử lý
+static volatile uint32_t system_events = 0;
+
+// Thống kê ngủ (đọc bằng debugger hoặc chương trình giả lập)
+System_IdleStats idle_stats;
+
+// Chỉ vào Stop khi còn ít nhất bấy nhiêu ms tới deadline (ngắn hơn thì WFI là đủ)
+#define STOP_MIN_MS        5
+
+// Mốc đồng bộ system_tick ↔ RTC. Sau mỗi lần Stop, system_tick được tính lại từ
+// mốc này thay vì cộng dồn từng khoảng ngủ, nên sai số làm tròn không tích lũy.
+// Mốc được dời tới theo số giây chẵn (4096 đơn vị RTC = đúng 1000 ms, không sai số)
+// để khoảng cách luôn nhỏ hơn chu kỳ quay vòng 24 giờ của lịch RTC. Chỉ khi không
+// vào Stop suốt 20 giờ (không thể dời chính xác) mới lấy lại mốc từ đầu.
+#define RTC_ANCHOR_SHIFT   (3600u * HW_RTC_HZ)         // Dời mốc mỗi 1 giờ RTC
+#define RTC_ANCHOR_STALE_MS (20u * 3600u * 1000u)
+
+static uint8_t rtc_anchored = 0;
+static uint32_t rtc_anchor;        // Giá trị HW_RTC_Now() tại mốc
+static uint32_t tick_anchor;       // Giá trị system_tick tại mốc
+
 
 /**
  * @brief Khởi tạo timer SysTick để tạo ngắt mỗi 1ms
@@ -22,27 +51,37 @@ volatile uint32_t system_tick = 0;
 void SysTick_Init(void) {
     // Tải giá trị nạp lại (reload) cho bộ đếm: (16,000,000 / 1000) - 1 = 15999
     // Mỗi lần đếm đủ 15999 chu kỳ (tương ứng 1ms với clock 16 MHz), sẽ tạo ngắt
-    SysTick->LOAD = (16000000 / 1000) - 1;
-
-    // Reset giá trị hiện tại của SysTick counter về 0
-    SysTick->VAL = 0;
-
-    // Bật SysTick:
-    // - Bit 2: CLKSOURCE = 1 => chọn clock hệ thống (HCLK = 16 MHz)
-    // - Bit 1: TICKINT = 1 => cho phép tạo ngắt
-    // - Bit 0: ENABLE = 1 => bắt đầu đếm
-    SysTick->CTRL = (1 << 2) |  // CLKSOURCE = processor clock
-                    (1 << 1) |  // TICKINT = enable interrupt
-                    (1 << 0);   // ENABLE = enable counter
+    HW_SysTick_Init((HW_CPU_HZ / 1000) - 1);
+}
+
+
+/**
+ * @brief Khởi tạo RTC (LSE) làm nguồn thời gian và nguồn đánh thức trong Stop mode
+ */
+void RTC_Init(void) {
+    HW_RTC_Init();
+}
+
+
+/**
+ * @brief Ngắt RTC wakeup: chỉ để đánh thức CPU, thời gian được bù trong System_Stop
+ */
+void RTC_WKUP_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_RTC);
+    HW_RTC_WakeupClear();
+    CpuLoad_Leave(prev);
 }
 
 
 /**
  * @brief Hàm xử lý ngắt SysTick – được gọi tự động mỗi 1ms
- * Tác dụng: tăng biến đếm thời gian toàn cục `system_tick`
+ * Tác dụng: tăng biến đếm thời gian toàn cục `system_tick`, giám sát watchdog
  */
 void SysTick_Handler(void) {
-    system_tick++;  // Cộng thêm 1 ms
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_SYSTICK);
+    if (++system_tick == 0) system_tick_hi++;  // Cộng thêm 1 ms, nhớ lần tràn
+    Wdg_Service();
+    CpuLoad_Leave(prev);
 }
 
 
@@ -50,11 +89,140 @@ void SysTick_Handler(void) {
  * @brief Hàm tạo delay (chờ) theo đơn vị mili giây
  * @param ms Số mili giây cần chờ
  *
- * Cơ chế: ghi lại thời điểm bắt đầu, sau đó chờ đến khi chênh lệch đủ `ms` mili giây
+ * Cơ chế: ghi lại thời điểm bắt đầu, sau đó ngủ (WFI) giữa các ngắt SysTick
+ * đến khi chênh lệch đủ `ms` mili giây
  */
 void Delay_ms(uint32_t ms) {
     uint32_t start = system_tick;  // Lưu lại thời điểm bắt đầu
-    while ((system_tick - start) < ms);  // Bận chờ đến khi đủ thời gian
+    while ((system_tick - start) < ms) HW_WaitForInterrupt();
+}
+
+
+/**
+ * @brief Tickless idle: tắt SysTick, vào Stop mode tới gần deadline (hoặc tới khi
+ *        có nút nhấn), rồi bù system_tick theo RTC. Gọi khi PRIMASK = 1.
+ * @param ms Số ms còn lại tới deadline (>= STOP_MIN_MS)
+ */
+static void System_Stop(uint32_t ms) {
+    uint32_t ticks = (uint32_t)((uint64_t)ms * HW_RTC_WUT_HZ / 1000);  // Làm tròn xuống: thức trước deadline
+    uint32_t rtc_start, rtc_end, synced;
+
+    if (ticks > HW_RTC_WUT_MAX) ticks = HW_RTC_WUT_MAX;
+
+    // Tick đã tràn nhưng ISR chưa chạy: cộng luôn, ISR sẽ không chạy nữa
+    if (HW_SysTick_Suspend() && ++system_tick == 0) system_tick_hi++;
+
+    rtc_start = HW_RTC_Now();
+    if (!rtc_anchored || (system_tick - tick_anchor) >= RTC_ANCHOR_STALE_MS) {
+        rtc_anchor = rtc_start;
+        tick_anchor = system_tick;
+        rtc_anchored = 1;
+    } else {
+        uint32_t elapsed = (rtc_start + HW_RTC_WRAP - rtc_anchor) % HW_RTC_WRAP;
+        if (elapsed >= RTC_ANCHOR_SHIFT) {
+            uint32_t sec = elapsed / HW_RTC_HZ;
+            rtc_anchor = (rtc_anchor + sec * HW_RTC_HZ) % HW_RTC_WRAP;
+            tick_anchor += sec * 1000;
+        }
+    }
+
+    HW_RTC_WakeupStart(ticks);
+    HW_EnterStop();
+    HW_RTC_WakeupStop();
+    rtc_end = HW_RTC_Now();
+
+    // Tính lại system_tick từ mốc RTC; không bao giờ lùi (bộ lập lịch so sánh theo hiệu)
+    synced = tick_anchor + (uint32_t)((uint64_t)((rtc_end + HW_RTC_WRAP - rtc_anchor) % HW_RTC_WRAP)
+                                      * 1000 / HW_RTC_HZ);
+    if ((int32_t)(synced - system_tick) > 0) {
+        if (synced < system_tick) system_tick_hi++;
+        system_tick = synced;
+    }
+
+    HW_SysTick_Resume();
+
+    idle_stats.stops++;
+    idle_stats.stop_cycles += (uint64_t)((rtc_end + HW_RTC_WRAP - rtc_start) % HW_RTC_WRAP)
+                              * HW_CPU_HZ / HW_RTC_HZ;
+}
+
+
+/**
+ * @brief Ngủ đến thời điểm `deadline` hoặc đến khi có sự kiện
+ * @param deadline Giá trị GetTimeUs64() cần đạt tới (µs). CPU chỉ thức dậy ở ngắt
+ *                 SysTick nên deadline nên nằm trên biên ms (xem bộ lập lịch).
+ * @param allow_stop 1: được dùng Stop mode nếu deadline còn đủ xa
+ *                   (chỉ khi không có ngoại vi nào cần clock, ví dụ PWM đang tắt)
+ *
+ * Kiểm tra sự kiện và vào WFI khi đang che ngắt, để ISR không thể chen vào
+ * giữa hai bước đó (nếu không CPU sẽ ngủ thêm tới 1 ms dù đã có sự kiện).
+ * Thời gian ngủ được đo bằng bộ đếm SysTick với độ phân giải 1 chu kỳ.
+ */
+void Sleep_Until(uint64_t deadline, uint8_t allow_stop) {
+    const uint32_t period = HW_CPU_HZ / 1000;  // Chu kỳ SysTick (LOAD + 1)
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_IDLE);
+    uint64_t now;
+
+    while ((now = GetTimeUs64()) < deadline) {
+        uint32_t v0, v1;
+
+        HW_IRQ_Disable();
+        if (system_events) {
+            HW_IRQ_Enable();
+            break;
+        }
+
+        if (allow_stop && (deadline - now) >= STOP_MIN_MS * 1000u) {
+            System_Stop((uint32_t)((deadline - now) / 1000));
+            HW_IRQ_Enable();  // ISR của nguồn đánh thức (nút nhấn/RTC) chạy tại đây
+            continue;
+        }
+
+        v0 = HW_SysTick_Value();
+        HW_WaitForInterrupt();
+        v1 = HW_SysTick_Value();
+
+        // Mỗi lần ngủ kéo dài tối đa 1 chu kỳ SysTick: nếu SysTick đã tràn thì
+        // bộ đếm đã nạp lại đúng 1 lần trong lúc ngủ
+        if (HW_SysTick_Pending()) {
+            uint32_t latency = (period - 1) - v1;
+            idle_stats.idle_cycles += v0 + latency + 1;
+            if (latency > idle_stats.wake_latency_max) idle_stats.wake_latency_max = latency;
+        } else {
+            idle_stats.idle_cycles += v0 - v1;
+        }
+        idle_stats.sleeps++;
+
+        HW_IRQ_Enable();  // Các ISR đang chờ được thực thi tại đây
+    }
+
+    CpuLoad_Leave(prev);
+}
+
+
+/**
+ * @brief Báo sự kiện cho vòng lặp chính (gọi từ ISR), đánh thức Sleep_Until.
+ *        Che ngắt vì ISR ở các mức ưu tiên khác nhau (EXTI, TIM5) cùng ghi.
+ */
+void System_PostEvent(uint32_t events) {
+    uint32_t primask = HW_IRQ_Save();
+    system_events |= events;
+    HW_IRQ_Restore(primask);
+}
+
+
+/**
+ * @brief Lấy và xóa toàn bộ sự kiện đang chờ
+ */
+uint32_t System_TakeEvents(void) {
+    uint32_t events;
+
+    HW_IRQ_Disable();
+    events = system_events;
+    system_events = 0;
+    HW_IRQ_Enable();
+
+    return events;
 }
 
 
@@ -68,6 +236,39 @@ uint32_t GetTick(void) {
 }
 
 
+/**
+ * @brief Thời gian kể từ khi khởi động, đơn vị µs, 64-bit (không tràn trong thực tế)
+ *
+ * Ghép bộ đếm ms 64-bit (system_tick + số lần tràn) với phần lẻ đọc từ thanh ghi
+ * VAL của SysTick. Đọc trong vùng che ngắt nên gọi được từ mọi ngữ cảnh, kể cả
+ * ISR ưu tiên cao hơn SysTick: nếu SysTick đã tràn mà ISR chưa kịp chạy (cờ
+ * pending) thì tự cộng thêm 1 ms và đọc lại VAL sau lần nạp lại.
+ *
+ * Sau Stop mode, system_tick được bù theo RTC và SysTick bắt đầu lại từ đầu chu
+ * kỳ, nên phần lẻ có thể nhỏ hơn lần đọc trước; giá trị trả về được giữ không
+ * bao giờ lùi.
+ */
+uint64_t GetTimeUs64(void) {
+    const uint32_t period = HW_CPU_HZ / 1000;  // Chu kỳ SysTick (LOAD + 1)
+    uint32_t primask = HW_IRQ_Save();
+    uint64_t ms = ((uint64_t)system_tick_hi << 32) | system_tick;
+    uint32_t val = HW_SysTick_Value();
+    uint64_t us;
+
+    if (HW_SysTick_Pending()) {
+        val = HW_SysTick_Value();
+        ms++;
+    }
+
+    us = ms * 1000 + ((period - 1) - val) / (HW_CPU_HZ / 1000000);
+    if (us < time_us_last) us = time_us_last;
+    time_us_last = us;
+
+    HW_IRQ_Restore(primask);
+    return us;
+}
+
+
 // =======================================
 // ============= END FILE ================
 // =======================================
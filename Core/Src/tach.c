@@ -0,0 +1,178 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // TIM3 input capture, che ngắt
+#include "tach.h"
+#include "cpuload.h"     // Tính chu kỳ CPU của ISR
+
+
+// Thời điểm tính bằng tick TIM3 mở rộng 32-bit: (số lần tràn << 16) | CNT.
+// Ở 1 MHz quay vòng sau ~71 phút; mọi phép trừ đều theo modulo 2^32 nên không sao,
+// vì khoảng cách cần đo luôn ngắn hơn TACH_STALL_US.
+#define TACH_STALL_TICKS  ((uint32_t)((uint64_t)TACH_STALL_US * TACH_TICK_HZ / 1000000))
+
+Tach_Stats tach_stats;
+
+// Chỉ ISR TIM3 ghi; vòng điều khiển và giao diện chỉ đọc (không cần khóa):
+// ISR ghi ô ring trước rồi mới tăng seq, nên mọi ô cũ hơn seq đều đã đầy đủ.
+// Mỗi mảng theo quạt (chỉ số = kênh TIM3 − 1), ISR đi qua các quạt có cờ capture.
+static volatile uint32_t ring[HW_FAN_COUNT][TACH_RING_SIZE];   // Chu kỳ (tick) của các lần bắt gần nhất
+static volatile uint32_t seq[HW_FAN_COUNT];                    // Tổng số chu kỳ đã ghi vào ring
+static volatile uint32_t run[HW_FAN_COUNT];                    // Số chu kỳ liên tiếp kể từ lần quay lại gần nhất
+static volatile uint32_t last_capture[HW_FAN_COUNT];           // Thời điểm bắt gần nhất
+static volatile uint8_t spinning[HW_FAN_COUNT];                // Có cạnh trong TACH_STALL_TICKS vừa qua
+static volatile uint32_t overflows;                            // Số lần TIM3 tràn (phần cao của thời điểm)
+
+// 60 · TACH_TICK_HZ · (cạnh mỗi lần bắt) / (xung mỗi vòng): RPM = rpm_num / chu kỳ
+static uint32_t rpm_num;
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Bắt đầu đo tốc độ các quạt trong TACH_FAN_MASK (TIM3 CH1..CH4) với
+ *        TACH_PPR_DEFAULT xung/vòng
+ */
+void Tach_Init(void) {
+    Tach_SetPulsesPerRev(TACH_PPR_DEFAULT);
+    HW_TACH_Init(HW_TIM_HZ / TACH_TICK_HZ - 1, TACH_EDGES_LOG2, TACH_IC_FILTER, TACH_FAN_MASK);
+}
+
+
+/**
+ * @brief Quạt `fan` có dây tach (TACH_FAN_MASK)
+ */
+uint8_t Tach_Present(uint8_t fan) {
+    return fan < HW_FAN_COUNT && ((TACH_FAN_MASK >> fan) & 1u);
+}
+
+
+/**
+ * @brief Đặt số xung tach mỗi vòng quay của quạt (1..8, 0 bị bỏ qua)
+ */
+void Tach_SetPulsesPerRev(uint8_t ppr) {
+    if (!ppr || ppr > 8) return;
+    rpm_num = 60u * TACH_TICK_HZ * (1u << TACH_EDGES_LOG2) / ppr;   // ≤ 480 000 000
+}
+
+
+/**
+ * @brief Bỏ các chu kỳ đã đo, đo lại từ cạnh kế tiếp
+ *
+ * Gọi trước khi vào Stop mode: TIM3 đứng yên trong Stop, nên chu kỳ nối qua lần
+ * ngủ sẽ sai và phép kiểm tra quạt đứng (theo thời gian thức) bị trễ.
+ */
+void Tach_Restart(void) {
+    uint32_t primask = HW_IRQ_Save();
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        spinning[fan] = 0;
+        run[fan] = 0;
+    }
+    HW_IRQ_Restore(primask);
+}
+
+
+/**
+ * @brief Thời điểm hiện tại theo tick TIM3 mở rộng 32-bit
+ */
+static uint32_t Tach_Now(void) {
+    uint32_t primask = HW_IRQ_Save();
+    uint16_t cnt = HW_TACH_Count();
+    uint32_t hi = overflows;
+
+    // Đã tràn nhưng ISR chưa đếm: CNT nhỏ nghĩa là đọc sau lần tràn đó
+    if ((HW_TACH_Flags() & HW_TACH_UPDATE) && cnt < 0x8000u) hi++;
+    HW_IRQ_Restore(primask);
+    return (hi << 16) | cnt;
+}
+
+
+/**
+ * @brief Tốc độ quạt `fan` (RPM), trung bình TACH_AVG chu kỳ gần nhất; 0 nếu quạt
+ *        đứng hoặc không có tach
+ *
+ * Gọi được từ vòng điều khiển và vòng lặp chính: chỉ đọc bộ đệm do ISR ghi.
+ */
+uint32_t Tach_GetRpm(uint8_t fan) {
+    uint32_t s, n, sum = 0, avg;
+
+    if (fan >= HW_FAN_COUNT) return 0;
+    s = seq[fan];
+    n = run[fan];
+    if (!spinning[fan] || !n) return 0;
+    if ((int32_t)(Tach_Now() - last_capture[fan]) > (int32_t)TACH_STALL_TICKS) return 0;
+
+    if (n > TACH_AVG) n = TACH_AVG;
+    for (uint32_t i = 1; i <= n; i++) sum += ring[fan][(s - i) & (TACH_RING_SIZE - 1)];
+
+    avg = (sum + n / 2) / n;
+    if (!avg) return 0;
+    return (rpm_num + avg / 2) / avg;
+}
+
+
+/**
+ * @brief Ngắt TIM3: capture (cạnh tach của từng quạt) và update (bộ đếm 16-bit tràn)
+ *
+ * Nhánh capture chỉ ghép thời điểm, trừ và ghi 1 ô ring (~20 lệnh, không chia);
+ * việc đổi ra RPM để cho người đọc. Khi cả 2 cờ cùng bật, lần tràn đã xảy ra trước
+ * lần bắt nếu CCRx nằm ở nửa dưới của vòng đếm.
+ */
+void TIM3_IRQHandler(void) {
+    uint8_t prev = CpuLoad_Enter(CPU_SLOT_TACH);
+    uint32_t sr = HW_TACH_Flags();
+    uint32_t hi = overflows;
+
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        uint16_t cap;
+        uint32_t h = hi, now, period;
+
+        if (!(sr & HW_TACH_CAPTURE(fan))) continue;
+
+        cap = HW_TACH_Capture(fan);                  // Đọc CCRx cũng xóa CCxIF
+        if ((sr & HW_TACH_UPDATE) && cap < 0x8000u) h++;
+        now = (h << 16) | cap;
+        period = now - last_capture[fan];
+        last_capture[fan] = now;
+        tach_stats.captures++;
+
+        if (sr & HW_TACH_OVERCAPTURE(fan)) {
+            // Đã mất ít nhất 1 cạnh: chu kỳ này dài gấp bội, bỏ đi
+            HW_TACH_Clear(HW_TACH_OVERCAPTURE(fan));
+            tach_stats.overcaptures++;
+        } else if (spinning[fan]) {
+            ring[fan][seq[fan] & (TACH_RING_SIZE - 1)] = period;
+            seq[fan]++;
+            run[fan]++;
+        } else {
+            // Cạnh đầu tiên sau khi đứng: chỉ làm mốc cho chu kỳ kế tiếp
+            spinning[fan] = 1;
+            tach_stats.starts++;
+        }
+    }
+
+    if (sr & HW_TACH_UPDATE) {
+        HW_TACH_Clear(HW_TACH_UPDATE);
+        overflows++;
+
+        // Kiểm tra quạt đứng mỗi lần tràn (65 ms): CNT vừa về 0. So sánh có dấu vì
+        // lần bắt vừa xử lý ở trên có thể nằm sau lần tràn này.
+        for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+            if (spinning[fan] && (int32_t)((overflows << 16) - last_capture[fan]) > (int32_t)TACH_STALL_TICKS) {
+                spinning[fan] = 0;
+                run[fan] = 0;
+                tach_stats.stalls++;
+            }
+        }
+    }
+
+    CpuLoad_Leave(prev);
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
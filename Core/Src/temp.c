@@ -0,0 +1,233 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // Giá trị hiệu chuẩn cảm biến nhiệt, che ngắt khi thay bảng
+#include "temp.h"
+
+
+/**
+ * @brief Đường cong nhiệt độ → duty đã biên dịch (duty Q16, độ dốc Q16 mỗi 0,1 °C)
+ */
+typedef struct {
+    int16_t x[TEMP_CURVE_MAX_POINTS];      // Nhiệt độ của từng điểm (0,1 °C)
+    uint32_t y[TEMP_CURVE_MAX_POINTS];     // Duty Q16 tại điểm đó
+    int32_t slope[TEMP_CURVE_MAX_POINTS];  // Duty Q16 mỗi 0,1 °C tới điểm kế tiếp
+    uint8_t count;
+} Temp_Curve;
+
+Temp_Stats temp_stats;
+
+// Nhiệt độ NTC (0,1 °C) tại ADC = i · 2^TEMP_NTC_LUT_SHIFT, tính sẵn trên máy tính theo
+// công thức Beta (thang 12-bit, chú thích cột là ADC 12-bit):
+// R = R_FIXED · adc / (4096 − adc), 1/T = 1/298,15 + ln(R / R25) / BETA.
+// Ô 0 (ADC 0, nhiệt độ vô hạn) không dùng tới vì ADC < TEMP_NTC_ADC_MIN là chập.
+// Sai số nội suy < 0,15 °C trong 0..100 °C, < 0,35 °C trong −30..130 °C.
+static const int16_t ntc_lut[((ADC_MAX + 1) >> TEMP_NTC_LUT_SHIFT)] = {
+     2000,  1969,  1607,  1418,  1293,  1201,  1127,  1067,   // ADC 0
+     1016,   972,   933,   898,   866,   837,   811,   786,   // ADC 256
+      763,   742,   722,   703,   685,   668,   652,   636,   // ADC 512
+      621,   607,   593,   580,   567,   555,   543,   531,   // ADC 768
+      520,   509,   498,   487,   477,   467,   458,   448,   // ADC 1024
+      439,   430,   421,   412,   403,   394,   386,   378,   // ADC 1280
+      370,   362,   354,   346,   338,   330,   323,   315,   // ADC 1536
+      308,   300,   293,   286,   278,   271,   264,   257,   // ADC 1792
+      250,   243,   236,   229,   222,   215,   208,   201,   // ADC 2048
+      194,   188,   181,   174,   167,   160,   153,   146,   // ADC 2304
+      139,   132,   125,   118,   111,   104,    97,    90,   // ADC 2560
+       83,    75,    68,    60,    53,    45,    37,    30,   // ADC 2816
+       22,    14,     5,    -3,   -11,   -20,   -29,   -38,   // ADC 3072
+      -47,   -57,   -66,   -76,   -87,   -97,  -108,  -120,   // ADC 3328
+     -132,  -144,  -157,  -171,  -186,  -201,  -218,  -236,   // ADC 3584
+     -256,  -278,  -302,  -330,  -364,  -405,  -460,  -548,   // ADC 3840
+};
+
+// Tắt dưới 35 °C, 30 % ở 35 °C, 60 % ở 45 °C, 100 % từ 60 °C
+static const Temp_CurvePoint curve_default[] = {
+    {349, 0}, {350, 300}, {450, 600}, {600, 1000},
+};
+
+// Chỉ vòng điều khiển (ISR TIM5) ghi; vòng lặp chính đọc qua snapshot
+static Temp_Curve curve;
+static int32_t die_k;                  // 80 °C (Q16, đơn vị 0,1 °C) / (TS_CAL110 − TS_CAL30), thang 12-bit
+static int16_t ntc_dc = TEMP_INVALID;
+static int16_t die_dc = TEMP_INVALID;
+static int16_t hyst_dc = TEMP_INVALID; // Nhiệt độ sau trễ, đường cong được tính theo giá trị này
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Đọc giá trị hiệu chuẩn của cảm biến nhiệt bên trong và nạp đường cong
+ *        mặc định (gọi trước Control_Init)
+ *
+ * Phép chia duy nhất của cảm biến bên trong làm ở đây; Temp_FromDie chỉ nhân và dịch.
+ */
+void Temp_Init(void) {
+    uint16_t cal30 = HW_TS_Cal30();
+    uint16_t cal110 = HW_TS_Cal110();
+    uint16_t vref = HW_VREFINT_Cal();
+
+    // ROM trống (0xFFFF) hoặc không hợp lý: dùng giá trị điển hình của datasheet
+    if (cal110 > 4095 || cal110 < cal30 + 100u) {
+        cal30 = TEMP_TS_CAL30_TYP;
+        cal110 = TEMP_TS_CAL110_TYP;
+    }
+    temp_stats.ts_cal30 = cal30;
+    temp_stats.ts_cal110 = cal110;
+    if (vref < TEMP_VREFINT_CAL_MIN || vref > TEMP_VREFINT_CAL_MAX) vref = TEMP_VREFINT_CAL_TYP;
+    temp_stats.vrefint_cal = vref;
+    die_k = (int32_t)(((800u << 16) + (cal110 - cal30) / 2) / (cal110 - cal30));
+
+    Temp_SetCurve(curve_default, sizeof(curve_default) / sizeof(curve_default[0]));
+    ntc_dc = die_dc = hyst_dc = TEMP_INVALID;
+}
+
+
+/**
+ * @brief Nhiệt độ NTC (0,1 °C) từ giá trị ADC của cầu phân áp
+ * @return TEMP_INVALID nếu NTC chập hoặc hở mạch
+ *
+ * Tra bảng và nội suy tuyến tính (1 nhân, 1 dịch), không có log() lúc chạy.
+ */
+int16_t Temp_FromNtc(uint16_t adc) {
+    uint32_t i = adc >> TEMP_NTC_LUT_SHIFT;
+    int32_t frac = adc & ((1u << TEMP_NTC_LUT_SHIFT) - 1);
+
+    if (adc < TEMP_NTC_ADC_MIN || adc > TEMP_NTC_ADC_MAX) return TEMP_INVALID;
+    return (int16_t)(ntc_lut[i] + (((ntc_lut[i + 1] - ntc_lut[i]) * frac) >> TEMP_NTC_LUT_SHIFT));
+}
+
+
+/**
+ * @brief Nhiệt độ chip (0,1 °C) từ giá trị ADC của cảm biến bên trong (ADC1_IN18,
+ *        đã quy về VDDA = 3,3 V), nội suy giữa 2 điểm hiệu chuẩn 30 °C và 110 °C
+ */
+int16_t Temp_FromDie(uint16_t adc) {
+    // Giá trị hiệu chuẩn là 12-bit: |d| < 2^ADC_BITS, d · die_k cần 64-bit (SMULL)
+    int32_t d = (int32_t)adc - ((int32_t)temp_stats.ts_cal30 << (ADC_BITS - 12));
+    int32_t shift = 16 + ADC_BITS - 12;
+    return (int16_t)(300 + (((int64_t)d * die_k + (1 << (shift - 1))) >> shift));
+}
+
+
+/**
+ * @brief Đặt đường cong nhiệt độ → duty tuyến tính từng đoạn qua `count` điểm (mọi quạt)
+ * @param points Các điểm, nhiệt độ tăng dần nghiêm ngặt, duty ≤ 1000 ‰
+ * @param count 2..TEMP_CURVE_MAX_POINTS
+ * @return 1 nếu hợp lệ, 0 nếu không (giữ đường cong cũ)
+ *
+ * Dưới điểm đầu giữ duty điểm đầu, trên điểm cuối giữ duty điểm cuối. Gọi được từ
+ * vòng lặp chính lúc đang chạy (bảng dựng riêng rồi chép vào trong lúc che ngắt).
+ */
+uint8_t Temp_SetCurve(const Temp_CurvePoint* points, uint8_t count) {
+    Temp_Curve c;
+    uint32_t primask;
+    uint8_t i;
+
+    if (count < 2 || count > TEMP_CURVE_MAX_POINTS) return 0;
+
+    for (i = 0; i < count; i++) {
+        if (points[i].permille > 1000) return 0;
+        if (i > 0 && points[i].temp_dc <= points[i - 1].temp_dc) return 0;
+
+        c.x[i] = points[i].temp_dc;
+        c.y[i] = ((uint32_t)points[i].permille * 65536 + 500) / 1000;
+    }
+    for (i = 0; i + 1 < count; i++) {
+        int32_t dy = (int32_t)c.y[i + 1] - (int32_t)c.y[i];
+        int32_t dx = (int32_t)c.x[i + 1] - (int32_t)c.x[i];
+        c.slope[i] = (dy + (dy < 0 ? -dx / 2 : dx / 2)) / dx;
+    }
+    c.slope[count - 1] = 0;
+    c.count = count;
+
+    primask = HW_IRQ_Save();
+    curve = c;
+    HW_IRQ_Restore(primask);
+    return 1;
+}
+
+
+/**
+ * @brief Cập nhật nhiệt độ từ 1 khối mẫu ADC (gọi từ vòng điều khiển)
+ * @param ntc_adc Cầu phân áp NTC (PA4), tỉ lệ với VDDA nên không cần bù
+ * @param die_adc Cảm biến nhiệt bên trong
+ * @param vref_adc VREFINT cùng khối (0: không bù VDDA)
+ *
+ * Nhiệt độ điều khiển là NTC, hoặc nhiệt độ chip khi NTC chập/hở. Trễ kiểu khe hở:
+ * nhiệt độ tăng thì kéo theo ngay, giảm thì chỉ kéo theo khi đã thấp hơn
+ * TEMP_HYST_DC, nên quạt không bật/tắt liên tục quanh 1 điểm của đường cong.
+ */
+void Temp_Update(uint16_t ntc_adc, uint16_t die_adc, uint16_t vref_adc) {
+    int16_t t;
+
+    // Quy về VDDA = 3,3 V: ≤ 2^ADC_BITS · 4 · TEMP_VREFINT_CAL_MAX < 2^32
+    if (vref_adc) {
+        uint32_t die = ((uint32_t)die_adc * ((uint32_t)temp_stats.vrefint_cal << (ADC_BITS - 12)) + vref_adc / 2u) / vref_adc;
+        die_adc = (uint16_t)(die > ADC_MAX ? ADC_MAX : die);
+    }
+
+    temp_stats.samples++;
+    ntc_dc = Temp_FromNtc(ntc_adc);
+    die_dc = Temp_FromDie(die_adc);
+    if (ntc_dc == TEMP_INVALID) temp_stats.ntc_faults++;
+
+    t = Temp_Control();
+    if (hyst_dc == TEMP_INVALID || t > hyst_dc) hyst_dc = t;
+    else if (t < hyst_dc - TEMP_HYST_DC) hyst_dc = (int16_t)(t + TEMP_HYST_DC);
+}
+
+
+/**
+ * @brief Nhiệt độ NTC gần nhất (TEMP_INVALID nếu chập/hở hoặc chưa đo)
+ */
+int16_t Temp_Ntc(void) {
+    return ntc_dc;
+}
+
+
+/**
+ * @brief Nhiệt độ chip gần nhất (TEMP_INVALID nếu chưa đo)
+ */
+int16_t Temp_Die(void) {
+    return die_dc;
+}
+
+
+/**
+ * @brief Nhiệt độ dùng để điều khiển: NTC, hoặc nhiệt độ chip khi NTC lỗi
+ */
+int16_t Temp_Control(void) {
+    return (ntc_dc != TEMP_INVALID) ? ntc_dc : die_dc;
+}
+
+
+/**
+ * @brief Duty Q16 (65536 = 100 %) theo đường cong nhiệt độ, tính trên nhiệt độ sau trễ
+ *        (100 % khi chưa có mẫu nào: an toàn hơn để quạt đứng)
+ *
+ * Tìm tuần tự (≤ TEMP_CURVE_MAX_POINTS điểm) rồi nội suy bằng 1 phép nhân; |slope · dx|
+ * không vượt quá độ chênh duty của đoạn nên vừa int32.
+ */
+uint32_t Temp_DutyQ16(void) {
+    int32_t t = hyst_dc;
+    uint8_t i = 0;
+    int32_t y;
+
+    if (hyst_dc == TEMP_INVALID) return 65536;
+    if (t <= curve.x[0]) return curve.y[0];
+    while (i + 1 < curve.count && curve.x[i + 1] <= t) i++;
+
+    y = (int32_t)curve.y[i] + curve.slope[i] * (t - curve.x[i]);   // Điểm cuối: slope = 0
+    if (y < 0) y = 0;
+    if (y > 65536) y = 65536;
+    return (uint32_t)y;
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
@@ -0,0 +1,125 @@
+// ===============================
+// ========== FILE INCLUDE =======
+// ===============================
+
+#include "hw.h"          // IWDG, cờ reset, thanh ghi backup
+#include "wdg.h"
+#include "system.h"      // GetTimeUs64()
+
+
+// Số ms thức kể từ lần báo gần nhất của từng tác vụ (SysTick tăng, Wdg_CheckIn xóa)
+static volatile uint16_t age[WDG_COUNT];
+static uint8_t started = 0;
+
+Wdg_Stats wdg_stats = { .stalled = WDG_NONE, .last_stalled = WDG_NONE };
+
+static const char* const wdg_names[WDG_COUNT] = {
+    "control", "input", "display"
+};
+
+
+// ======================================
+// ======== FUNCTION DEFINITIONS ========
+// ======================================
+
+/**
+ * @brief Đọc nguyên nhân reset và báo cáo của lần chạy trước, rồi bật IWDG
+ *        (gọi sớm nhất có thể, ngay sau SysTick_Init)
+ *
+ * Sau khi bật, IWDG không thể tắt cho tới lần reset kế tiếp. SysTick nạp lại mỗi
+ * 1 ms (Wdg_Service) miễn là mọi tác vụ đã đăng ký còn trong deadline.
+ */
+void Wdg_Init(void) {
+    uint32_t stall = HW_Backup_Read(WDG_BKP_STALL);
+
+    wdg_stats.reset_cause = HW_ResetCause();
+    wdg_stats.iwdg_reset = (wdg_stats.reset_cause & HW_RESET_IWDG) ? 1 : 0;
+
+    // Chỉ tin tác vụ đã ghi lại nếu đúng là IWDG gây reset
+    if (wdg_stats.iwdg_reset && (stall & 0xFFFF0000u) == WDG_BKP_MAGIC && (stall & 0xFF) < WDG_COUNT) {
+        wdg_stats.last_stalled = (uint8_t)(stall & 0xFF);
+    }
+
+    HW_Backup_Write(WDG_BKP_REPORT, WDG_BKP_MAGIC | ((uint32_t)wdg_stats.reset_cause << 8)
+                                    | wdg_stats.last_stalled);
+    HW_Backup_Write(WDG_BKP_STALL, 0);
+
+    HW_IWDG_Init(WDG_IWDG_PRESCALER, WDG_IWDG_RELOAD);
+    started = 1;
+}
+
+
+/**
+ * @brief Bắt đầu giám sát tác vụ `id`: từ nay phải gọi Wdg_CheckIn ít nhất mỗi
+ *        `deadline_ms` ms thức (nên gấp vài lần chu kỳ bình thường của tác vụ)
+ */
+void Wdg_Register(uint8_t id, uint16_t deadline_ms) {
+    if (id >= WDG_COUNT) return;
+    age[id] = 0;
+    wdg_stats.deadline[id] = deadline_ms;
+}
+
+
+/**
+ * @brief Tác vụ `id` báo còn sống (gọi được từ ISR)
+ */
+void Wdg_CheckIn(uint8_t id) {
+    uint16_t a = age[id];
+
+    if (a > wdg_stats.age_max[id]) wdg_stats.age_max[id] = a;
+    age[id] = 0;
+}
+
+
+/**
+ * @brief Kiểm tra các tác vụ và nạp lại IWDG (gọi trong SysTick_Handler, mỗi 1 ms)
+ *
+ * SysTick có mức ưu tiên cao hơn TIM5 và EXTI nên vẫn chạy khi ISR điều khiển
+ * hoặc vòng lặp chính bị treo. Tác vụ đầu tiên quá hạn được ghi vào thanh ghi
+ * backup và IWDG không bao giờ được nạp lại nữa → reset sau WDG_TIMEOUT_MS.
+ * Treo khi đang che ngắt thì SysTick cũng không chạy: vẫn reset, nhưng không rõ tác vụ.
+ */
+void Wdg_Service(void) {
+    if (!started) return;
+
+    for (uint8_t id = 0; id < WDG_COUNT; id++) {
+        uint16_t a;
+
+        if (!wdg_stats.deadline[id]) continue;
+        a = age[id];
+        if (a < 0xFFFF) age[id] = ++a;
+
+        if (a > wdg_stats.deadline[id] && wdg_stats.stalled == WDG_NONE) {
+            wdg_stats.stalled = id;
+            HW_Backup_Write(WDG_BKP_STALL, WDG_BKP_MAGIC | id);
+        }
+    }
+
+    if (wdg_stats.stalled != WDG_NONE) return;
+    HW_IWDG_Feed();
+    wdg_stats.feeds++;
+}
+
+
+/**
+ * @brief Rút ngắn deadline ngủ để CPU thức dậy nạp lại IWDG trước khi hết timeout
+ */
+void Wdg_LimitSleep(uint64_t* deadline) {
+    uint64_t limit = GetTimeUs64() + WDG_SLEEP_MAX_US;
+
+    if (*deadline > limit) *deadline = limit;
+}
+
+
+/**
+ * @brief Tên tác vụ để hiển thị
+ */
+const char* Wdg_Name(uint8_t id) {
+    if (id < WDG_COUNT) return wdg_names[id];
+    return "unknown";
+}
+
+
+// ===============================
+// =========== END FILE ==========
+// ===============================
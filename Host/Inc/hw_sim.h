@@ -0,0 +1,218 @@
+// ====== hw_sim.h ======
+#ifndef HW_SIM_H
+#define HW_SIM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Vi điều khiển STM32F401 giả lập trên Linux.
+ *
+ * Thay cho hw_stm32f401.h khi biên dịch với HOST_SIM: cùng tên hàm, nhưng
+ * trạng thái ngoại vi nằm trong struct này. Thời gian là thời gian ảo (µs),
+ * chỉ trôi khi firmware bận chờ (HW_Spin), ngủ (HW_WaitForInterrupt) hoặc khi
+ * chương trình host gọi HW_Sim_Advance; ngắt SysTick/EXTI được gọi đồng bộ tại
+ * các thời điểm đó, hoặc bị hoãn tới HW_IRQ_Enable nếu PRIMASK đang bật.
+ */
+typedef struct {
+    // ======== Thời gian ảo ========
+    uint64_t now_us;             // Thời điểm hiện tại (µs kể từ reset)
+    uint8_t systick_enabled;
+    uint32_t systick_period_us;  // Chu kỳ ngắt SysTick
+    uint64_t systick_next_us;    // Thời điểm ngắt SysTick kế tiếp
+    uint32_t systick_reload;     // SysTick LOAD (để mô phỏng thanh ghi VAL)
+    uint8_t systick_pending;     // SysTick đã tràn nhưng ISR chưa chạy (PRIMASK = 1)
+    uint8_t primask;             // 1: ngắt bị che (HW_IRQ_Disable)
+    uint8_t isr_depth;           // > 0: đang chạy trong ISR
+    uint32_t wfi_count;          // Số lần CPU vào WFI
+    uint64_t wfi_us;             // Tổng thời gian CPU nằm trong WFI
+    uint8_t sleeping;            // Đang trong WFI/Stop (DWT CYCCNT đứng yên)
+    uint64_t sleep_start_us;     //   từ thời điểm này
+    uint8_t running;             // Đang chạy firmware trong HW_Sim_Run
+    uint64_t run_until_us;       // Thời điểm dừng firmware
+    void (*tick_hook)(void);     // Gọi mỗi 1 ms thời gian ảo, sau SysTick nếu trùng thời điểm
+    uint64_t hook_next_us;       //   (vẫn chạy khi SysTick tắt trong Stop mode)
+
+    // ======== TIM5 (ngắt update định kỳ) ========
+    uint8_t tim5_enabled;
+    uint32_t tim5_period_us;     // Chu kỳ ngắt update
+    uint64_t tim5_next_us;       // Thời điểm tràn kế tiếp
+    uint8_t tim5_uif;            // Cờ UIF (ngắt pending nếu PRIMASK = 1)
+    uint8_t tim5_stuck;          // Lỗi giả lập: ngắt TIM5 không còn tới vòng điều khiển
+
+    // ======== TIM3 CH1..CH4 (tach) + mô hình quạt ========
+    // Mảng theo quạt: phần tử i là quạt i (PWM HW_PWM_SetCompare(i), tach TIM3 kênh i + 1)
+    uint8_t tach_enabled;
+    uint8_t tach_mask;           // Bit i: kênh của quạt i đang bắt cạnh
+    uint16_t tach_psc;
+    uint8_t tach_edges_log2;     // ICxPSC: bắt 1 lần mỗi 2^n cạnh
+    uint32_t tach_sr;            // Cờ HW_TACH_* (ngắt pending nếu PRIMASK = 1)
+    uint16_t tach_ccr[HW_FAN_MAX];          // CCR1..CCR4
+    uint64_t tach_origin_us;     // Thời điểm CNT = 0 (dời theo thời gian Stop)
+    uint32_t tach_overflows;     // Số lần tràn đã xảy ra
+    uint64_t tach_update_us;     // Thời điểm tràn kế tiếp
+    uint32_t tach_edge_count[HW_FAN_MAX];   // Cạnh đã tới (chia theo ICxPSC)
+    double fan_rpm[HW_FAN_MAX];             // Tốc độ quạt hiện tại
+    uint64_t fan_at_us;                     //   tính tới thời điểm này (mọi quạt)
+    uint64_t fan_edge_us[HW_FAN_MAX];       // Thời điểm kiểm tra/cạnh tach kế tiếp
+    uint8_t fan_edge_real[HW_FAN_MAX];      //   1: quạt đang quay, có thể ra cạnh tach; 0: chỉ kiểm tra lại
+    double fan_phase[HW_FAN_MAX];           // Góc quay tính bằng xung tach, kể từ cạnh trước (0..1)
+    uint32_t fan_max_rpm[HW_FAN_MAX];       // Tốc độ ở duty 100 %
+    uint8_t fan_blocked[HW_FAN_MAX];        // Lỗi giả lập: rôto bị kẹt, không có xung tach
+    uint32_t fan_min_permille;   // Dưới duty này quạt không quay (mọi quạt)
+    uint32_t fan_tau_ms;         // Hằng số thời gian quán tính (bậc 1)
+    uint8_t fan_ppr;             // Số xung tach mỗi vòng
+
+    // ======== RTC / Stop mode ========
+    uint8_t rtc_enabled;
+    uint8_t rtc_wut_enabled;
+    uint32_t rtc_wut_ticks;      // Chu kỳ wakeup (1/HW_RTC_WUT_HZ s)
+    uint64_t rtc_wut_start_us;   // Thời điểm bật wakeup timer
+    uint32_t rtc_wut_count;      // Số lần đã tràn kể từ khi bật
+    uint64_t rtc_wut_next_us;    // Thời điểm tràn kế tiếp
+    uint8_t rtc_wutf;            // Cờ WUTF (ngắt pending nếu PRIMASK = 1)
+    uint8_t stopped;             // Đang trong Stop mode (TIM5 mất clock)
+    uint32_t stop_count;         // Số lần vào Stop mode
+    uint64_t stop_us;            // Tổng thời gian nằm trong Stop mode
+
+    // ======== GPIO / PWM / ADC ========
+    uint8_t led;                 // Bit 0..2: LED1..LED3 (PA1..PA3)
+    uint16_t pwm_psc;            // TIM4 PSC
+    uint16_t pwm_arr;            // TIM4 ARR
+    uint16_t pwm_ccr[HW_FAN_MAX];  // CCR của kênh TIM4 từng quạt
+    // ADC1 quét liên tục PA0, PA4, cảm biến nhiệt, VREFINT (thứ tự như hw_stm32f401.h),
+    // DMA ghi vòng tròn: mỗi nửa bộ đệm là 1 sự kiện, ghi các giá trị hiện tại vào cả nửa đó
+    uint16_t adc_input;          // Giá trị 12-bit mà chân PA0 đang đưa vào
+    uint32_t adc_conversions;
+    uint8_t adc_stuck;           // Lỗi giả lập: ADC ngừng chuyển đổi, DMA không còn ngắt
+    uint16_t adc_ntc;            // Giá trị 12-bit ở PA4 (cầu phân áp NTC)
+    uint16_t adc_die;            // Giá trị 12-bit của cảm biến nhiệt bên trong (theo VDDA hiện tại)
+    uint16_t adc_vref;           // Giá trị 12-bit của VREFINT (theo VDDA hiện tại)
+    double die_c;                // Nhiệt độ chip (°C)
+    uint32_t vdda_mv;            // Điện áp tham chiếu ADC
+    uint16_t ts_cal[2];          // TS_CAL1 (30 °C), TS_CAL2 (110 °C) trong ROM hệ thống
+    uint16_t vrefint_cal;        // VREFINT_CAL trong ROM hệ thống (VDDA = 3,3 V)
+    uint8_t adc_enabled;
+    volatile uint16_t* adc_dma_buf;
+    uint16_t adc_dma_count;      // Số ô của bộ đệm (NDTR)
+    uint8_t adc_dma_half;        // Nửa sẽ được ghi xong kế tiếp (0: đầu, 1: sau)
+    uint32_t adc_dma_period_us;  // Thời gian ghi đầy 1 nửa
+    uint64_t adc_dma_next_us;    // Thời điểm nửa kế tiếp đầy
+    uint32_t adc_dma_flags;      // Cờ HW_ADC_DMA_* (ngắt pending nếu PRIMASK = 1)
+    uint16_t pot_noise;          // Nhiễu đều ± bấy nhiêu LSB trên từng mẫu của PA0
+    uint8_t pot_spikes;          // 1: mỗi nửa bộ đệm có 1 mẫu PA0 bị gai (nhảy ra cực kia của dải)
+    uint32_t adc_rng;            // Trạng thái bộ sinh số giả ngẫu nhiên (lặp lại được)
+    uint16_t adc_awd_low;        // Cửa sổ analog watchdog trên PA0 (LTR, HTR)
+    uint16_t adc_awd_high;
+    uint8_t adc_awd_armed;       // AWDIE
+    uint8_t adc_awd_flag;        // Cờ AWD: có mẫu PA0 ngoài cửa sổ (ngắt nếu armed)
+
+    // ======== EXTI ========
+    uint32_t exti_imr;
+    uint32_t exti_pr;
+
+    // ======== I2C1 ========
+    uint32_t i2c_sr1;
+    uint8_t i2c_started;         // Đang trong transaction (sau START)
+    uint8_t i2c_addr_phase;      // Byte kế tiếp là địa chỉ
+    uint8_t i2c_addr;            // Địa chỉ 7-bit của transaction hiện tại
+    uint8_t i2c_buf[1100];       // Các byte sau địa chỉ (đủ cho 1 frame + control)
+    uint32_t i2c_len;
+    uint32_t i2c_byte_us;        // Thời gian truyền 1 byte (0: bus tức thời)
+    uint64_t i2c_last_us;        // Thời điểm STOP gần nhất
+    uint8_t i2c_stuck;           // Lỗi giả lập: slave giữ SCL, không cờ SR1 nào lên
+    uint8_t i2c_nack;            // Lỗi giả lập: OLED không trả lời ACK địa chỉ (lỗi đến ngay)
+
+    // ======== IWDG / reset / thanh ghi backup ========
+    uint8_t iwdg_enabled;
+    uint32_t iwdg_timeout_us;    // Timeout với LSI danh nghĩa
+    uint64_t iwdg_expire_us;     // Thời điểm reset nếu không được nạp lại
+    uint8_t reset_flags;         // Cờ HW_RESET_* (RCC_CSR)
+    uint32_t bkp[20];            // RTC_BKP0R..BKP19R
+    uint8_t halted;              // IWDG đã reset CPU: firmware dừng hẳn, thời gian vẫn trôi
+    uint64_t reset_us;           //   tại thời điểm này
+} HW_Sim;
+
+extern HW_Sim hw_sim;
+
+// ======== Cùng API với hw_stm32f401.h ========
+void HW_Spin(void);
+void HW_WaitForInterrupt(void);
+void HW_IRQ_Disable(void);
+void HW_IRQ_Enable(void);
+uint32_t HW_IRQ_Save(void);
+void HW_IRQ_Restore(uint32_t primask);
+void HW_CycleCounter_Init(void);
+uint32_t HW_CycleCount(void);
+void HW_SysTick_Init(uint32_t reload);
+uint32_t HW_SysTick_Value(void);
+uint8_t HW_SysTick_Pending(void);
+uint8_t HW_SysTick_Suspend(void);
+void HW_SysTick_Resume(void);
+void HW_EnterStop(void);
+
+void HW_TIM5_Init(uint16_t psc, uint32_t arr);
+void HW_TIM5_ClearUpdate(void);
+
+void HW_TACH_Init(uint16_t psc, uint8_t icpsc_log2, uint8_t filter, uint8_t mask);
+uint32_t HW_TACH_Flags(void);
+uint16_t HW_TACH_Capture(uint8_t fan);
+uint16_t HW_TACH_Count(void);
+void HW_TACH_Clear(uint32_t flags);
+
+void HW_IWDG_Init(uint8_t pr, uint16_t rlr);
+void HW_IWDG_Feed(void);
+uint8_t HW_ResetCause(void);
+uint32_t HW_Backup_Read(uint8_t idx);
+void HW_Backup_Write(uint8_t idx, uint32_t value);
+
+void HW_RTC_Init(void);
+uint32_t HW_RTC_Now(void);
+void HW_RTC_WakeupStart(uint32_t ticks);
+void HW_RTC_WakeupClear(void);
+void HW_RTC_WakeupStop(void);
+
+void HW_LED_Init(void);
+void HW_LED_Write(uint8_t mask);
+
+uint32_t HW_PWM_ClockHz(void);
+void HW_PWM_Init(uint16_t psc, uint16_t arr);
+void HW_PWM_SetCompare(uint8_t fan, uint16_t ccr);
+uint16_t HW_PWM_GetCompare(uint8_t fan);
+
+void HW_ADC_Init(volatile uint16_t* buf, uint16_t count);
+uint32_t HW_ADC_DmaFlags(void);
+void HW_ADC_DmaClear(uint32_t flags);
+uint8_t HW_ADC_Overrun(void);
+void HW_ADC_Restart(uint16_t count);
+void HW_ADC_WatchdogArm(uint16_t low, uint16_t high);
+void HW_ADC_WatchdogDisarm(void);
+uint8_t HW_ADC_WatchdogFired(void);
+uint16_t HW_TS_Cal30(void);
+uint16_t HW_TS_Cal110(void);
+uint16_t HW_VREFINT_Cal(void);
+
+void HW_I2C1_Init(void);
+void HW_I2C1_Start(void);
+void HW_I2C1_Stop(void);
+uint32_t HW_I2C1_Status(void);
+void HW_I2C1_ClearAddr(void);
+void HW_I2C1_Write(uint8_t data);
+
+void HW_EXTI_Init(void);
+uint32_t HW_EXTI_Pending(uint32_t lines);
+void HW_EXTI_Clear(uint32_t lines);
+void HW_EXTI_Enable(uint32_t lines);
+void HW_EXTI_Disable(uint32_t lines);
+
+// ======== Điều khiển từ chương trình host ========
+void HW_Sim_Reset(void);
+void HW_Sim_Advance(uint64_t us);
+void HW_Sim_Run(int (*entry)(void), uint64_t until_us);
+void HW_Sim_SetADC(uint16_t value);
+void HW_Sim_SetNtc(double celsius);
+void HW_Sim_SetDie(double celsius);
+void HW_Sim_SetVdda(uint32_t mv);
+void HW_Sim_TriggerEXTI(uint32_t lines);
+double HW_Sim_FanRpm(uint8_t fan);
+
+#endif
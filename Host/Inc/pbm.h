@@ -0,0 +1,15 @@
+// ====== pbm.h ======
+#ifndef PBM_H
+#define PBM_H
+
+#include <stdint.h>
+#include "ssd1306_sim.h"
+
+// Ảnh 1 bit của màn hình, mỗi phần tử là 1 điểm ảnh (0 hoặc 1)
+typedef uint8_t PBM_Image[SSD1306_SIM_HEIGHT][SSD1306_SIM_WIDTH];
+
+uint8_t PBM_Write(const char* path, PBM_Image image);
+uint8_t PBM_Read(const char* path, PBM_Image image);
+uint32_t PBM_Diff(PBM_Image a, PBM_Image b, PBM_Image diff);
+
+#endif
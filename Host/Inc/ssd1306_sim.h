@@ -0,0 +1,85 @@
+// ====== ssd1306_sim.h ======
+#ifndef SSD1306_SIM_H
+#define SSD1306_SIM_H
+
+#include <stdint.h>
+
+#define SSD1306_SIM_WIDTH   128
+#define SSD1306_SIM_HEIGHT  64
+#define SSD1306_SIM_PAGES   (SSD1306_SIM_HEIGHT / 8)
+#define SSD1306_SIM_ADDR    0x3C     // Địa chỉ I2C 7-bit mặc định của module
+
+/**
+ * @brief Mô hình bộ điều khiển SSD1306 chạy trên máy Linux.
+ *
+ * Nhận đúng chuỗi byte I2C mà driver gửi ra (control byte + command/data),
+ * giải mã lệnh và ghi vào ảnh GDDRAM 128x64. Các vi phạm giao thức được đếm
+ * và lưu lại thông báo gần nhất để công cụ kiểm tra đọc ra.
+ */
+typedef struct {
+    // ======== Bộ nhớ hiển thị (GDDRAM) ========
+    uint8_t gddram[SSD1306_SIM_PAGES][SSD1306_SIM_WIDTH];
+
+    // ======== Thanh ghi cấu hình ========
+    uint8_t addr_mode;       // 0: Horizontal, 1: Vertical, 2: Page
+    uint8_t col_start;       // Cửa sổ cột (lệnh 0x21)
+    uint8_t col_end;
+    uint8_t page_start;      // Cửa sổ page (lệnh 0x22)
+    uint8_t page_end;
+    uint8_t col;             // Con trỏ ghi hiện tại
+    uint8_t page;
+    uint8_t seg_remap;       // 0xA1 → 1
+    uint8_t com_remap;       // 0xC8 → 1
+    uint8_t start_line;      // 0x40–0x7F
+    uint8_t display_offset;  // 0xD3
+    uint8_t mux_ratio;       // 0xA8 (giá trị N, số dòng = N + 1)
+    uint8_t contrast;        // 0x81
+    uint8_t charge_pump;     // 0x8D
+    uint8_t display_on;      // 0xAE/0xAF
+    uint8_t inverse;         // 0xA6/0xA7
+    uint8_t entire_on;       // 0xA4/0xA5
+
+    // ======== Cuộn màn hình (0x26/0x27/0x29/0x2A/0xA3/0x2E/0x2F) ========
+    uint8_t scroll_active;
+    uint8_t scroll_dir;      // 0: phải, 1: trái
+    uint8_t scroll_vertical; // 1 nếu là lệnh cuộn dọc + ngang
+    uint8_t scroll_page_start;
+    uint8_t scroll_page_end;
+    uint8_t scroll_interval; // Mã khoảng thời gian (0–7)
+    uint8_t scroll_voffset;  // Độ lệch dọc mỗi bước
+    uint8_t vscroll_top;     // Vùng cuộn dọc (0xA3)
+    uint8_t vscroll_rows;
+    uint32_t scroll_frames;  // Số frame đã trôi qua kể từ khi bật cuộn
+    uint8_t scroll_hpos;     // Vị trí cuộn ngang hiện tại (cột)
+    uint8_t scroll_vpos;     // Vị trí cuộn dọc hiện tại (dòng)
+
+    // ======== Trạng thái bộ phân tích lệnh ========
+    uint8_t cmd_buf[8];      // Lệnh đang chờ đủ tham số
+    uint8_t cmd_len;
+    uint8_t cmd_need;
+
+    // ======== Thống kê ========
+    uint32_t transactions;   // Số lần START ... STOP
+    uint32_t bus_bytes;      // Tổng số byte trên bus (kể cả byte địa chỉ)
+    uint32_t cmd_bytes;      // Số byte lệnh (kể cả tham số)
+    uint32_t data_bytes;     // Số byte dữ liệu GDDRAM
+    uint32_t nacks;          // Số transaction gửi sai địa chỉ
+    uint32_t violations;     // Số lỗi giao thức phát hiện được
+    char last_violation[96]; // Thông báo lỗi gần nhất
+    uint8_t verbose;         // 1: in lỗi ra stderr ngay khi phát hiện
+} SSD1306Sim;
+
+// Thực thể dùng chung với backend I2C giả lập
+extern SSD1306Sim oled_sim;
+
+void SSD1306Sim_Reset(SSD1306Sim* sim);
+void SSD1306Sim_ResetStats(SSD1306Sim* sim);
+uint8_t SSD1306Sim_Transfer(SSD1306Sim* sim, uint8_t addr, const uint8_t* buf, uint32_t len);
+void SSD1306Sim_AdvanceFrames(SSD1306Sim* sim, uint32_t frames);
+uint8_t SSD1306Sim_GetPixel(const SSD1306Sim* sim, uint8_t x, uint8_t y);
+void SSD1306Sim_Capture(const SSD1306Sim* sim, uint8_t image[SSD1306_SIM_HEIGHT][SSD1306_SIM_WIDTH]);
+
+// Backend I2C giả lập: ghi 1 transaction nhiều byte (burst) vào mô hình
+uint8_t I2C_Sim_Write(uint8_t addr, const uint8_t* buf, uint32_t len);
+
+#endif
@@ -0,0 +1,327 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include <stdio.h>        // printf
+#include <stdlib.h>       // atoi
+#include <time.h>         // clock_gettime
+#include <math.h>         // log, exp (bản tham chiếu của bảng NTC)
+#include "hw.h"           // HW_Sim_Reset, CCR2 của TIM4 giả lập
+#include "fancurve.h"     // Đường cong quạt của firmware
+#include "pwm.h"          // PWM_SetQ16, Update_PWM_From_Mode
+#include "adc.h"          // Mode_From_ADC, ADC_BITS
+#include "temp.h"         // Bảng tra NTC, đường cong nhiệt độ
+
+#define BENCH_ADC_COUNT  (FANCURVE_ADC_MAX + 1)
+
+// Điểm của preset đang đo, chép lại để làm bản tham chiếu (FanCurve chỉ giữ bảng đã biên dịch)
+static FanCurve_Point ref_points[FANCURVE_MAX_POINTS];
+static uint8_t ref_count;
+
+// Đường cong 16 điểm (số điểm tối đa) với đoạn đi xuống, để thử trường hợp xấu nhất
+static const FanCurve_Point bench_max[FANCURVE_MAX_POINTS] = {
+    {100, 50}, {300, 250}, {500, 180}, {800, 400}, {1000, 0}, {1001, 1000}, {1300, 600}, {1600, 650},
+    {1900, 300}, {2200, 900}, {2500, 850}, {2800, 0}, {3100, 120}, {3400, 700}, {3700, 990}, {4000, 1000},
+};
+
+// Các preset của firmware, rồi bench_max (nạp bằng FanCurve_Set)
+#define BENCH_CURVES  (FANCURVE_PRESET_COUNT + 1)
+
+// Sai số cho phép của bảng tra NTC so với công thức Beta trong −30..130 °C (0,1 °C)
+#define BENCH_NTC_TOL_DC  4
+
+// Thang ADC của nhiệt độ (sau oversampling)
+#define BENCH_TEMP_FULL   ((double)(ADC_MAX + 1))
+
+// VDDA thấp để kiểm tra bù VREFINT cho cảm biến bên trong (mV)
+#define BENCH_VDDA_LOW_MV 3000.0
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+static double Bench_Seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * @brief Nhiệt độ NTC (°C) chính xác theo công thức Beta, như lúc tính bảng tra
+ */
+static double Bench_NtcExact(uint16_t adc) {
+    double r = TEMP_NTC_R_FIXED * (double)adc / (BENCH_TEMP_FULL - adc);
+    return 1.0 / (1.0 / 298.15 + log(r / TEMP_NTC_R25) / TEMP_NTC_BETA) - 273.15;
+}
+
+
+/**
+ * @brief Giá trị ADC của cầu phân áp NTC ở `celsius`
+ */
+static uint16_t Bench_NtcAdc(double celsius) {
+    double r = TEMP_NTC_R25 * exp(TEMP_NTC_BETA * (1.0 / (celsius + 273.15) - 1.0 / 298.15));
+    return (uint16_t)(BENCH_TEMP_FULL * r / (r + TEMP_NTC_R_FIXED) + 0.5);
+}
+
+
+/**
+ * @brief Bảng tra NTC so với công thức Beta (log() chạy mỗi lần), trễ nhiệt của
+ *        đường cong nhiệt độ, hiệu chuẩn cảm biến bên trong và bù VDDA theo VREFINT
+ * @return Số lỗi
+ */
+static uint32_t Bench_Temp(int rounds) {
+    volatile int32_t sink = 0;
+    double t0, t1, t2, err_max = 0;
+    uint32_t bad = 0;
+    uint32_t d40, d39, d37;
+    uint16_t cal30 = (uint16_t)(temp_stats.ts_cal30 << (ADC_BITS - 12));
+    uint16_t cal110 = (uint16_t)(temp_stats.ts_cal110 << (ADC_BITS - 12));
+    uint16_t vref = (uint16_t)(temp_stats.vrefint_cal << (ADC_BITS - 12));
+    int32_t sum = 0;
+
+    for (uint32_t adc = TEMP_NTC_ADC_MIN; adc <= TEMP_NTC_ADC_MAX; adc++) {
+        double exact = Bench_NtcExact((uint16_t)adc);
+        double err = fabs(Temp_FromNtc((uint16_t)adc) / 10.0 - exact);
+
+        if (exact < -30.0 || exact > 130.0) continue;
+        if (err > err_max) err_max = err;
+        if (err * 10 > BENCH_NTC_TOL_DC && bad++ < 3) {
+            printf("  ntc: adc %u -> %.1f C, chinh xac %.2f C\n", adc, Temp_FromNtc((uint16_t)adc) / 10.0, exact);
+        }
+    }
+    if (Temp_FromNtc(TEMP_NTC_ADC_MIN - 1) != TEMP_INVALID || Temp_FromNtc(TEMP_NTC_ADC_MAX + 1) != TEMP_INVALID) {
+        printf("  ntc: chap/ho mach khong bi phat hien\n");
+        bad++;
+    }
+
+    t0 = Bench_Seconds();
+    for (int n = 0; n < rounds; n++) {
+        for (uint32_t adc = TEMP_NTC_ADC_MIN; adc <= TEMP_NTC_ADC_MAX; adc++) sum += Temp_FromNtc((uint16_t)adc);
+    }
+    t1 = Bench_Seconds();
+    for (int n = 0; n < rounds; n++) {
+        for (uint32_t adc = TEMP_NTC_ADC_MIN; adc <= TEMP_NTC_ADC_MAX; adc++) {
+            sum += (int32_t)(Bench_NtcExact((uint16_t)adc) * 10);
+        }
+    }
+    t2 = Bench_Seconds();
+    sink += sum;
+
+    printf("%-8s %6u %10.2f %10.2f %10.2f C\n", "ntc", (unsigned)((ADC_MAX + 1) >> TEMP_NTC_LUT_SHIFT),
+           (t1 - t0) * 1e9 / ((double)rounds * (TEMP_NTC_ADC_MAX - TEMP_NTC_ADC_MIN + 1)),
+           (t2 - t1) * 1e9 / ((double)rounds * (TEMP_NTC_ADC_MAX - TEMP_NTC_ADC_MIN + 1)), err_max);
+
+    // Hiệu chuẩn 2 điểm: đúng 30 °C và 110 °C tại 2 giá trị ROM
+    if (Temp_FromDie(cal30) != 300 || Temp_FromDie(cal110) != 1100) {
+        printf("  die: %d / %d tai 2 diem hieu chuan\n", Temp_FromDie(cal30), Temp_FromDie(cal110));
+        bad++;
+    }
+
+    // VDDA 3,0 V: cảm biến bên trong và VREFINT cùng đọc cao hơn, sau khi bù vẫn là 30 °C
+    Temp_Update(Bench_NtcAdc(25.0), (uint16_t)(cal30 * 3300.0 / BENCH_VDDA_LOW_MV + 0.5),
+                (uint16_t)(vref * 3300.0 / BENCH_VDDA_LOW_MV + 0.5));
+    if (Temp_Die() < 299 || Temp_Die() > 301) {
+        printf("  die: %d o VDDA %.0f mV (bu VREFINT sai)\n", Temp_Die(), BENCH_VDDA_LOW_MV);
+        bad++;
+    }
+
+    // Trễ nhiệt: 40 °C → 39 °C giữ duty, 37 °C (dưới 40 − 2) mới giảm
+    Temp_Update(Bench_NtcAdc(40.0), cal30, vref);
+    d40 = Temp_DutyQ16();
+    Temp_Update(Bench_NtcAdc(39.0), cal30, vref);
+    d39 = Temp_DutyQ16();
+    Temp_Update(Bench_NtcAdc(37.0), cal30, vref);
+    d37 = Temp_DutyQ16();
+    if (d39 != d40 || d37 >= d40) {
+        printf("  tre nhiet sai: 40 C %u, 39 C %u, 37 C %u\n", d40, d39, d37);
+        bad++;
+    }
+    return bad;
+}
+
+
+/**
+ * @brief Cách làm thẳng để so sánh: dò tuyến tính từng đoạn rồi chia 64-bit
+ */
+static uint32_t Bench_Reference(uint16_t adc) {
+    uint8_t i = 0;
+
+    if (adc <= ref_points[0].adc) return ((uint32_t)ref_points[0].permille * 65536 + 500) / 1000;
+    while (i + 1 < ref_count && ref_points[i + 1].adc <= adc) i++;
+    if (i + 1 == ref_count) return ((uint32_t)ref_points[i].permille * 65536 + 500) / 1000;
+
+    {
+        int64_t y0 = ((int64_t)ref_points[i].permille * 65536 + 500) / 1000;
+        int64_t y1 = ((int64_t)ref_points[i + 1].permille * 65536 + 500) / 1000;
+        int64_t dx = ref_points[i + 1].adc - ref_points[i].adc;
+        int64_t num = (y1 - y0) * (adc - ref_points[i].adc);
+        return (uint32_t)(y0 + (num >= 0 ? num + dx / 2 : num - dx / 2) / dx);
+    }
+}
+
+
+/**
+ * @brief Giá trị nội suy chính xác (số thực) tại `adc`
+ */
+static double Bench_Exact(uint16_t adc) {
+    uint8_t i = 0;
+    double y0, y1;
+
+    if (adc <= ref_points[0].adc) return ref_points[0].permille * 65.536;
+    while (i + 1 < ref_count && ref_points[i + 1].adc <= adc) i++;
+    if (i + 1 == ref_count) return ref_points[i].permille * 65.536;
+
+    y0 = ref_points[i].permille * 65.536;
+    y1 = ref_points[i + 1].permille * 65.536;
+    return y0 + (y1 - y0) * (adc - ref_points[i].adc) / (ref_points[i + 1].adc - ref_points[i].adc);
+}
+
+
+/**
+ * @brief So FanCurve_Eval với nội suy chính xác trên toàn bộ 4096 giá trị ADC
+ * @return Số giá trị lệch quá 1 LSB Q16
+ */
+static uint32_t Bench_Check(const char* name, double* err_max) {
+    uint32_t bad = 0;
+
+    *err_max = 0;
+    for (uint32_t adc = 0; adc < BENCH_ADC_COUNT; adc++) {
+        double err = (double)FanCurve_Eval(0, (uint16_t)adc) - Bench_Exact((uint16_t)adc);
+        if (err < 0) err = -err;
+        if (err > *err_max) *err_max = err;
+        if (err > 1.0) {
+            if (bad++ < 3) printf("  %s: adc %u -> %u, chinh xac %.2f\n", name, adc,
+                                  FanCurve_Eval(0, (uint16_t)adc), Bench_Exact((uint16_t)adc));
+        }
+    }
+    return bad;
+}
+
+
+/**
+ * @brief Preset step phải cho đúng CCR quạt 0 như Update_PWM_From_Mode(Mode_From_ADC(adc))
+ * @return Số giá trị ADC lệch
+ */
+static uint32_t Bench_CheckStep(void) {
+    uint32_t bad = 0;
+
+    for (uint32_t adc = 0; adc < BENCH_ADC_COUNT; adc++) {
+        uint16_t ccr_mode, ccr_curve;
+
+        Update_PWM_From_Mode(Mode_From_ADC((uint16_t)adc));
+        ccr_mode = hw_sim.pwm_ccr[0];
+        PWM_SetQ16(0, FanCurve_Eval(0, (uint16_t)adc));
+        ccr_curve = hw_sim.pwm_ccr[0];
+
+        if (ccr_mode != ccr_curve) {
+            if (bad++ < 3) printf("  step: adc %u -> CCR %u, mode %u cho CCR %u\n", adc, ccr_curve,
+                                  Mode_From_ADC((uint16_t)adc), ccr_mode);
+        }
+    }
+    return bad;
+}
+
+
+/**
+ * @brief Đo chi phí 1 lần tính đường cong quạt (FanCurve_Eval, chạy trong ISR TIM5)
+ *        so với dò tuyến tính + chia, và kiểm tra độ chính xác
+ *
+ * In ra: ns/lần trên host của 2 cách, sai số lớn nhất (LSB Q16) so với nội suy
+ * chính xác; dòng "ntc": bảng tra nhiệt độ so với log() (sai số tính bằng °C).
+ * Mã thoát khác 0 nếu sai số > 1 LSB, preset step không khớp 4 mode cũ, bảng NTC
+ * lệch quá BENCH_NTC_TOL_DC, trễ nhiệt hoặc bù VDDA sai.
+ *
+ * Cách dùng: curve_bench [số_vòng]   (mặc định 2000 vòng × 4096 giá trị ADC)
+ */
+int main(int argc, char** argv) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint32_t errors = 0;
+    volatile uint32_t sink = 0;
+
+    if (rounds <= 0) rounds = 1;
+
+    HW_Sim_Reset();
+    PWM_Init();
+
+    printf("%-8s %6s %10s %10s %10s\n", "curve", "points", "lut_ns", "scan_ns", "err_lsb");
+
+    for (uint8_t k = 0; k < BENCH_CURVES; k++) {
+        const char* name = (k < FANCURVE_PRESET_COUNT) ? FanCurve_PresetName(k) : "max16";
+        const FanCurve_Point* points = bench_max;
+        uint8_t count = FANCURVE_MAX_POINTS;
+        double t0, t1, t2, err_max;
+        uint32_t sum = 0;
+        uint8_t ok;
+
+        if (k < FANCURVE_PRESET_COUNT) {
+            points = FanCurve_PresetPoints(k, &count);
+            ok = FanCurve_SelectPreset(0, k);
+        } else {
+            ok = FanCurve_Set(0, points, count);
+        }
+        if (!ok) {
+            printf("%-8s khong nap duoc duong cong\n", name);
+            return 1;
+        }
+        for (uint8_t i = 0; i < count; i++) ref_points[i] = points[i];
+        ref_count = count;
+
+        t0 = Bench_Seconds();
+        for (int n = 0; n < rounds; n++) {
+            for (uint32_t adc = 0; adc < BENCH_ADC_COUNT; adc++) sum += FanCurve_Eval(0, (uint16_t)adc);
+        }
+        t1 = Bench_Seconds();
+        for (int n = 0; n < rounds; n++) {
+            for (uint32_t adc = 0; adc < BENCH_ADC_COUNT; adc++) sum += Bench_Reference((uint16_t)adc);
+        }
+        t2 = Bench_Seconds();
+        sink += sum;
+
+        errors += Bench_Check(name, &err_max);
+        if (k == FANCURVE_PRESET_STEP) errors += Bench_CheckStep();
+
+        printf("%-8s %6u %10.2f %10.2f %10.2f\n", name, count,
+               (t1 - t0) * 1e9 / ((double)rounds * BENCH_ADC_COUNT),
+               (t2 - t1) * 1e9 / ((double)rounds * BENCH_ADC_COUNT), err_max);
+    }
+
+    Temp_Init();
+    errors += Bench_Temp(rounds / 10 ? rounds / 10 : 1);
+
+    // Dữ liệu không hợp lệ phải bị từ chối và giữ nguyên đường cong cũ
+    {
+        static const FanCurve_Point unsorted[] = { {500, 100}, {400, 200} };
+        static const FanCurve_Point too_high[] = { {0, 0}, {4095, 1001} };
+        uint32_t before = FanCurve_Eval(0, 2000);
+
+        if (FanCurve_Set(0, unsorted, 2) || FanCurve_Set(0, too_high, 2) || FanCurve_Set(0, bench_max, 1)
+            || FanCurve_Set(HW_FAN_COUNT, bench_max, FANCURVE_MAX_POINTS) || FanCurve_Eval(0, 2000) != before) {
+            printf("duong cong khong hop le khong bi tu choi\n");
+            errors++;
+        }
+    }
+
+    // Mỗi quạt 1 bảng riêng: đổi đường cong quạt cuối không ảnh hưởng quạt 0
+    if (HW_FAN_COUNT > 1) {
+        uint32_t before = FanCurve_Eval(0, 2000);
+
+        if (!FanCurve_SelectPreset(HW_FAN_COUNT - 1, FANCURVE_PRESET_QUIET) || FanCurve_Eval(0, 2000) != before
+            || FanCurve_GetPreset(HW_FAN_COUNT - 1) != FANCURVE_PRESET_QUIET) {
+            printf("duong cong cac quat khong doc lap\n");
+            errors++;
+        }
+    }
+
+    if (errors) {
+        printf("%u loi\n", errors);
+        return 1;
+    }
+    return 0;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
@@ -0,0 +1,971 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include "hw.h"           // Hằng số chung + khai báo hw_sim.h
+#include "ssd1306_sim.h"  // Thiết bị duy nhất trên bus I2C1
+#include "temp.h"         // Thông số NTC trên board
+#include <setjmp.h>       // Thoát khỏi vòng lặp vô hạn của firmware
+#include <stdio.h>        // fprintf
+#include <stdlib.h>       // abort
+#include <string.h>       // memset
+#include <stdint.h>       // UINT64_MAX
+#include <math.h>         // exp (mô hình quạt), log (NTC)
+
+// Trạng thái vi điều khiển giả lập
+HW_Sim hw_sim;
+
+// Điểm quay về khi firmware chạy tới thời điểm dừng
+static jmp_buf sim_exit;
+
+// 100 kHz: 8 bit dữ liệu + 1 bit ACK ≈ 90 µs mỗi byte; START/STOP ≈ 10 µs
+#define HW_SIM_I2C_BYTE_US   90
+#define HW_SIM_I2C_COND_US   10
+
+// LSI danh nghĩa (thực tế 17–47 kHz): clock của IWDG
+#define HW_SIM_LSI_HZ        32000
+
+// Thời gian thức dậy từ Stop mode với ổn áp công suất thấp (datasheet: tWUSTOP ≈ 100 µs)
+#define HW_SIM_STOP_WAKE_US  100
+
+// Mô hình quạt 4 dây: tốc độ xác lập tỉ lệ với duty (dưới ngưỡng thì không quay),
+// đáp ứng quán tính bậc 1; tach kéo xuống HW_SIM_FAN_PPR lần mỗi vòng
+#define HW_SIM_FAN_MAX_RPM       3000
+#define HW_SIM_FAN_MIN_PERMILLE  100
+#define HW_SIM_FAN_TAU_MS        600
+#define HW_SIM_FAN_PPR           2
+#define HW_SIM_FAN_MIN_RPM       30      // Chậm hơn: coi như đứng, không còn xung tach
+#define HW_SIM_FAN_POLL_US       10000   // Tính lại tốc độ/góc quay ít nhất mỗi bấy lâu
+
+// Cảm biến nhiệt: giá trị hiệu chuẩn trong ROM (lệch khỏi giá trị điển hình như chip
+// thật) và nhiệt độ lúc bật nguồn. NTC theo đúng linh kiện mô tả trong temp.h.
+#define HW_SIM_TS_CAL30          945
+#define HW_SIM_TS_CAL110         1191
+#define HW_SIM_VREFINT_CAL       1497
+#define HW_SIM_VDDA_MV           3300
+#define HW_SIM_NTC_C             25.0
+#define HW_SIM_DIE_C             32.0
+
+// Trình phục vụ ngắt của firmware. Bản weak dùng khi chương trình host
+// không link module tương ứng (giống Default_Handler trong file startup)
+void SysTick_Handler(void) __attribute__((weak));
+void EXTI0_IRQHandler(void) __attribute__((weak));
+void EXTI1_IRQHandler(void) __attribute__((weak));
+void EXTI9_5_IRQHandler(void) __attribute__((weak));
+void RTC_WKUP_IRQHandler(void) __attribute__((weak));
+void TIM5_IRQHandler(void) __attribute__((weak));
+void TIM3_IRQHandler(void) __attribute__((weak));
+void DMA2_Stream0_IRQHandler(void) __attribute__((weak));
+void ADC_IRQHandler(void) __attribute__((weak));
+
+void SysTick_Handler(void) {}
+void EXTI0_IRQHandler(void) {}
+void EXTI1_IRQHandler(void) {}
+void EXTI9_5_IRQHandler(void) {}
+void RTC_WKUP_IRQHandler(void) { HW_RTC_WakeupClear(); }
+void TIM5_IRQHandler(void) { HW_TIM5_ClearUpdate(); }
+void TIM3_IRQHandler(void) { HW_TACH_Clear(HW_TACH_UPDATE | HW_TACH_CAPTURE_ALL | HW_TACH_OVERCAPTURE_ALL); }
+void DMA2_Stream0_IRQHandler(void) { HW_ADC_DmaClear(HW_ADC_DMA_HALF | HW_ADC_DMA_FULL); }
+void ADC_IRQHandler(void) { HW_ADC_WatchdogDisarm(); }
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Đưa vi điều khiển giả lập về trạng thái sau reset
+ */
+void HW_Sim_Reset(void) {
+    memset(&hw_sim, 0, sizeof(hw_sim));
+    hw_sim.i2c_byte_us = HW_SIM_I2C_BYTE_US;
+    hw_sim.hook_next_us = 1000;
+    hw_sim.reset_flags = HW_RESET_POWER | HW_RESET_PIN;   // POR đặt cả PORRSTF và PINRSTF
+    hw_sim.fan_min_permille = HW_SIM_FAN_MIN_PERMILLE;
+    hw_sim.fan_tau_ms = HW_SIM_FAN_TAU_MS;
+    hw_sim.fan_ppr = HW_SIM_FAN_PPR;
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        hw_sim.fan_max_rpm[fan] = HW_SIM_FAN_MAX_RPM;
+        hw_sim.fan_edge_us[fan] = HW_SIM_FAN_POLL_US;
+    }
+    hw_sim.ts_cal[0] = HW_SIM_TS_CAL30;
+    hw_sim.ts_cal[1] = HW_SIM_TS_CAL110;
+    hw_sim.vrefint_cal = HW_SIM_VREFINT_CAL;
+    hw_sim.adc_awd_high = 0x0FFF;    // HTR sau reset: cửa sổ mở hết
+    hw_sim.die_c = HW_SIM_DIE_C;
+    HW_Sim_SetNtc(HW_SIM_NTC_C);
+    HW_Sim_SetVdda(HW_SIM_VDDA_MV);   // Tính luôn giá trị ADC của cảm biến bên trong
+    SSD1306Sim_Reset(&oled_sim);
+}
+
+
+/**
+ * @brief Gọi 1 ISR của firmware. Trong lúc ISR chạy, HW_IRQ_Enable/HW_IRQ_Restore
+ *        không gọi lồng các ISR khác (NVIC chỉ cho ISR ưu tiên cao hơn chen vào)
+ */
+static void HW_Sim_Isr(void (*handler)(void)) {
+    hw_sim.isr_depth++;
+    handler();
+    hw_sim.isr_depth--;
+}
+
+
+/**
+ * @brief TIM5 đang đếm (timer APB1 mất clock trong Stop mode)
+ */
+static uint8_t HW_Sim_TIM5_Running(void) {
+    return hw_sim.tim5_enabled && !hw_sim.stopped && !hw_sim.tim5_stuck;
+}
+
+
+/**
+ * @brief TIM3 đang đếm (mất clock trong Stop mode như TIM5)
+ */
+static uint8_t HW_Sim_TACH_Running(void) {
+    return hw_sim.tach_enabled && !hw_sim.stopped;
+}
+
+
+/**
+ * @brief ADC1 đang quét (APB2 mất clock trong Stop mode; lỗi giả lập adc_stuck)
+ */
+static uint8_t HW_Sim_ADC_Running(void) {
+    return hw_sim.adc_enabled && !hw_sim.stopped && !hw_sim.adc_stuck;
+}
+
+
+/**
+ * @brief Số giả ngẫu nhiên 0..2^16 − 1 (LCG, kịch bản chạy lại cho cùng kết quả)
+ */
+static uint32_t HW_Sim_Random(void) {
+    hw_sim.adc_rng = hw_sim.adc_rng * 1664525u + 1013904223u;
+    return hw_sim.adc_rng >> 16;
+}
+
+
+/**
+ * @brief Ngắt analog watchdog đang chờ: có mẫu biến trở ngoài cửa sổ và AWDIE = 1
+ */
+static uint8_t HW_Sim_ADC_AwdPending(void) {
+    return hw_sim.adc_awd_flag && hw_sim.adc_awd_armed;
+}
+
+
+/**
+ * @brief DMA vừa ghi xong 1 nửa bộ đệm: mọi vòng quét trong nửa đó lấy giá trị
+ *        hiện tại của các kênh (đầu vào coi như không đổi trong ~4 ms), biến trở
+ *        cộng thêm nhiễu và gai nếu kịch bản bật; analog watchdog so từng mẫu biến trở
+ */
+static void HW_Sim_ADC_DmaHalf(void) {
+    const uint16_t in[4] = { hw_sim.adc_input, hw_sim.adc_ntc, hw_sim.adc_die, hw_sim.adc_vref };
+    uint32_t half = hw_sim.adc_dma_count / 2;
+    volatile uint16_t* p = hw_sim.adc_dma_buf + hw_sim.adc_dma_half * half;
+
+    for (uint32_t i = 0; i < half; i++) p[i] = in[i % 4];
+    for (uint32_t i = 0; hw_sim.pot_noise && i < half; i += 4) {
+        int32_t v = hw_sim.adc_input + (int32_t)(HW_Sim_Random() % (2u * hw_sim.pot_noise + 1)) - hw_sim.pot_noise;
+        p[i] = (uint16_t)(v < 0 ? 0 : v > 4095 ? 4095 : v);
+    }
+    // Gai đơn lẻ: không rơi vào vòng quét đầu/cuối nửa, nên giữa 2 gai luôn có ít nhất
+    // 2 mẫu thường (median 3 chỉ bỏ được gai như vậy)
+    if (hw_sim.pot_spikes) p[(1 + HW_Sim_Random() % (half / 4 - 2)) * 4] = (hw_sim.adc_input < 2048) ? 4095 : 0;
+    for (uint32_t i = 0; i < half; i += 4) {
+        if (p[i] < hw_sim.adc_awd_low || p[i] > hw_sim.adc_awd_high) hw_sim.adc_awd_flag = 1;
+    }
+    hw_sim.adc_conversions += half;
+    hw_sim.adc_dma_flags |= hw_sim.adc_dma_half ? HW_ADC_DMA_FULL : HW_ADC_DMA_HALF;
+    hw_sim.adc_dma_half ^= 1;
+}
+
+
+/**
+ * @brief Thời điểm tràn thứ n của TIM3 (tính từ tach_origin_us, không cộng dồn sai số)
+ */
+static uint64_t HW_Sim_TACH_UpdateAt(uint32_t n) {
+    uint64_t num = (uint64_t)n * 65536 * ((uint64_t)hw_sim.tach_psc + 1) * 1000000;
+    return hw_sim.tach_origin_us + (num + HW_TIM_HZ - 1) / HW_TIM_HZ;
+}
+
+
+/**
+ * @brief Tích phân tốc độ của mọi quạt tới hiện tại với duty đang áp dụng
+ *        (gọi trước mọi thay đổi CCR/ARR của TIM4)
+ */
+static void HW_Sim_FanUpdate(void) {
+    double dt_ms = (hw_sim.now_us - hw_sim.fan_at_us) / 1000.0;
+    uint32_t period = (uint32_t)hw_sim.pwm_arr + 1;
+
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        double duty = (double)hw_sim.pwm_ccr[fan] / period;
+        double rpm = hw_sim.fan_rpm[fan];
+        double target;
+
+        if (duty > 1.0) duty = 1.0;
+        target = (duty * 1000 < hw_sim.fan_min_permille) ? 0.0 : duty * hw_sim.fan_max_rpm[fan];
+
+        if (hw_sim.fan_blocked[fan]) {
+            rpm = 0;
+        } else if (hw_sim.fan_tau_ms) {
+            // Góc quay = tích phân tốc độ: trung bình của hàm mũ trên đoạn dt
+            double decay = exp(-dt_ms / hw_sim.fan_tau_ms);
+            double mean = (dt_ms > 0) ? target + (rpm - target) * hw_sim.fan_tau_ms * (1 - decay) / dt_ms : rpm;
+            hw_sim.fan_phase[fan] += mean * hw_sim.fan_ppr * dt_ms / 60000.0;
+            rpm = target + (rpm - target) * decay;
+        } else {
+            rpm = target;
+            hw_sim.fan_phase[fan] += target * hw_sim.fan_ppr * dt_ms / 60000.0;
+        }
+        hw_sim.fan_rpm[fan] = rpm;
+    }
+    hw_sim.fan_at_us = hw_sim.now_us;
+}
+
+
+/**
+ * @brief Hẹn lần tính kế tiếp của quạt `fan`: lúc góc quay đủ 1 xung tach theo tốc độ
+ *        hiện tại, nhưng không quá HW_SIM_FAN_POLL_US (quạt đang tăng/giảm tốc thì cạnh
+ *        tới sớm/muộn hơn)
+ */
+static void HW_Sim_FanSchedule(uint8_t fan) {
+    uint64_t wait = HW_SIM_FAN_POLL_US;
+    double rpm = hw_sim.fan_rpm[fan];
+
+    hw_sim.fan_edge_real[fan] = 0;
+    if (!hw_sim.fan_blocked[fan] && rpm >= HW_SIM_FAN_MIN_RPM && hw_sim.fan_ppr) {
+        double us = (1.0 - hw_sim.fan_phase[fan]) * 60e6 / (rpm * hw_sim.fan_ppr);
+        if (us < wait) wait = (us < 1) ? 1 : (uint64_t)(us + 0.5);
+        hw_sim.fan_edge_real[fan] = 1;
+    } else {
+        hw_sim.fan_phase[fan] = 0;   // Quạt đứng: cạnh đầu tiên sau 1 xung trọn vẹn
+    }
+    hw_sim.fan_edge_us[fan] = hw_sim.now_us + wait;
+}
+
+
+/**
+ * @brief Cạnh xuống trên chân tach của quạt `fan`: TIM3 bắt CNT vào CCRx
+ *        (mỗi 2^ICxPSC cạnh; quạt không nối tach thì kênh tắt, bỏ qua)
+ */
+static void HW_Sim_TachEdge(uint8_t fan) {
+    if (!HW_Sim_TACH_Running() || !(hw_sim.tach_mask & (1u << fan))) return;
+    if (++hw_sim.tach_edge_count[fan] & ((1u << hw_sim.tach_edges_log2) - 1)) return;
+
+    if (hw_sim.tach_sr & HW_TACH_CAPTURE(fan)) hw_sim.tach_sr |= HW_TACH_OVERCAPTURE(fan);
+    hw_sim.tach_ccr[fan] = HW_TACH_Count();
+    hw_sim.tach_sr |= HW_TACH_CAPTURE(fan);
+    if (!hw_sim.primask) HW_Sim_Isr(TIM3_IRQHandler);
+}
+
+
+/**
+ * @brief Tốc độ thật của quạt `fan` (RPM) trong mô hình, để so với giá trị firmware đo được
+ */
+double HW_Sim_FanRpm(uint8_t fan) {
+    HW_Sim_FanUpdate();
+    return (fan < HW_FAN_COUNT) ? hw_sim.fan_rpm[fan] : 0.0;
+}
+
+
+/**
+ * @brief IWDG hết timeout: CPU reset. Mô phỏng không chạy lại firmware (biến toàn
+ *        cục không được khởi tạo lại) mà dừng CPU, đưa ngoại vi về trạng thái reset
+ *        (chân PWM/LED thả nổi → quạt dừng) và để thời gian trôi tiếp cho kịch bản.
+ */
+static void HW_Sim_WatchdogReset(void) {
+    hw_sim.iwdg_enabled = 0;
+    hw_sim.reset_flags = HW_RESET_IWDG;
+    hw_sim.halted = 1;
+    hw_sim.reset_us = hw_sim.now_us;
+
+    hw_sim.systick_enabled = 0;
+    hw_sim.systick_pending = 0;
+    hw_sim.tim5_enabled = 0;
+    hw_sim.tim5_uif = 0;
+    hw_sim.tach_enabled = 0;
+    hw_sim.tach_sr = 0;
+    hw_sim.rtc_wut_enabled = 0;
+    hw_sim.rtc_wutf = 0;
+    hw_sim.exti_imr = 0;
+    hw_sim.exti_pr = 0;
+    HW_Sim_FanUpdate();
+    memset(hw_sim.pwm_ccr, 0, sizeof(hw_sim.pwm_ccr));
+    hw_sim.led = 0;
+    hw_sim.i2c_started = 0;
+    hw_sim.primask = 0;
+    hw_sim.isr_depth = 0;
+    hw_sim.sleeping = 0;
+    hw_sim.stopped = 0;
+
+    if (hw_sim.running) longjmp(sim_exit, 1);
+}
+
+
+/**
+ * @brief Thời điểm tràn thứ n của wakeup timer (tính từ lúc bật, tránh cộng dồn sai số làm tròn)
+ */
+static uint64_t HW_Sim_RTC_WakeupAt(uint32_t n) {
+    uint64_t num = (uint64_t)n * hw_sim.rtc_wut_ticks * 1000000;
+    return hw_sim.rtc_wut_start_us + (num + HW_RTC_WUT_HZ - 1) / HW_RTC_WUT_HZ;
+}
+
+
+/**
+ * @brief Cho thời gian ảo trôi thêm `us` micro giây, xử lý lần lượt các sự kiện
+ *        đến hạn: ngắt SysTick, TIM5, TIM3 và DMA của ADC (trừ lúc Stop), cạnh tach
+ *        của quạt, tràn RTC wakeup timer, IWDG hết timeout và tick_hook mỗi 1 ms
+ */
+void HW_Sim_Advance(uint64_t us) {
+    uint64_t target = hw_sim.now_us + us;
+    uint8_t stop = 0;
+
+    // Firmware không bao giờ tự thoát: dừng lại đúng thời điểm đã hẹn
+    if (hw_sim.running && target >= hw_sim.run_until_us) {
+        target = hw_sim.run_until_us;
+        stop = 1;
+    }
+
+    while (1) {
+        uint64_t next = UINT64_MAX;
+
+        if (hw_sim.systick_enabled) next = hw_sim.systick_next_us;
+        if (HW_Sim_TIM5_Running() && hw_sim.tim5_next_us < next) next = hw_sim.tim5_next_us;
+        if (HW_Sim_TACH_Running() && hw_sim.tach_update_us < next) next = hw_sim.tach_update_us;
+        if (HW_Sim_ADC_Running() && hw_sim.adc_dma_next_us < next) next = hw_sim.adc_dma_next_us;
+        for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+            if (hw_sim.fan_edge_us[fan] < next) next = hw_sim.fan_edge_us[fan];
+        }
+        if (hw_sim.rtc_wut_enabled && hw_sim.rtc_wut_next_us < next) next = hw_sim.rtc_wut_next_us;
+        if (hw_sim.iwdg_enabled && hw_sim.iwdg_expire_us < next) next = hw_sim.iwdg_expire_us;
+        if (hw_sim.tick_hook && hw_sim.hook_next_us < next) next = hw_sim.hook_next_us;
+        if (next > target) break;
+
+        hw_sim.now_us = next;
+
+        if (hw_sim.systick_enabled && hw_sim.systick_next_us == next) {
+            hw_sim.systick_next_us += hw_sim.systick_period_us;
+            if (hw_sim.primask) {
+                hw_sim.systick_pending = 1;   // Chạy ISR khi firmware bật lại ngắt
+            } else {
+                HW_Sim_Isr(SysTick_Handler);
+            }
+        }
+
+        if (HW_Sim_TIM5_Running() && hw_sim.tim5_next_us == next) {
+            hw_sim.tim5_next_us += hw_sim.tim5_period_us;
+            hw_sim.tim5_uif = 1;
+            if (!hw_sim.primask) HW_Sim_Isr(TIM5_IRQHandler);
+        }
+
+        if (HW_Sim_TACH_Running() && hw_sim.tach_update_us == next) {
+            hw_sim.tach_update_us = HW_Sim_TACH_UpdateAt(++hw_sim.tach_overflows + 1);
+            hw_sim.tach_sr |= HW_TACH_UPDATE;
+            if (!hw_sim.primask) HW_Sim_Isr(TIM3_IRQHandler);
+        }
+
+        if (HW_Sim_ADC_Running() && hw_sim.adc_dma_next_us == next) {
+            hw_sim.adc_dma_next_us += hw_sim.adc_dma_period_us;
+            HW_Sim_ADC_DmaHalf();
+            // Mẫu ngoài cửa sổ có trước khi nửa bộ đệm đầy: ngắt ADC chạy trước ngắt DMA
+            if (!hw_sim.primask && HW_Sim_ADC_AwdPending()) HW_Sim_Isr(ADC_IRQHandler);
+            if (!hw_sim.primask) HW_Sim_Isr(DMA2_Stream0_IRQHandler);
+        }
+
+        for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+            if (hw_sim.fan_edge_us[fan] != next) continue;
+            HW_Sim_FanUpdate();
+            // Làm tròn thời điểm hẹn tới µs: coi như đủ 1 xung nếu chỉ thiếu ~1 µs
+            if (hw_sim.fan_edge_real[fan] && !hw_sim.fan_blocked[fan] && hw_sim.fan_phase[fan] >= 0.999) {
+                hw_sim.fan_phase[fan] = (hw_sim.fan_phase[fan] > 1.0) ? hw_sim.fan_phase[fan] - 1.0 : 0.0;
+                HW_Sim_TachEdge(fan);
+            }
+            HW_Sim_FanSchedule(fan);
+        }
+
+        if (hw_sim.rtc_wut_enabled && hw_sim.rtc_wut_next_us == next) {
+            hw_sim.rtc_wut_next_us = HW_Sim_RTC_WakeupAt(++hw_sim.rtc_wut_count + 1);
+            hw_sim.rtc_wutf = 1;
+            if (!hw_sim.primask) HW_Sim_Isr(RTC_WKUP_IRQHandler);
+        }
+
+        // SysTick cùng thời điểm có thể vừa nạp lại IWDG
+        if (hw_sim.iwdg_enabled && hw_sim.iwdg_expire_us <= next) HW_Sim_WatchdogReset();
+
+        if (hw_sim.tick_hook && hw_sim.hook_next_us == next) {
+            hw_sim.hook_next_us += 1000;
+            hw_sim.tick_hook();
+        }
+    }
+    hw_sim.now_us = target;
+
+    if (stop) longjmp(sim_exit, 1);
+}
+
+
+/**
+ * @brief Chạy hàm main của firmware tới thời điểm ảo `until_us` rồi quay về
+ *
+ * Firmware chỉ nhường quyền điều khiển ở các điểm bận chờ (HW_Spin), nên
+ * trạng thái khi dừng luôn là trạng thái giữa hai lệnh của vòng lặp chính.
+ */
+void HW_Sim_Run(int (*entry)(void), uint64_t until_us) {
+    if (until_us <= hw_sim.now_us) return;
+
+    hw_sim.run_until_us = until_us;
+    hw_sim.running = 1;
+    if (setjmp(sim_exit) == 0) {
+        entry();
+    }
+    hw_sim.running = 0;
+
+    // CPU đã bị IWDG reset: không còn firmware, chỉ còn kịch bản chạy tới hết thời gian
+    if (hw_sim.halted && hw_sim.now_us < until_us) HW_Sim_Advance(until_us - hw_sim.now_us);
+}
+
+
+/**
+ * @brief Đặt điện áp (giá trị 12-bit) ở chân PA0 cho các lần chuyển đổi sau
+ */
+void HW_Sim_SetADC(uint16_t value) {
+    hw_sim.adc_input = value & 0x0FFF;
+}
+
+
+/**
+ * @brief Đặt nhiệt độ của NTC (°C): giá trị ADC ở PA4 tính theo công thức Beta
+ *        (cùng cầu phân áp với firmware, kẹp trong 0..4095)
+ */
+void HW_Sim_SetNtc(double celsius) {
+    double r = TEMP_NTC_R25 * exp(TEMP_NTC_BETA * (1.0 / (celsius + 273.15) - 1.0 / 298.15));
+    double adc = 4096.0 * r / (r + TEMP_NTC_R_FIXED);
+
+    hw_sim.adc_ntc = (uint16_t)(adc > 4095 ? 4095 : adc + 0.5);
+}
+
+
+/**
+ * @brief Giá trị 12-bit của 1 điện áp tuyệt đối, cho bằng giá trị `at_3v3` khi đo
+ *        với VDDA = 3,3 V (như các giá trị hiệu chuẩn), đo với VDDA hiện tại
+ */
+static uint16_t HW_Sim_AdcAbsolute(double at_3v3) {
+    double adc = at_3v3 * 3300.0 / hw_sim.vdda_mv;
+
+    return (uint16_t)(adc < 0 ? 0 : adc > 4095 ? 4095 : adc + 0.5);
+}
+
+
+/**
+ * @brief Đặt nhiệt độ chip (°C): cảm biến bên trong tuyến tính giữa 2 điểm hiệu chuẩn
+ */
+void HW_Sim_SetDie(double celsius) {
+    hw_sim.die_c = celsius;
+    hw_sim.adc_die = HW_Sim_AdcAbsolute(hw_sim.ts_cal[0] +
+                                        (celsius - 30.0) * (hw_sim.ts_cal[1] - hw_sim.ts_cal[0]) / 80.0);
+}
+
+
+/**
+ * @brief Đặt VDDA (mV): biến trở và NTC tỉ lệ theo VDDA nên không đổi, cảm biến
+ *        nhiệt bên trong và VREFINT là điện áp tuyệt đối nên đổi theo
+ */
+void HW_Sim_SetVdda(uint32_t mv) {
+    hw_sim.vdda_mv = mv;
+    hw_sim.adc_vref = HW_Sim_AdcAbsolute(hw_sim.vrefint_cal);
+    HW_Sim_SetDie(hw_sim.die_c);
+}
+
+
+/**
+ * @brief Gọi ISR cho các đường EXTI đang pending và không bị che
+ */
+static void HW_Sim_DispatchEXTI(void) {
+    if (hw_sim.exti_pr & hw_sim.exti_imr & HW_EXTI_PB0) HW_Sim_Isr(EXTI0_IRQHandler);
+    if (hw_sim.exti_pr & hw_sim.exti_imr & HW_EXTI_PB1) HW_Sim_Isr(EXTI1_IRQHandler);
+    if (hw_sim.exti_pr & hw_sim.exti_imr & (HW_EXTI_PA6 | HW_EXTI_PA7)) HW_Sim_Isr(EXTI9_5_IRQHandler);
+}
+
+
+/**
+ * @brief Tạo cạnh xuống trên các đường EXTI và gọi ISR nếu đường đó không bị che
+ */
+void HW_Sim_TriggerEXTI(uint32_t lines) {
+    hw_sim.exti_pr |= lines;
+    if (!hw_sim.primask) HW_Sim_DispatchEXTI();
+}
+
+
+// ======== Core ========
+
+/**
+ * @brief Vòng bận chờ: nhảy thẳng tới ngắt SysTick kế tiếp thay vì quay vô ích
+ */
+void HW_Spin(void) {
+    if (!hw_sim.systick_enabled) {
+        fprintf(stderr, "hw_sim: ban cho khi SysTick chua duoc khoi tao\n");
+        abort();
+    }
+    HW_Sim_Advance(hw_sim.systick_next_us - hw_sim.now_us);
+}
+
+/**
+ * @brief Có ngắt đang chờ đủ để đánh thức CPU khỏi WFI/Stop
+ */
+static uint8_t HW_Sim_WakePending(void) {
+    return hw_sim.systick_pending || hw_sim.tim5_uif || hw_sim.rtc_wutf
+        || (hw_sim.tach_sr & (HW_TACH_UPDATE | HW_TACH_CAPTURE_ALL)) || hw_sim.adc_dma_flags
+        || HW_Sim_ADC_AwdPending() || (hw_sim.exti_pr & hw_sim.exti_imr);
+}
+
+
+/**
+ * @brief WFI: ngủ tới ngắt kế tiếp. Trong mô hình chỉ có SysTick, TIM5, TIM3
+ *        (tràn, cạnh tach) và DMA của ADC tự đến theo thời gian (EXTI do kịch bản tạo trong tick_hook),
+ *        nên thức dậy ở ngắt sớm nhất trong các nguồn đó, hoặc trả về ngay nếu đã có
+ *        ngắt pending.
+ */
+void HW_WaitForInterrupt(void) {
+    uint64_t start = hw_sim.now_us;
+    uint64_t next = hw_sim.systick_next_us;
+
+    hw_sim.wfi_count++;
+    if (HW_Sim_WakePending()) return;
+    if (!hw_sim.systick_enabled) HW_Spin();   // Báo lỗi: không có nguồn đánh thức
+
+    if (HW_Sim_TIM5_Running() && hw_sim.tim5_next_us < next) next = hw_sim.tim5_next_us;
+    if (HW_Sim_ADC_Running() && hw_sim.adc_dma_next_us < next) next = hw_sim.adc_dma_next_us;
+    if (HW_Sim_TACH_Running()) {
+        if (hw_sim.tach_update_us < next) next = hw_sim.tach_update_us;
+        for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+            if ((hw_sim.tach_mask & (1u << fan)) && hw_sim.fan_edge_real[fan] && hw_sim.fan_edge_us[fan] < next) {
+                next = hw_sim.fan_edge_us[fan];
+            }
+        }
+    }
+    hw_sim.sleeping = 1;
+    hw_sim.sleep_start_us = start;
+    HW_Sim_Advance(next - hw_sim.now_us);
+    hw_sim.sleeping = 0;
+    hw_sim.wfi_us += hw_sim.now_us - start;
+}
+
+void HW_IRQ_Disable(void) {
+    hw_sim.primask = 1;
+}
+
+/**
+ * @brief Bật lại ngắt: chạy ngay các ISR bị hoãn trong lúc PRIMASK = 1
+ */
+void HW_IRQ_Enable(void) {
+    hw_sim.primask = 0;
+    if (hw_sim.isr_depth) return;   // Trong ISR: ISR khác chỉ chạy sau khi ISR này kết thúc
+    if (hw_sim.systick_pending) {
+        hw_sim.systick_pending = 0;
+        HW_Sim_Isr(SysTick_Handler);
+    }
+    if (hw_sim.tim5_uif) HW_Sim_Isr(TIM5_IRQHandler);
+    if (hw_sim.tach_sr & (HW_TACH_UPDATE | HW_TACH_CAPTURE_ALL)) HW_Sim_Isr(TIM3_IRQHandler);
+    if (HW_Sim_ADC_AwdPending()) HW_Sim_Isr(ADC_IRQHandler);
+    if (hw_sim.adc_dma_flags) HW_Sim_Isr(DMA2_Stream0_IRQHandler);
+    if (hw_sim.rtc_wutf) HW_Sim_Isr(RTC_WKUP_IRQHandler);
+    HW_Sim_DispatchEXTI();
+}
+
+uint32_t HW_IRQ_Save(void) {
+    uint32_t primask = hw_sim.primask;
+    hw_sim.primask = 1;
+    return primask;
+}
+
+void HW_IRQ_Restore(uint32_t primask) {
+    if (!primask) HW_IRQ_Enable();
+}
+
+void HW_CycleCounter_Init(void) {
+}
+
+/**
+ * @brief DWT CYCCNT: chu kỳ CPU thức, không tính thời gian nằm trong WFI/Stop.
+ *        ISR chạy lúc CPU vừa thức (trước khi WFI trả về) thấy bộ đếm tại thời điểm ngủ.
+ */
+uint32_t HW_CycleCount(void) {
+    uint64_t now = hw_sim.sleeping ? hw_sim.sleep_start_us : hw_sim.now_us;
+    return (uint32_t)((now - hw_sim.wfi_us - hw_sim.stop_us) * (HW_CPU_HZ / 1000000));
+}
+
+void HW_SysTick_Init(uint32_t reload) {
+    hw_sim.systick_enabled = 1;
+    hw_sim.systick_reload = reload;
+    hw_sim.systick_period_us = (uint32_t)(((uint64_t)reload + 1) * 1000000 / HW_CPU_HZ);
+    hw_sim.systick_next_us = hw_sim.now_us + hw_sim.systick_period_us;
+}
+
+/**
+ * @brief Giá trị thanh ghi VAL: đếm lùi từ LOAD về 0 trong 1 chu kỳ SysTick
+ */
+uint32_t HW_SysTick_Value(void) {
+    uint64_t cycles = (hw_sim.systick_next_us - hw_sim.now_us) * (HW_CPU_HZ / 1000000);
+    return cycles ? (uint32_t)(cycles - 1) : 0;
+}
+
+uint8_t HW_SysTick_Pending(void) {
+    return hw_sim.systick_pending;
+}
+
+uint8_t HW_SysTick_Suspend(void) {
+    uint8_t pending = hw_sim.systick_pending;
+
+    hw_sim.systick_enabled = 0;
+    hw_sim.systick_pending = 0;
+    return pending;
+}
+
+void HW_SysTick_Resume(void) {
+    hw_sim.systick_enabled = 1;
+    hw_sim.systick_next_us = hw_sim.now_us + hw_sim.systick_period_us;
+}
+
+/**
+ * @brief Stop mode: SysTick đã dừng, chỉ RTC wakeup hoặc EXTI (do kịch bản tạo
+ *        trong tick_hook) đánh thức được CPU. Sau đó mất thêm thời gian khởi động lại.
+ */
+void HW_EnterStop(void) {
+    uint64_t start = hw_sim.now_us;
+
+    hw_sim.stop_count++;
+    hw_sim.stopped = 1;
+    hw_sim.sleeping = 1;
+    hw_sim.sleep_start_us = start;
+    while (!HW_Sim_WakePending()) {
+        uint64_t next = UINT64_MAX;
+
+        if (hw_sim.rtc_wut_enabled) next = hw_sim.rtc_wut_next_us;
+        if (hw_sim.iwdg_enabled && hw_sim.iwdg_expire_us < next) next = hw_sim.iwdg_expire_us;
+        if (hw_sim.tick_hook && hw_sim.hook_next_us < next) next = hw_sim.hook_next_us;
+        if (hw_sim.systick_enabled && hw_sim.systick_next_us < next) next = hw_sim.systick_next_us;
+        if (next == UINT64_MAX) {
+            fprintf(stderr, "hw_sim: Stop mode khong co nguon danh thuc\n");
+            abort();
+        }
+        HW_Sim_Advance(next - hw_sim.now_us);
+    }
+    hw_sim.sleeping = 0;
+    hw_sim.stop_us += hw_sim.now_us - start;
+
+    HW_Sim_Advance(HW_SIM_STOP_WAKE_US);
+
+    // TIM5/TIM3/ADC đứng yên suốt Stop và lúc khởi động lại clock: chạy tiếp từ chỗ dừng
+    hw_sim.stopped = 0;
+    hw_sim.tim5_next_us += hw_sim.now_us - start;
+    hw_sim.adc_dma_next_us += hw_sim.now_us - start;
+    hw_sim.tach_origin_us += hw_sim.now_us - start;
+    hw_sim.tach_update_us += hw_sim.now_us - start;
+}
+
+
+// ======== TIM5 ========
+
+void HW_TIM5_Init(uint16_t psc, uint32_t arr) {
+    hw_sim.tim5_enabled = 1;
+    hw_sim.tim5_period_us = (uint32_t)(((uint64_t)psc + 1) * ((uint64_t)arr + 1) * 1000000 / HW_TIM_HZ);
+    hw_sim.tim5_next_us = hw_sim.now_us + hw_sim.tim5_period_us;
+    hw_sim.tim5_uif = 0;
+}
+
+void HW_TIM5_ClearUpdate(void) {
+    hw_sim.tim5_uif = 0;
+}
+
+
+// ======== TIM3 CH1..CH4 (tach) ========
+
+void HW_TACH_Init(uint16_t psc, uint8_t icpsc_log2, uint8_t filter, uint8_t mask) {
+    (void)filter;                        // Mô hình không có nhiễu trên chân tach
+    hw_sim.tach_enabled = 1;
+    hw_sim.tach_mask = mask & ((1u << HW_FAN_COUNT) - 1);
+    hw_sim.tach_psc = psc;
+    hw_sim.tach_edges_log2 = icpsc_log2 & 3;
+    hw_sim.tach_sr = 0;
+    memset(hw_sim.tach_ccr, 0, sizeof(hw_sim.tach_ccr));
+    hw_sim.tach_origin_us = hw_sim.now_us;
+    hw_sim.tach_overflows = 0;
+    hw_sim.tach_update_us = HW_Sim_TACH_UpdateAt(1);
+    memset(hw_sim.tach_edge_count, 0, sizeof(hw_sim.tach_edge_count));
+}
+
+uint32_t HW_TACH_Flags(void) {
+    return hw_sim.tach_sr;
+}
+
+uint16_t HW_TACH_Capture(uint8_t fan) {
+    hw_sim.tach_sr &= ~HW_TACH_CAPTURE(fan);
+    return hw_sim.tach_ccr[fan];
+}
+
+/**
+ * @brief CNT của TIM3: số tick kể từ tach_origin_us (không tính thời gian Stop)
+ */
+uint16_t HW_TACH_Count(void) {
+    uint64_t ticks = (hw_sim.now_us - hw_sim.tach_origin_us) * HW_TIM_HZ
+                     / (((uint64_t)hw_sim.tach_psc + 1) * 1000000);
+    return (uint16_t)ticks;
+}
+
+void HW_TACH_Clear(uint32_t flags) {
+    hw_sim.tach_sr &= ~flags;
+}
+
+
+// ======== IWDG / reset / thanh ghi backup ========
+
+void HW_IWDG_Init(uint8_t pr, uint16_t rlr) {
+    hw_sim.iwdg_enabled = 1;
+    hw_sim.iwdg_timeout_us = (uint32_t)((4ull << pr) * ((uint64_t)rlr + 1) * 1000000 / HW_SIM_LSI_HZ);
+    hw_sim.iwdg_expire_us = hw_sim.now_us + hw_sim.iwdg_timeout_us;
+}
+
+void HW_IWDG_Feed(void) {
+    if (hw_sim.iwdg_enabled) hw_sim.iwdg_expire_us = hw_sim.now_us + hw_sim.iwdg_timeout_us;
+}
+
+uint8_t HW_ResetCause(void) {
+    uint8_t cause = hw_sim.reset_flags;
+
+    hw_sim.reset_flags = 0;
+    return cause;
+}
+
+uint32_t HW_Backup_Read(uint8_t idx) {
+    return hw_sim.bkp[idx];
+}
+
+void HW_Backup_Write(uint8_t idx, uint32_t value) {
+    hw_sim.bkp[idx] = value;
+}
+
+
+// ======== RTC ========
+
+void HW_RTC_Init(void) {
+    hw_sim.rtc_enabled = 1;
+    hw_sim.rtc_wut_enabled = 0;
+    hw_sim.rtc_wutf = 0;
+}
+
+/**
+ * @brief Bộ đếm RTC chạy liên tục từ lúc reset, độ phân giải 1/HW_RTC_HZ giây
+ */
+uint32_t HW_RTC_Now(void) {
+    return (uint32_t)((hw_sim.now_us * HW_RTC_HZ / 1000000) % HW_RTC_WRAP);
+}
+
+void HW_RTC_WakeupStart(uint32_t ticks) {
+    hw_sim.rtc_wut_enabled = 1;
+    hw_sim.rtc_wut_ticks = ticks;
+    hw_sim.rtc_wut_start_us = hw_sim.now_us;
+    hw_sim.rtc_wut_count = 0;
+    hw_sim.rtc_wut_next_us = HW_Sim_RTC_WakeupAt(1);
+    hw_sim.rtc_wutf = 0;
+}
+
+void HW_RTC_WakeupClear(void) {
+    hw_sim.rtc_wutf = 0;
+}
+
+void HW_RTC_WakeupStop(void) {
+    hw_sim.rtc_wut_enabled = 0;
+    hw_sim.rtc_wutf = 0;
+}
+
+
+// ======== LED ========
+
+void HW_LED_Init(void) {
+    hw_sim.led = 0;
+}
+
+void HW_LED_Write(uint8_t mask) {
+    hw_sim.led = mask & 0x7;
+}
+
+
+// ======== PWM ========
+
+uint32_t HW_PWM_ClockHz(void) {
+    return HW_TIM_HZ;
+}
+
+void HW_PWM_Init(uint16_t psc, uint16_t arr) {
+    HW_Sim_FanUpdate();
+    hw_sim.pwm_psc = psc;
+    hw_sim.pwm_arr = arr;
+    memset(hw_sim.pwm_ccr, 0, sizeof(hw_sim.pwm_ccr));
+}
+
+void HW_PWM_SetCompare(uint8_t fan, uint16_t ccr) {
+    if (ccr != hw_sim.pwm_ccr[fan]) HW_Sim_FanUpdate();
+    hw_sim.pwm_ccr[fan] = ccr;
+}
+
+uint16_t HW_PWM_GetCompare(uint8_t fan) {
+    return hw_sim.pwm_ccr[fan];
+}
+
+
+// ======== ADC ========
+
+/**
+ * @brief Bắt đầu quét: nửa đầu bộ đệm đầy sau count / 2 lần chuyển đổi
+ */
+void HW_ADC_Init(volatile uint16_t* buf, uint16_t count) {
+    hw_sim.adc_enabled = 1;
+    hw_sim.adc_dma_buf = buf;
+    hw_sim.adc_dma_count = count;
+    hw_sim.adc_dma_half = 0;
+    hw_sim.adc_dma_flags = 0;
+    hw_sim.adc_dma_period_us = (uint32_t)(((uint64_t)(count / 2) * HW_ADC_CONV_CYCLES * 1000000 +
+                                           HW_ADC_CLK_HZ / 2) / HW_ADC_CLK_HZ);
+    hw_sim.adc_dma_next_us = hw_sim.now_us + hw_sim.adc_dma_period_us;
+}
+
+uint32_t HW_ADC_DmaFlags(void) {
+    return hw_sim.adc_dma_flags;
+}
+
+void HW_ADC_DmaClear(uint32_t flags) {
+    hw_sim.adc_dma_flags &= ~flags;
+}
+
+uint8_t HW_ADC_Overrun(void) {
+    return 0;   // DMA trong mô hình luôn kịp đọc DR
+}
+
+void HW_ADC_Restart(uint16_t count) {
+    HW_ADC_Init(hw_sim.adc_dma_buf, count);
+}
+
+void HW_ADC_WatchdogArm(uint16_t low, uint16_t high) {
+    hw_sim.adc_awd_low = low;
+    hw_sim.adc_awd_high = high;
+    hw_sim.adc_awd_flag = 0;
+    hw_sim.adc_awd_armed = 1;
+}
+
+void HW_ADC_WatchdogDisarm(void) {
+    hw_sim.adc_awd_armed = 0;
+    hw_sim.adc_awd_flag = 0;
+}
+
+uint8_t HW_ADC_WatchdogFired(void) {
+    return HW_Sim_ADC_AwdPending();
+}
+
+uint16_t HW_TS_Cal30(void) {
+    return hw_sim.ts_cal[0];
+}
+
+uint16_t HW_TS_Cal110(void) {
+    return hw_sim.ts_cal[1];
+}
+
+uint16_t HW_VREFINT_Cal(void) {
+    return hw_sim.vrefint_cal;
+}
+
+
+// ======== I2C1 ========
+
+/**
+ * @brief Kết thúc transaction hiện tại: chuyển toàn bộ byte đã gửi cho mô hình OLED
+ *        (bus đang kẹt hoặc OLED không ACK thì transaction không tới được OLED)
+ */
+static void HW_Sim_I2C_Flush(void) {
+    if (hw_sim.i2c_started && !hw_sim.i2c_addr_phase && !hw_sim.i2c_stuck && !hw_sim.i2c_nack) {
+        SSD1306Sim_Transfer(&oled_sim, hw_sim.i2c_addr, hw_sim.i2c_buf, hw_sim.i2c_len);
+    }
+    hw_sim.i2c_started = 0;
+    hw_sim.i2c_len = 0;
+}
+
+void HW_I2C1_Init(void) {
+    hw_sim.i2c_sr1 = 0;
+    hw_sim.i2c_started = 0;
+    hw_sim.i2c_len = 0;
+}
+
+void HW_I2C1_Start(void) {
+    HW_Sim_I2C_Flush();                  // START lặp lại kết thúc transaction trước
+    if (hw_sim.i2c_byte_us) HW_Sim_Advance(HW_SIM_I2C_COND_US);
+    hw_sim.i2c_started = 1;
+    hw_sim.i2c_addr_phase = 1;
+    hw_sim.i2c_sr1 = HW_I2C_SB;
+}
+
+void HW_I2C1_Stop(void) {
+    if (hw_sim.i2c_byte_us) HW_Sim_Advance(HW_SIM_I2C_COND_US);
+    HW_Sim_I2C_Flush();
+    hw_sim.i2c_sr1 = 0;
+    hw_sim.i2c_last_us = hw_sim.now_us;
+}
+
+/**
+ * @brief Đọc SR1. Khi slave giữ SCL (i2c_stuck) không cờ nào lên, và mỗi lần vòng
+ *        chờ đọc lại mất ~1 µs: I2C_TIMEOUT lần chờ thành ~0,1 s cho mỗi byte.
+ */
+uint32_t HW_I2C1_Status(void) {
+    if (hw_sim.i2c_stuck) {
+        HW_Sim_Advance(1);
+        return 0;
+    }
+    return hw_sim.i2c_sr1;
+}
+
+void HW_I2C1_ClearAddr(void) {
+    hw_sim.i2c_sr1 &= ~HW_I2C_ADDR;
+}
+
+void HW_I2C1_Write(uint8_t data) {
+    if (!hw_sim.i2c_started) return;     // Ghi DR khi chưa START: bị bỏ qua
+
+    // Driver chờ cờ TXE/BTF ngay sau khi ghi: tính luôn thời gian truyền byte
+    if (hw_sim.i2c_byte_us) HW_Sim_Advance(hw_sim.i2c_byte_us);
+
+    if (hw_sim.i2c_addr_phase) {
+        hw_sim.i2c_addr = data >> 1;
+        hw_sim.i2c_addr_phase = 0;
+        hw_sim.i2c_sr1 = (hw_sim.i2c_addr == SSD1306_SIM_ADDR && !hw_sim.i2c_nack) ?
+                         (HW_I2C_ADDR | HW_I2C_TXE) : HW_I2C_AF;
+        return;
+    }
+
+    if (hw_sim.i2c_len < sizeof(hw_sim.i2c_buf)) {
+        hw_sim.i2c_buf[hw_sim.i2c_len++] = data;
+    }
+    hw_sim.i2c_sr1 = HW_I2C_TXE | HW_I2C_BTF;
+}
+
+
+// ======== EXTI ========
+
+void HW_EXTI_Init(void) {
+    hw_sim.exti_imr |= HW_EXTI_PB0 | HW_EXTI_PB1 | HW_EXTI_PA6 | HW_EXTI_PA7;
+}
+
+uint32_t HW_EXTI_Pending(uint32_t lines) {
+    return hw_sim.exti_pr & lines;
+}
+
+void HW_EXTI_Clear(uint32_t lines) {
+    hw_sim.exti_pr &= ~lines;
+}
+
+void HW_EXTI_Enable(uint32_t lines) {
+    hw_sim.exti_imr |= lines;
+}
+
+void HW_EXTI_Disable(uint32_t lines) {
+    hw_sim.exti_imr &= ~lines;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
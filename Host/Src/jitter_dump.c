@@ -0,0 +1,110 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include <stdio.h>        // printf, fopen, fread
+#include "sched.h"        // Sched_JitterLog, SCHED_HIST_BUCKETS
+
+// Độ rộng tối đa của thanh histogram (ký tự)
+#define BAR_WIDTH  40
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Ghi nhãn khoảng độ trễ của ô `bucket` (µs hoặc ms) vào `buf`
+ */
+static void Jitter_BucketLabel(uint8_t bucket, char* buf, size_t len) {
+    uint32_t lo = bucket ? (1u << (bucket - 1)) : 0;
+
+    if (bucket == 0) {
+        snprintf(buf, len, "0 us");
+    } else if (bucket == SCHED_HIST_BUCKETS - 1) {
+        snprintf(buf, len, ">= %.0f ms", lo / 1e3);
+    } else if (lo < 1000) {
+        snprintf(buf, len, "%u-%u us", lo, (1u << bucket) - 1);
+    } else {
+        snprintf(buf, len, "%.1f-%.1f ms", lo / 1e3, (1u << bucket) / 1e3);
+    }
+}
+
+
+/**
+ * @brief In histogram độ trễ của 1 tác vụ định kỳ
+ */
+static void Jitter_Print(const Sched_Jitter* j) {
+    char name[SCHED_NAME_LEN + 1] = {0};
+    uint32_t peak = 0, cum = 0;
+
+    for (uint8_t i = 0; i < SCHED_NAME_LEN; i++) name[i] = j->name[i];
+    for (uint8_t b = 0; b < SCHED_HIST_BUCKETS; b++) {
+        if (j->hist[b] > peak) peak = j->hist[b];
+    }
+
+    printf("%s: period %.0f ms, %u runs (+%u forced, not in histogram), late max %.3f ms\n",
+           name, j->period / 1e3, j->samples, j->forced, j->late_max / 1e3);
+    if (!j->samples) return;
+
+    for (uint8_t b = 0; b < SCHED_HIST_BUCKETS; b++) {
+        char label[24];
+        int bar;
+
+        if (!j->hist[b]) continue;
+        cum += j->hist[b];
+        bar = (int)((uint64_t)j->hist[b] * BAR_WIDTH / peak);
+        Jitter_BucketLabel(b, label, sizeof(label));
+        printf("  %-16s %8u %6.2f%% |%.*s\n", label, j->hist[b],
+               cum * 100.0 / j->samples, bar ? bar : 1,
+               "########################################");
+    }
+}
+
+
+/**
+ * @brief In histogram độ trễ các tác vụ định kỳ từ bản dump bộ nhớ `sched_jitter`
+ *
+ * Cách dùng: jitter_dump <file.bin>
+ *   Trên board (GDB):  dump binary value jitter.bin sched_jitter
+ *   Trên host:         sim -j jitter.bin [kịch_bản.txt]
+ *   Cột % là phần trăm tích lũy: tỉ lệ số lần chạy có độ trễ tới hết ô đó.
+ */
+int main(int argc, char** argv) {
+    Sched_JitterLog log;
+    FILE* f;
+    size_t n;
+
+    if (argc != 2) {
+        fprintf(stderr, "cach dung: jitter_dump <file.bin>\n");
+        return 2;
+    }
+
+    f = fopen(argv[1], "rb");
+    if (!f) {
+        fprintf(stderr, "khong mo duoc %s\n", argv[1]);
+        return 2;
+    }
+    n = fread(&log, 1, sizeof(log), f);
+    fclose(f);
+
+    if (n != sizeof(log)) {
+        fprintf(stderr, "%s: %zu byte, ban dump sched_jitter phai dung %zu byte\n",
+                argv[1], n, sizeof(log));
+        return 1;
+    }
+    if (log.magic != SCHED_JITTER_MAGIC || log.slots != SCHED_MAX_TASKS) {
+        fprintf(stderr, "%s: khong phai ban dump sched_jitter\n", argv[1]);
+        return 1;
+    }
+
+    for (uint8_t id = 0; id < SCHED_MAX_TASKS; id++) {
+        if (log.job[id].period) Jitter_Print(&log.job[id]);
+    }
+    return 0;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
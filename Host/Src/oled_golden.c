@@ -0,0 +1,148 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include <stdio.h>        // printf, snprintf
+#include <string.h>       // strcmp
+#include "hw.h"           // HW_Sim_Reset (vi điều khiển giả lập)
+#include "i2c.h"          // I2C1_Init
+#include "system.h"       // SysTick_Init (Delay_ms trong SSD1306_Init)
+#include "oled.h"         // Các hàm vẽ của firmware
+#include "ssd1306_sim.h"  // Mô hình SSD1306
+#include "pbm.h"          // Đọc/ghi/so sánh ảnh PBM
+#include "fsm.h"          // Mã trạng thái thiết bị, fsm_states (quạt có chạy không)
+#include "temp.h"         // TEMP_INVALID
+
+/**
+ * @brief Một trạng thái giao diện cần chụp lại
+ */
+typedef struct {
+    const char* name;     // Tên file ảnh (không có đuôi .pbm)
+    uint8_t state;        // Fsm_State
+    uint8_t mode;         // Mode hiện tại
+    uint8_t countdown;    // Số giây còn lại
+    uint16_t rpm;         // Tốc độ quạt 0 đo bằng tach
+    uint16_t target_rpm;  // RPM đặt (chế độ RPM), 0: không in
+    int16_t ntc_dc;       // Nhiệt độ NTC (0,1 °C), TEMP_INVALID nếu chập/hở
+    int16_t die_dc;       // Nhiệt độ chip (0,1 °C), TEMP_INVALID khi chưa đo được
+    uint8_t temp_auto;    // Quạt chạy theo nhiệt độ
+} GoldenCase;
+
+// Tất cả màn hình mà main.c có thể vẽ ra (trang trạng thái; dòng nhiệt độ và RPM
+// chỉ có ở các trạng thái quạt chạy)
+static const GoldenCase cases[] = {
+    {"ready",            FSM_ST_READY,     1, 0,  0,    0,    250,  320, 0},
+    {"stopped",          FSM_ST_OFF,       0, 0,  0,    0,    250,  320, 0},
+    {"inf_mode0",        FSM_ST_RUN,       0, 0,  0,    0,    250,  320, 0},
+    {"inf_mode1",        FSM_ST_RUN,       1, 0,  820,  0,    250,  320, 0},
+    {"inf_mode2",        FSM_ST_RUN,       2, 0,  1450, 0,    250,  320, 0},
+    {"inf_mode3",        FSM_ST_RUN,       3, 0,  2100, 0,    250,  320, 0},
+    {"countdown_m1_10s", FSM_ST_COUNTDOWN, 1, 10, 820,  0,    250,  320, 0},
+    {"countdown_m2_20s", FSM_ST_COUNTDOWN, 2, 20, 1450, 0,    250,  320, 0},
+    {"countdown_m3_30s", FSM_ST_COUNTDOWN, 3, 30, 2100, 0,    250,  320, 0},
+    {"countdown_m2_1s",  FSM_ST_COUNTDOWN, 2, 1,  1450, 0,    250,  320, 0},
+    {"countdown_m1_0s",  FSM_ST_COUNTDOWN, 1, 0,  820,  0,    250,  320, 0},
+    {"rpm_setpoint",     FSM_ST_RUN,       2, 0,  1187, 1200, 250,  320, 0},
+    {"temp_auto",        FSM_ST_RUN,       2, 0,  1450, 0,    452,  512, 1},
+    {"temp_negative",    FSM_ST_RUN,       1, 0,  820,  0,    -125, -32, 0},
+    {"temp_wide_auto",   FSM_ST_RUN,       3, 0,  2100, 0,    -118, 1046, 1},
+    {"temp_ntc_fault",   FSM_ST_RUN,       1, 0,  820,  0,    TEMP_INVALID, 320, 0},
+    {"temp_die_invalid", FSM_ST_RUN,       1, 0,  820,  0,    250,  TEMP_INVALID, 0},
+    {"temp_all_invalid", FSM_ST_RUN,       1, 0,  0,    0,    TEMP_INVALID, TEMP_INVALID, 1},
+};
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Vẽ 1 trạng thái qua driver thật (theo đúng thứ tự Task_Display trong main.c)
+ *        và chụp ảnh từ mô hình SSD1306
+ */
+static void Golden_Render(const GoldenCase* c, PBM_Image image) {
+    HW_Sim_Reset();
+    SysTick_Init();
+    I2C1_Init();
+    SSD1306_Init();
+    SSD1306Sim_ResetStats(&oled_sim);
+
+    SSD1306_DisplayState(c->state, c->mode, c->countdown);
+    if (fsm_states[c->state].fan_on) {
+        SSD1306_DisplayTemp(6, c->ntc_dc, c->die_dc, c->temp_auto);
+        SSD1306_DisplayRpm(c->rpm, c->target_rpm);
+    }
+    SSD1306Sim_Capture(&oled_sim, image);
+}
+
+
+/**
+ * @brief Vẽ mọi trạng thái giao diện và so sánh với ảnh golden
+ *
+ * Cách dùng: oled_golden [-u] [-o out_dir] golden_dir
+ *   -u          ghi đè ảnh golden bằng kết quả hiện tại
+ *   -o out_dir  nơi ghi ảnh vừa vẽ và ảnh diff (mặc định: thư mục hiện tại)
+ */
+int main(int argc, char** argv) {
+    const char* golden_dir = NULL;
+    const char* out_dir = ".";
+    uint8_t update = 0;
+    int failures = 0;
+    char path[512];
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-u")) update = 1;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) out_dir = argv[++i];
+        else golden_dir = argv[i];
+    }
+    if (!golden_dir) {
+        fprintf(stderr, "usage: %s [-u] [-o out_dir] golden_dir\n", argv[0]);
+        return 2;
+    }
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const GoldenCase* c = &cases[i];
+        PBM_Image actual, expected, diff;
+        uint32_t mismatch;
+
+        Golden_Render(c, actual);
+
+        if (update) {
+            snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, c->name);
+            if (!PBM_Write(path, actual)) {
+                fprintf(stderr, "%s: khong ghi duoc %s\n", c->name, path);
+                failures++;
+            }
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s.pbm", out_dir, c->name);
+        PBM_Write(path, actual);
+
+        snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, c->name);
+        if (!PBM_Read(path, expected)) {
+            printf("FAIL %-18s thieu anh golden %s\n", c->name, path);
+            failures++;
+            continue;
+        }
+
+        mismatch = PBM_Diff(actual, expected, diff);
+        if (mismatch || oled_sim.violations) {
+            snprintf(path, sizeof(path), "%s/%s.diff.pbm", out_dir, c->name);
+            PBM_Write(path, diff);
+            printf("FAIL %-18s %u diem anh khac, %u loi giao thuc (diff: %s)\n",
+                   c->name, mismatch, oled_sim.violations, path);
+            failures++;
+        } else {
+            printf("ok   %-18s %u transaction, %u byte\n",
+                   c->name, oled_sim.transactions, oled_sim.bus_bytes);
+        }
+    }
+
+    return failures ? 1 : 0;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
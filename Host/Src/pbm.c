@@ -0,0 +1,124 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include "pbm.h"          // Khai báo hàm đọc/ghi ảnh PBM
+#include <stdio.h>        // fopen, fprintf, fscanf
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Ghi ảnh ra file PBM dạng text (P1) để dễ xem diff trong git
+ * @return 1 nếu thành công, 0 nếu không mở được file
+ */
+uint8_t PBM_Write(const char* path, PBM_Image image) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+
+    fprintf(f, "P1\n%d %d\n", SSD1306_SIM_WIDTH, SSD1306_SIM_HEIGHT);
+    for (int y = 0; y < SSD1306_SIM_HEIGHT; y++) {
+        // Mỗi hàng chia làm 2 dòng 64 ký tự (chuẩn PBM giới hạn 70 ký tự/dòng)
+        for (int x = 0; x < SSD1306_SIM_WIDTH; x++) {
+            fputc(image[y][x] ? '1' : '0', f);
+            if ((x & 63) == 63) fputc('\n', f);
+        }
+    }
+
+    fclose(f);
+    return 1;
+}
+
+
+/**
+ * @brief Bỏ qua khoảng trắng và chú thích (#...) trong header PBM
+ */
+static void PBM_SkipSpace(FILE* f) {
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (c == '#') {
+            while ((c = fgetc(f)) != EOF && c != '\n');
+        } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            ungetc(c, f);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Đọc ảnh PBM (P1 hoặc P4) đúng kích thước 128x64
+ * @return 1 nếu thành công, 0 nếu file lỗi hoặc sai kích thước
+ */
+uint8_t PBM_Read(const char* path, PBM_Image image) {
+    FILE* f = fopen(path, "rb");
+    char magic[3] = {0};
+    int w = 0, h = 0;
+    uint8_t ok = 1;
+
+    if (!f) return 0;
+
+    if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || (magic[1] != '1' && magic[1] != '4')) {
+        fclose(f);
+        return 0;
+    }
+    PBM_SkipSpace(f);
+    if (fscanf(f, "%d", &w) != 1) ok = 0;
+    PBM_SkipSpace(f);
+    if (ok && fscanf(f, "%d", &h) != 1) ok = 0;
+    if (!ok || w != SSD1306_SIM_WIDTH || h != SSD1306_SIM_HEIGHT) {
+        fclose(f);
+        return 0;
+    }
+
+    if (magic[1] == '1') {
+        // P1: mỗi điểm ảnh là 1 ký tự '0'/'1', có thể cách nhau bởi khoảng trắng
+        for (int y = 0; y < h && ok; y++) {
+            for (int x = 0; x < w && ok; x++) {
+                PBM_SkipSpace(f);
+                int c = fgetc(f);
+                if (c != '0' && c != '1') ok = 0;
+                else image[y][x] = (uint8_t)(c - '0');
+            }
+        }
+    } else {
+        // P4: 1 khoảng trắng rồi tới dữ liệu nhị phân, MSB là điểm bên trái
+        fgetc(f);
+        for (int y = 0; y < h && ok; y++) {
+            for (int x = 0; x < w; x += 8) {
+                int b = fgetc(f);
+                if (b == EOF) { ok = 0; break; }
+                for (int i = 0; i < 8; i++) image[y][x + i] = (b >> (7 - i)) & 1;
+            }
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+
+
+/**
+ * @brief So sánh 2 ảnh, đánh dấu các điểm khác nhau vào ảnh diff
+ * @param diff Ảnh kết quả (1 tại điểm khác nhau), có thể NULL
+ * @return Số điểm ảnh khác nhau
+ */
+uint32_t PBM_Diff(PBM_Image a, PBM_Image b, PBM_Image diff) {
+    uint32_t count = 0;
+
+    for (int y = 0; y < SSD1306_SIM_HEIGHT; y++) {
+        for (int x = 0; x < SSD1306_SIM_WIDTH; x++) {
+            uint8_t d = (a[y][x] != b[y][x]);
+            if (diff) diff[y][x] = d;
+            count += d;
+        }
+    }
+    return count;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
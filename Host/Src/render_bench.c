@@ -0,0 +1,99 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include <stdio.h>        // printf
+#include <stdlib.h>       // atoi
+#include <time.h>         // clock_gettime
+#include "hw.h"           // HW_Sim_Reset
+#include "i2c.h"          // I2C1_Init
+#include "oled.h"         // Các hàm vẽ của firmware
+#include "system.h"       // SysTick_Init
+#include "ssd1306_sim.h"  // Thống kê bus của mô hình SSD1306
+#include "fsm.h"          // Mã trạng thái thiết bị
+
+// Tốc độ bus I2C1 trên board (Standard mode)
+#define BENCH_I2C_HZ  100000
+
+/**
+ * @brief Một màn hình cần đo
+ */
+typedef struct {
+    const char* name;
+    uint8_t state;
+    uint8_t mode;
+    uint8_t countdown;
+} BenchCase;
+
+static const BenchCase cases[] = {
+    {"ready",        FSM_ST_READY,     1, 0},
+    {"stopped",      FSM_ST_OFF,       0, 0},
+    {"inf_mode2",    FSM_ST_RUN,       2, 0},
+    {"countdown_20", FSM_ST_COUNTDOWN, 2, 20},
+};
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+static double Bench_Seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * @brief Đo chi phí vẽ từng màn hình qua driver thật + I2C giả lập
+ *
+ * In ra: thời gian CPU trên host mỗi frame, số byte/transaction I2C mỗi frame
+ * và thời gian bus ước tính trên board (9 bit/byte + START/STOP ở 100 kHz).
+ * Số byte/frame là chỉ số xác định, dùng để phát hiện hồi quy hiệu năng.
+ *
+ * Cách dùng: render_bench [số_frame]   (mặc định 2000)
+ */
+int main(int argc, char** argv) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 2000;
+    if (frames <= 0) frames = 1;
+
+    HW_Sim_Reset();
+    SysTick_Init();
+    I2C1_Init();
+    SSD1306_Init();
+
+    printf("%-14s %10s %10s %10s %12s\n", "screen", "host_us", "bytes", "xfers", "i2c_ms@100k");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const BenchCase* c = &cases[i];
+        double t0, t1;
+        double bytes, xfers, bus_ms;
+
+        SSD1306Sim_ResetStats(&oled_sim);
+
+        t0 = Bench_Seconds();
+        for (int n = 0; n < frames; n++) {
+            SSD1306_DisplayState(c->state, c->mode, c->countdown);
+        }
+        t1 = Bench_Seconds();
+
+        bytes = (double)oled_sim.bus_bytes / frames;
+        xfers = (double)oled_sim.transactions / frames;
+        bus_ms = (bytes * 9 + xfers * 2) * 1000.0 / BENCH_I2C_HZ;
+
+        printf("%-14s %10.2f %10.0f %10.0f %12.1f\n",
+               c->name, (t1 - t0) * 1e6 / frames, bytes, xfers, bus_ms);
+
+        if (oled_sim.violations) {
+            printf("  %u loi giao thuc: %s\n", oled_sim.violations, oled_sim.last_violation);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
@@ -0,0 +1,1159 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include <stdio.h>        // printf, fopen, fgets
+#include <stdlib.h>       // strtoul
+#include <string.h>       // strcmp, strncmp
+#include <time.h>         // clock_gettime (đo tốc độ mô phỏng)
+#include "hw.h"           // Vi điều khiển giả lập
+#include "ssd1306_sim.h"  // Mô hình OLED
+#include "pbm.h"          // Ghi frame ra file PBM
+#include "sched.h"        // Thống kê tác vụ của firmware
+#include "system.h"       // Thống kê thời gian ngủ
+#include "evq.h"          // Thống kê hàng đợi sự kiện nút nhấn
+#include "fsm.h"          // Bảng chuyển trạng thái (kiểm tra -s)
+#include "exti.h"         // GPIO_EXTI_Init
+#include "led.h"          // LED_Init, LED_Update
+#include "pwm.h"          // PWM_Init, Update_PWM_From_Mode, bộ giải PSC/ARR (kiểm tra -p)
+#include "cpuload.h"      // Tải CPU theo ngữ cảnh, trang OLED debug
+#include "control.h"      // Thống kê vòng điều khiển TIM5
+#include "wdg.h"          // Watchdog: tên tác vụ, thanh ghi backup
+#include "fancurve.h"     // Chọn đường cong quạt (lệnh curve)
+#include "tach.h"         // Tốc độ quạt firmware đo được (expect rpm)
+#include "temp.h"         // Nhiệt độ firmware đo được (expect temp)
+#include "adc.h"          // Thống kê khối mẫu ADC (DMA)
+
+// main() của firmware (Core/Src/main.c, đổi tên khi build cho host)
+int Firmware_Main(void);
+
+#define SIM_MAX_EVENTS    1024
+#define SIM_FRAME_IDLE_US 2000   // Bus I2C rảnh bấy lâu thì coi như đã vẽ xong 1 frame
+#define SIM_RPM_TOL_PCT   3      // expect rpm: sai số cho phép (%, tối thiểu 30 RPM)
+#define SIM_SETTLE_PCT    2      // expect settle: dải xác lập quanh RPM đặt (%, tối thiểu 30 RPM)
+#define SIM_TEMP_TOL_DC   10     // expect temp: sai số cho phép (0,1 °C)
+
+// Các lệnh trong kịch bản
+enum {
+    SIM_CMD_POT,          // pot <giá trị>
+    SIM_CMD_SWEEP,        // sweep <từ> <đến> <thời gian>
+    SIM_CMD_PRESS,        // press <PA6|PA7|PB0|PB1>
+    SIM_CMD_EXPECT_PWM,   // expect pwm <duty %> [quạt]
+    SIM_CMD_EXPECT_LED,   // expect led <mask>
+    SIM_CMD_EXPECT_DRIFT, // expect drift <ms>: |system_tick − thời gian ảo| ≤ ms từ lần kiểm tra trước
+    SIM_CMD_PAGE,         // page <main|cpu|fans>: trang OLED (cpu_load_page)
+    SIM_CMD_CURVE,        // curve <step|linear|quiet> [quạt]: đường cong ADC → duty
+    SIM_CMD_FAN,          // fan <block|free|max <rpm>> [quạt]: kẹt / thả rôto, đổi tốc độ ở 100 % của quạt
+    SIM_CMD_CONTROL,      // control <curve|rpm|temp>: vòng hở theo đường cong / vòng kín PID tốc độ /
+                          //   tự động theo nhiệt độ khi biến trở ở vùng tắt
+    SIM_CMD_TEMP,         // temp <ntc|die> <°C>, temp ntc <open|short>: nhiệt độ cảm biến
+    SIM_CMD_EXPECT_TEMP,  // expect temp <°C>: nhiệt độ điều khiển firmware đo được (sai số 1 °C)
+    SIM_CMD_VDDA,         // vdda <mV>: điện áp tham chiếu ADC (cảm biến bên trong, VREFINT đổi theo)
+    SIM_CMD_NOISE,        // noise <lsb>: nhiễu đều ± lsb trên từng mẫu của biến trở
+    SIM_CMD_SPIKES,       // spikes <on|off>: 1 mẫu biến trở bị gai trong mỗi nửa bộ đệm DMA
+    SIM_CMD_EXPECT_LEDCHANGES, // expect ledchanges <n>: LED đổi ≤ n lần từ lần kiểm tra trước
+    SIM_CMD_EXPECT_POTBLOCKS,  // expect potblocks <n>: biến trở được lọc ≤ n khối từ lần kiểm tra trước
+    SIM_CMD_RAMP,         // ramp <start|up|down|stop> <ms> <linear|ease|scurve>: profile ramp PWM
+    SIM_CMD_EXPECT_SETTLE,// expect settle <ms> <vọt lố %>: đáp ứng bậc gần nhất của vòng kín
+    SIM_CMD_EXPECT_RPM,   // expect rpm <rpm> [quạt]: tốc độ firmware đo được (sai số SIM_RPM_TOL_PCT %)
+    SIM_CMD_STALL,        // stall <i2c|adc|control|oled>: gây treo để kiểm tra watchdog
+    SIM_CMD_EXPECT_RESET, // expect reset <tác vụ|none>: IWDG đã reset do tác vụ đó treo (none: chưa reset)
+    SIM_CMD_END,          // end
+};
+
+/**
+ * @brief Một sự kiện trong kịch bản, xảy ra tại thời điểm ảo t_ms
+ */
+typedef struct {
+    uint32_t t_ms;
+    uint8_t cmd;
+    uint32_t a, b, c;
+    uint8_t fan;          // Quạt của lệnh (0-based; kịch bản đánh số từ 1, mặc định quạt 1)
+    uint16_t line;        // Dòng trong file kịch bản (để báo lỗi)
+} SimEvent;
+
+// Kịch bản mặc định: 1 giờ vận hành với đủ các loại thao tác
+static const char* const default_script[] = {
+    "0      pot 100",
+    "3s     pot 2000",
+    "10s    press PB0",
+    "10100  expect pwm 70",
+    "40s    sweep 0 4095 60s",
+    "2m     press PA7",
+    "5m     press PA6",
+    "5m10ms expect pwm 0",
+    "10m    press PA6",
+    "15m    sweep 4095 0 30m",
+    "50m    pot 3000",
+    "50m1s  press PB1",
+    "1h     end",
+    NULL
+};
+
+// Tham số lệnh fan
+enum { SIM_FAN_FREE = 0, SIM_FAN_BLOCK, SIM_FAN_MAX };
+
+// Tham số lệnh temp: cảm biến, và giá trị ADC của NTC hở / chập
+enum { SIM_TEMP_NTC = 0, SIM_TEMP_DIE };
+enum { SIM_TEMP_VALUE = 0, SIM_TEMP_OPEN, SIM_TEMP_SHORT };
+
+// Tên loại chuyển (Pwm_RampKind) và dạng ramp (Pwm_RampShape) trong lệnh ramp
+static const char* const ramp_kinds[PWM_RAMP_KIND_COUNT] = { "start", "up", "down", "stop" };
+static const char* const ramp_shapes[PWM_SHAPE_COUNT] = { "linear", "ease", "scurve" };
+
+// Các lỗi có thể gây ra bằng lệnh stall
+enum { SIM_STALL_I2C = 1, SIM_STALL_ADC, SIM_STALL_CONTROL, SIM_STALL_OLED };
+static const char* const stall_names[] = { "", "i2c", "adc", "control", "oled" };
+
+static SimEvent events[SIM_MAX_EVENTS];
+static uint32_t event_count = 0;
+static uint32_t event_next = 0;
+static uint64_t end_us = 0;
+
+// Trạng thái quét biến trở
+static struct {
+    uint8_t active;
+    uint32_t start_ms, dur_ms;
+    int32_t from, to;
+} sweep;
+
+// Bộ ghi nhận đầu ra
+static struct {
+    FILE* trace;               // CSV các thay đổi (NULL: không ghi)
+    const char* frame_dir;     // Thư mục lưu frame PBM (NULL: không lưu)
+    uint16_t pwm;
+    uint8_t led;
+    uint64_t pwm_since_us;
+    uint64_t duty_time_us[1001]; // Thời gian ở mỗi mức duty (‰)
+    uint32_t pwm_changes;
+    uint32_t pwm_step_max;     // Bước duty lớn nhất giữa 2 lần lấy mẫu (‰, lấy mẫu mỗi 1 ms)
+    uint32_t led_changes;
+    uint32_t led_changes_mark; // led_changes lúc expect ledchanges trước
+    uint32_t pot_blocks_mark;  // adc_stats.pot_blocks lúc expect potblocks trước
+    uint32_t frames;
+    uint32_t frame_hash;
+    uint32_t last_bus_bytes;
+    uint32_t failures;         // Số lệnh expect không đạt
+    // Độ lệch system_tick so với thời gian ảo, chỉ lấy mẫu khi SysTick đang chạy
+    // (trong Stop mode system_tick đứng yên cho tới khi được bù lúc thức dậy)
+    int64_t drift_worst;       // Lệch lớn nhất (trị tuyệt đối) kể từ lần expect drift trước
+    int64_t drift_worst_all;
+    // Độ trễ đáp ứng: từ thao tác đầu vào tới thay đổi PWM / frame đầu tiên
+    uint64_t input_us;
+    uint8_t wait_pwm, wait_frame;
+    uint64_t pwm_lat_max, pwm_lat_sum, frame_lat_max, frame_lat_sum;
+    uint32_t pwm_lat_n, frame_lat_n;
+    // Watchdog: thời điểm gây treo và thời điểm firmware ghi nhận tác vụ quá hạn
+    uint8_t stall;
+    uint64_t stall_us, detect_us;
+    uint8_t reset_expected;    // Kịch bản có lệnh expect reset <tác vụ>
+    // Đáp ứng bậc của vòng kín, tính trên tốc độ thật của quạt từ lần đổi RPM đặt gần nhất
+    uint16_t step_target;      // RPM đặt (0: không ở vòng kín)
+    double step_from;          // Tốc độ quạt lúc đổi
+    double step_peak;          // Vọt lố lớn nhất (RPM, theo chiều của bậc)
+    uint64_t step_us;          // Thời điểm đổi
+    uint64_t step_out_us;      // Lần cuối tốc độ nằm ngoài dải SIM_SETTLE_PCT
+    uint32_t steps;
+} rec;
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Đọc thời gian dạng "1h", "5m30s", "250ms", "1500" (mặc định ms)
+ * @return 1 nếu hợp lệ
+ */
+static uint8_t Sim_ParseTime(const char* str, uint32_t* out_ms) {
+    uint64_t total = 0;
+    const char* p = str;
+
+    if (!*p) return 0;
+    while (*p) {
+        char* end;
+        unsigned long v = strtoul(p, &end, 10);
+        if (end == p) return 0;
+        p = end;
+        if (!strncmp(p, "ms", 2))   { total += v;            p += 2; }
+        else if (*p == 'h')         { total += v * 3600000;  p++; }
+        else if (*p == 'm')         { total += v * 60000;    p++; }
+        else if (*p == 's')         { total += v * 1000;     p++; }
+        else if (*p == '\0')        { total += v; }
+        else return 0;
+    }
+    *out_ms = (uint32_t)total;
+    return 1;
+}
+
+
+/**
+ * @brief Đổi tên chân nút nhấn thành đường EXTI
+ */
+static uint32_t Sim_ParseButton(const char* name) {
+    if (!strcmp(name, "PA6")) return HW_EXTI_PA6;
+    if (!strcmp(name, "PA7")) return HW_EXTI_PA7;
+    if (!strcmp(name, "PB0")) return HW_EXTI_PB0;
+    if (!strcmp(name, "PB1")) return HW_EXTI_PB1;
+    return 0;
+}
+
+
+/**
+ * @brief Số quạt tùy chọn ở cuối lệnh (1..HW_FAN_COUNT, rỗng: quạt 1)
+ * @return Chỉ số 0-based, HW_FAN_COUNT nếu không hợp lệ
+ */
+static uint8_t Sim_ParseFan(const char* text) {
+    unsigned long v;
+
+    if (!*text) return 0;
+    v = strtoul(text, NULL, 0);
+    return (v >= 1 && v <= HW_FAN_COUNT) ? (uint8_t)(v - 1) : HW_FAN_COUNT;
+}
+
+
+/**
+ * @brief Phân tích 1 dòng kịch bản: "<thời điểm> <lệnh> [tham số...]"
+ * @return 1 nếu hợp lệ (dòng trống/chú thích cũng hợp lệ)
+ */
+static uint8_t Sim_ParseLine(const char* text, uint16_t line) {
+    char t[32], cmd[16], a[16] = "", b[16] = "", c[16] = "";
+    SimEvent ev = {0};
+    int n;
+
+    while (*text == ' ' || *text == '\t') text++;
+    if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0') return 1;
+
+    n = sscanf(text, "%31s %15s %15s %15s %15s", t, cmd, a, b, c);
+    if (n < 2 || !Sim_ParseTime(t, &ev.t_ms) || event_count >= SIM_MAX_EVENTS) return 0;
+    ev.line = line;
+
+    if (!strcmp(cmd, "pot") && n >= 3) {
+        ev.cmd = SIM_CMD_POT;
+        ev.a = strtoul(a, NULL, 0);
+    } else if (!strcmp(cmd, "sweep") && n >= 5) {
+        ev.cmd = SIM_CMD_SWEEP;
+        ev.a = strtoul(a, NULL, 0);
+        ev.b = strtoul(b, NULL, 0);
+        if (!Sim_ParseTime(c, &ev.c)) return 0;
+    } else if (!strcmp(cmd, "press") && n >= 3) {
+        ev.cmd = SIM_CMD_PRESS;
+        ev.a = Sim_ParseButton(a);
+        if (!ev.a) return 0;
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "pwm")) {
+        ev.cmd = SIM_CMD_EXPECT_PWM;
+        ev.a = strtoul(b, NULL, 0);
+        ev.fan = Sim_ParseFan(c);
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "led")) {
+        ev.cmd = SIM_CMD_EXPECT_LED;
+        ev.a = strtoul(b, NULL, 0);
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "drift")) {
+        ev.cmd = SIM_CMD_EXPECT_DRIFT;
+        ev.a = strtoul(b, NULL, 0);
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "reset")) {
+        ev.cmd = SIM_CMD_EXPECT_RESET;
+        ev.a = WDG_NONE;
+        if (strcmp(b, "none")) {
+            for (ev.a = 0; ev.a < WDG_COUNT && strcmp(b, Wdg_Name(ev.a)); ev.a++) {}
+            if (ev.a == WDG_COUNT) return 0;
+            rec.reset_expected = 1;
+        }
+    } else if (!strcmp(cmd, "stall") && n >= 3) {
+        ev.cmd = SIM_CMD_STALL;
+        for (ev.a = SIM_STALL_I2C; ev.a <= SIM_STALL_OLED && strcmp(a, stall_names[ev.a]); ev.a++) {}
+        if (ev.a > SIM_STALL_OLED) return 0;
+    } else if (!strcmp(cmd, "page") && n >= 3) {
+        ev.cmd = SIM_CMD_PAGE;
+        if (!strcmp(a, "main")) ev.a = CPU_PAGE_MAIN;
+        else if (!strcmp(a, "cpu")) ev.a = CPU_PAGE_LOAD;
+        else if (!strcmp(a, "fans")) ev.a = CPU_PAGE_FANS;
+        else return 0;
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "rpm")) {
+        ev.cmd = SIM_CMD_EXPECT_RPM;
+        ev.a = strtoul(b, NULL, 0);
+        ev.fan = Sim_ParseFan(c);
+    } else if (!strcmp(cmd, "fan") && n >= 3 && (!strcmp(a, "block") || !strcmp(a, "free"))) {
+        ev.cmd = SIM_CMD_FAN;
+        ev.a = !strcmp(a, "block") ? SIM_FAN_BLOCK : SIM_FAN_FREE;
+        ev.fan = Sim_ParseFan(b);
+    } else if (!strcmp(cmd, "fan") && n >= 4 && !strcmp(a, "max")) {
+        ev.cmd = SIM_CMD_FAN;
+        ev.a = SIM_FAN_MAX;
+        ev.b = strtoul(b, NULL, 0);
+        ev.fan = Sim_ParseFan(c);
+        if (!ev.b) return 0;
+    } else if (!strcmp(cmd, "control") && n >= 3) {
+        ev.cmd = SIM_CMD_CONTROL;
+        if (!strcmp(a, "curve")) ev.a = CONTROL_FAN_CURVE;
+        else if (!strcmp(a, "rpm")) ev.a = CONTROL_FAN_RPM;
+        else if (!strcmp(a, "temp")) ev.a = CONTROL_FAN_TEMP;
+        else return 0;
+    } else if (!strcmp(cmd, "temp") && n >= 4 && (!strcmp(a, "ntc") || !strcmp(a, "die"))) {
+        char* end;
+        ev.cmd = SIM_CMD_TEMP;
+        ev.a = !strcmp(a, "die") ? SIM_TEMP_DIE : SIM_TEMP_NTC;
+        if (ev.a == SIM_TEMP_NTC && !strcmp(b, "open")) ev.b = SIM_TEMP_OPEN;
+        else if (ev.a == SIM_TEMP_NTC && !strcmp(b, "short")) ev.b = SIM_TEMP_SHORT;
+        else {
+            ev.c = (uint32_t)(int32_t)(strtod(b, &end) * 10);   // 0,1 °C
+            if (end == b || *end) return 0;
+        }
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "temp")) {
+        char* end;
+        ev.cmd = SIM_CMD_EXPECT_TEMP;
+        ev.a = (uint32_t)(int32_t)(strtod(b, &end) * 10);
+        if (end == b || *end) return 0;
+    } else if (!strcmp(cmd, "vdda") && n >= 3) {
+        ev.cmd = SIM_CMD_VDDA;
+        ev.a = strtoul(a, NULL, 0);
+        if (ev.a < 1800 || ev.a > 3600) return 0;   // Dải VDDA của STM32F401
+    } else if (!strcmp(cmd, "noise") && n >= 3) {
+        ev.cmd = SIM_CMD_NOISE;
+        ev.a = strtoul(a, NULL, 0);
+        if (ev.a > 2047) return 0;
+    } else if (!strcmp(cmd, "spikes") && n >= 3) {
+        ev.cmd = SIM_CMD_SPIKES;
+        if (!strcmp(a, "on")) ev.a = 1;
+        else if (strcmp(a, "off")) return 0;
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "ledchanges")) {
+        ev.cmd = SIM_CMD_EXPECT_LEDCHANGES;
+        ev.a = strtoul(b, NULL, 0);
+    } else if (!strcmp(cmd, "expect") && n >= 4 && !strcmp(a, "potblocks")) {
+        ev.cmd = SIM_CMD_EXPECT_POTBLOCKS;
+        ev.a = strtoul(b, NULL, 0);
+    } else if (!strcmp(cmd, "ramp") && n >= 5) {
+        ev.cmd = SIM_CMD_RAMP;
+        for (ev.a = 0; ev.a < PWM_RAMP_KIND_COUNT && strcmp(a, ramp_kinds[ev.a]); ev.a++) {}
+        for (ev.c = 0; ev.c < PWM_SHAPE_COUNT && strcmp(c, ramp_shapes[ev.c]); ev.c++) {}
+        if (ev.a == PWM_RAMP_KIND_COUNT || ev.c == PWM_SHAPE_COUNT) return 0;
+        if (!Sim_ParseTime(b, &ev.b) || ev.b > 0xFFFF) return 0;
+    } else if (!strcmp(cmd, "expect") && n >= 5 && !strcmp(a, "settle")) {
+        ev.cmd = SIM_CMD_EXPECT_SETTLE;
+        ev.a = strtoul(b, NULL, 0);
+        ev.b = strtoul(c, NULL, 0);
+    } else if (!strcmp(cmd, "curve") && n >= 3) {
+        ev.cmd = SIM_CMD_CURVE;
+        for (ev.a = 0; ev.a < FANCURVE_PRESET_COUNT && strcmp(a, FanCurve_PresetName(ev.a)); ev.a++) {}
+        if (ev.a == FANCURVE_PRESET_COUNT) return 0;
+        ev.fan = Sim_ParseFan(b);
+    } else if (!strcmp(cmd, "end")) {
+        ev.cmd = SIM_CMD_END;
+    } else {
+        return 0;
+    }
+    if (ev.fan >= HW_FAN_COUNT) return 0;
+
+    // Giữ danh sách sắp theo thời gian (chèn ổn định)
+    uint32_t i = event_count++;
+    while (i > 0 && events[i - 1].t_ms > ev.t_ms) {
+        events[i] = events[i - 1];
+        i--;
+    }
+    events[i] = ev;
+    return 1;
+}
+
+
+/**
+ * @brief Ghi 1 dòng vào file trace CSV
+ */
+static void Sim_Trace(const char* what, uint32_t value) {
+    if (rec.trace) {
+        fprintf(rec.trace, "%llu,%s,%u\n", (unsigned long long)(hw_sim.now_us / 1000), what, value);
+    }
+}
+
+
+/**
+ * @brief Băm nội dung màn hình đang hiển thị (FNV-1a trên GDDRAM + thanh ghi hiển thị)
+ */
+static uint32_t Sim_FrameHash(void) {
+    const uint8_t* p = &oled_sim.gddram[0][0];
+    uint32_t h = 2166136261u;
+
+    for (uint32_t i = 0; i < sizeof(oled_sim.gddram); i++) h = (h ^ p[i]) * 16777619u;
+    h = (h ^ oled_sim.display_on) * 16777619u;
+    h = (h ^ oled_sim.inverse) * 16777619u;
+    return h;
+}
+
+
+/**
+ * @brief Duty (‰, làm tròn) ứng với giá trị CCR theo ARR hiện tại của TIM4
+ */
+static uint32_t Sim_DutyPermille(uint16_t ccr) {
+    uint32_t period = (uint32_t)hw_sim.pwm_arr + 1;
+    uint32_t permille = ((uint32_t)ccr * 1000 + period / 2) / period;
+    return permille > 1000 ? 1000 : permille;
+}
+
+
+/**
+ * @brief Lấy mẫu PWM (quạt 1), LED và màn hình; ghi lại mọi thay đổi
+ */
+static void Sim_Sample(void) {
+    uint64_t now = hw_sim.now_us;
+
+    if (hw_sim.pwm_ccr[0] != rec.pwm) {
+        uint32_t before = Sim_DutyPermille(rec.pwm), after = Sim_DutyPermille(hw_sim.pwm_ccr[0]);
+        uint32_t step = (after > before) ? after - before : before - after;
+        if (step > rec.pwm_step_max) rec.pwm_step_max = step;
+
+        rec.duty_time_us[before] += now - rec.pwm_since_us;
+        rec.pwm = hw_sim.pwm_ccr[0];
+        rec.pwm_since_us = now;
+        rec.pwm_changes++;
+        Sim_Trace("pwm", Sim_DutyPermille(rec.pwm));
+
+        if (rec.wait_pwm) {
+            uint64_t lat = now - rec.input_us;
+            rec.wait_pwm = 0;
+            rec.pwm_lat_sum += lat;
+            rec.pwm_lat_n++;
+            if (lat > rec.pwm_lat_max) rec.pwm_lat_max = lat;
+        }
+    }
+
+    if (hw_sim.led != rec.led) {
+        rec.led = hw_sim.led;
+        rec.led_changes++;
+        Sim_Trace("led", rec.led);
+    }
+
+    // Chỉ kiểm tra màn hình khi có dữ liệu mới và bus đã rảnh (frame vẽ xong)
+    if (oled_sim.bus_bytes != rec.last_bus_bytes && !hw_sim.i2c_started &&
+        now - hw_sim.i2c_last_us >= SIM_FRAME_IDLE_US) {
+        uint32_t h = Sim_FrameHash();
+        rec.last_bus_bytes = oled_sim.bus_bytes;
+
+        if (h != rec.frame_hash) {
+            rec.frame_hash = h;
+            rec.frames++;
+            Sim_Trace("frame", h);
+
+            if (rec.frame_dir) {
+                char path[512];
+                PBM_Image image;
+                snprintf(path, sizeof(path), "%s/frame_%05u_%llums.pbm", rec.frame_dir, rec.frames,
+                         (unsigned long long)(now / 1000));
+                SSD1306Sim_Capture(&oled_sim, image);
+                PBM_Write(path, image);
+            }
+            if (rec.wait_frame) {
+                uint64_t lat = now - rec.input_us;
+                rec.wait_frame = 0;
+                rec.frame_lat_sum += lat;
+                rec.frame_lat_n++;
+                if (lat > rec.frame_lat_max) rec.frame_lat_max = lat;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Tác vụ mà firmware đã ghi vào thanh ghi backup khi phát hiện quá hạn
+ * @return WDG_NONE nếu chưa ghi
+ */
+static uint8_t Sim_StalledTask(void) {
+    uint32_t v = hw_sim.bkp[WDG_BKP_STALL];
+    return ((v & 0xFFFF0000u) == WDG_BKP_MAGIC) ? (uint8_t)(v & 0xFF) : WDG_NONE;
+}
+
+
+/**
+ * @brief Theo dõi đáp ứng bậc của vòng kín tốc độ: mỗi lần RPM đặt đổi là 1 bậc mới;
+ *        ghi vọt lố lớn nhất và lần cuối tốc độ quạt nằm ngoài dải xác lập
+ */
+static void Sim_TrackStep(void) {
+    Control_Snapshot snap;
+    double rpm = HW_Sim_FanRpm(0);
+    double band;
+
+    Control_GetSnapshot(&snap);
+    if (snap.target_rpm != rec.step_target) {
+        rec.step_target = snap.target_rpm;
+        rec.step_from = rpm;
+        rec.step_peak = 0;
+        rec.step_us = rec.step_out_us = hw_sim.now_us;
+        if (snap.target_rpm) rec.steps++;
+        return;
+    }
+    if (!rec.step_target) return;
+
+    band = rec.step_target * SIM_SETTLE_PCT / 100.0;
+    if (band < 30) band = 30;
+    if (rpm > rec.step_target + band || rpm < rec.step_target - band) rec.step_out_us = hw_sim.now_us;
+
+    if (rec.step_target >= rec.step_from && rpm - rec.step_target > rec.step_peak) rec.step_peak = rpm - rec.step_target;
+    if (rec.step_target < rec.step_from && rec.step_target - rpm > rec.step_peak) rec.step_peak = rec.step_target - rpm;
+}
+
+
+/**
+ * @brief Vọt lố của bậc gần nhất, % độ lớn bậc
+ */
+static double Sim_StepOvershoot(void) {
+    double size = rec.step_target - rec.step_from;
+    if (size < 0) size = -size;
+    return size > 1 ? rec.step_peak * 100.0 / size : 0;
+}
+
+
+/**
+ * @brief Được gọi mỗi 1 ms thời gian ảo: chạy các sự kiện đến hạn rồi lấy mẫu đầu ra
+ */
+static void Sim_OnTick(void) {
+    uint32_t now_ms = (uint32_t)(hw_sim.now_us / 1000);
+
+    if (hw_sim.systick_enabled) {
+        int64_t drift = (int64_t)system_tick - (int64_t)now_ms;
+        if (drift < 0) drift = -drift;
+        if (drift > rec.drift_worst) rec.drift_worst = drift;
+        if (drift > rec.drift_worst_all) rec.drift_worst_all = drift;
+    }
+
+    if (!rec.detect_us && Sim_StalledTask() != WDG_NONE) rec.detect_us = hw_sim.now_us;
+
+    while (event_next < event_count && events[event_next].t_ms <= now_ms) {
+        const SimEvent* ev = &events[event_next++];
+
+        switch (ev->cmd) {
+            case SIM_CMD_POT:
+                sweep.active = 0;
+                HW_Sim_SetADC((uint16_t)ev->a);
+                Sim_Trace("pot", ev->a);
+                break;
+            case SIM_CMD_SWEEP:
+                sweep.active = 1;
+                sweep.start_ms = ev->t_ms;
+                sweep.dur_ms = ev->c ? ev->c : 1;
+                sweep.from = (int32_t)ev->a;
+                sweep.to = (int32_t)ev->b;
+                Sim_Trace("sweep", ev->b);
+                break;
+            case SIM_CMD_PRESS:
+                Sim_Trace("press", ev->a);
+                rec.input_us = hw_sim.now_us;
+                rec.wait_pwm = 1;
+                rec.wait_frame = 1;
+                HW_Sim_TriggerEXTI(ev->a);
+                break;
+            case SIM_CMD_EXPECT_PWM:
+                if ((Sim_DutyPermille(hw_sim.pwm_ccr[ev->fan]) + 5) / 10 != ev->a) {
+                    printf("FAIL line %u @%u ms: fan %u pwm=%u%% (CCR %u), expected %u%%\n", ev->line, now_ms,
+                           ev->fan + 1, (Sim_DutyPermille(hw_sim.pwm_ccr[ev->fan]) + 5) / 10,
+                           hw_sim.pwm_ccr[ev->fan], ev->a);
+                    rec.failures++;
+                }
+                break;
+            case SIM_CMD_EXPECT_LED:
+                if (hw_sim.led != ev->a) {
+                    printf("FAIL line %u @%u ms: led=0x%X, expected 0x%X\n", ev->line, now_ms, hw_sim.led, ev->a);
+                    rec.failures++;
+                }
+                break;
+            case SIM_CMD_EXPECT_DRIFT:
+                if (rec.drift_worst > (int64_t)ev->a) {
+                    printf("FAIL line %u @%u ms: system_tick drift up to %lld ms, expected within %u\n",
+                           ev->line, now_ms, (long long)rec.drift_worst, ev->a);
+                    rec.failures++;
+                }
+                rec.drift_worst = 0;
+                break;
+            case SIM_CMD_PAGE:
+                cpu_load_page = (uint8_t)ev->a;
+                break;
+            case SIM_CMD_EXPECT_RPM: {
+                uint32_t rpm = Tach_GetRpm(ev->fan);
+                uint32_t tol = ev->a * SIM_RPM_TOL_PCT / 100;
+                if (tol < 30) tol = 30;
+                if (rpm + tol < ev->a || rpm > ev->a + tol) {
+                    printf("FAIL line %u @%u ms: fan %u rpm=%u (model %.0f), expected %u +-%u\n", ev->line,
+                           now_ms, ev->fan + 1, rpm, HW_Sim_FanRpm(ev->fan), ev->a, tol);
+                    rec.failures++;
+                }
+                break;
+            }
+            case SIM_CMD_FAN:
+                HW_Sim_FanRpm(ev->fan);    // Tích phân tới đây với trạng thái cũ
+                if (ev->a == SIM_FAN_MAX) {
+                    Sim_Trace("fan_max", ev->b);
+                    hw_sim.fan_max_rpm[ev->fan] = ev->b;
+                } else {
+                    Sim_Trace("fan_block", ev->a);
+                    hw_sim.fan_blocked[ev->fan] = (uint8_t)ev->a;
+                }
+                break;
+            case SIM_CMD_CONTROL: {
+                Control_Config config = control_config;
+                Sim_Trace("control", ev->a);
+                config.fan_mode = (uint8_t)ev->a;
+                Control_SetConfig(&config);
+                break;
+            }
+            case SIM_CMD_TEMP:
+                Sim_Trace(ev->a == SIM_TEMP_DIE ? "temp_die" : "temp_ntc", ev->c);
+                if (ev->b == SIM_TEMP_OPEN) hw_sim.adc_ntc = 4095;
+                else if (ev->b == SIM_TEMP_SHORT) hw_sim.adc_ntc = 0;
+                else if (ev->a == SIM_TEMP_DIE) HW_Sim_SetDie((int32_t)ev->c / 10.0);
+                else HW_Sim_SetNtc((int32_t)ev->c / 10.0);
+                break;
+            case SIM_CMD_EXPECT_TEMP: {
+                int32_t t = Temp_Control(), want = (int32_t)ev->a;
+                if (t == TEMP_INVALID || t > want + SIM_TEMP_TOL_DC || t < want - SIM_TEMP_TOL_DC) {
+                    printf("FAIL line %u @%u ms: temp=%.1f C (ntc adc %u, die adc %u), expected %.1f +-%.1f\n",
+                           ev->line, now_ms, t / 10.0, hw_sim.adc_ntc, hw_sim.adc_die, want / 10.0,
+                           SIM_TEMP_TOL_DC / 10.0);
+                    rec.failures++;
+                }
+                break;
+            }
+            case SIM_CMD_VDDA:
+                Sim_Trace("vdda", ev->a);
+                HW_Sim_SetVdda(ev->a);
+                break;
+            case SIM_CMD_NOISE:
+                Sim_Trace("noise", ev->a);
+                hw_sim.pot_noise = (uint16_t)ev->a;
+                break;
+            case SIM_CMD_SPIKES:
+                Sim_Trace("spikes", ev->a);
+                hw_sim.pot_spikes = (uint8_t)ev->a;
+                break;
+            case SIM_CMD_EXPECT_LEDCHANGES:
+                if (rec.led_changes - rec.led_changes_mark > ev->a) {
+                    printf("FAIL line %u @%u ms: led changed %u times, expected at most %u\n", ev->line,
+                           now_ms, rec.led_changes - rec.led_changes_mark, ev->a);
+                    rec.failures++;
+                }
+                rec.led_changes_mark = rec.led_changes;
+                break;
+            case SIM_CMD_EXPECT_POTBLOCKS:
+                if (adc_stats.pot_blocks - rec.pot_blocks_mark > ev->a) {
+                    printf("FAIL line %u @%u ms: pot filtered in %u blocks, expected at most %u\n", ev->line,
+                           now_ms, adc_stats.pot_blocks - rec.pot_blocks_mark, ev->a);
+                    rec.failures++;
+                }
+                rec.pot_blocks_mark = adc_stats.pot_blocks;
+                break;
+            case SIM_CMD_RAMP:
+                Sim_Trace("ramp", ev->a);
+                PWM_SetRamp((uint8_t)ev->a, (uint16_t)ev->b, (uint8_t)ev->c);
+                break;
+            case SIM_CMD_EXPECT_SETTLE: {
+                uint64_t settle_us = rec.step_out_us - rec.step_us;
+                double overshoot = Sim_StepOvershoot();
+                if (!rec.step_target || rec.step_out_us == hw_sim.now_us) {
+                    printf("FAIL line %u @%u ms: rpm loop not settled (target %u, fan %.0f rpm)\n", ev->line,
+                           now_ms, rec.step_target, HW_Sim_FanRpm(0));
+                    rec.failures++;
+                } else if (settle_us > (uint64_t)ev->a * 1000 || overshoot > ev->b) {
+                    printf("FAIL line %u @%u ms: step %.0f->%u rpm settled in %.0f ms, overshoot %.1f%%, "
+                           "expected <= %u ms, <= %u%%\n", ev->line, now_ms, rec.step_from, rec.step_target,
+                           settle_us / 1e3, overshoot, ev->a, ev->b);
+                    rec.failures++;
+                }
+                break;
+            }
+            case SIM_CMD_CURVE:
+                Sim_Trace("curve", ev->a);
+                FanCurve_SelectPreset(ev->fan, (uint8_t)ev->a);
+                break;
+            case SIM_CMD_STALL:
+                Sim_Trace("stall", ev->a);
+                rec.stall = (uint8_t)ev->a;
+                rec.stall_us = hw_sim.now_us;
+                if (ev->a == SIM_STALL_I2C) hw_sim.i2c_stuck = 1;
+                if (ev->a == SIM_STALL_ADC) hw_sim.adc_stuck = 1;
+                if (ev->a == SIM_STALL_CONTROL) hw_sim.tim5_stuck = 1;
+                if (ev->a == SIM_STALL_OLED) hw_sim.i2c_nack = 1;
+                break;
+            case SIM_CMD_EXPECT_RESET:
+                if (ev->a == WDG_NONE && hw_sim.halted) {
+                    printf("FAIL line %u @%u ms: iwdg reset @%llu ms, expected none\n", ev->line, now_ms,
+                           (unsigned long long)(hw_sim.reset_us / 1000));
+                    rec.failures++;
+                } else if (ev->a != WDG_NONE && !hw_sim.halted) {
+                    printf("FAIL line %u @%u ms: no iwdg reset, expected stall of %s\n", ev->line, now_ms,
+                           Wdg_Name((uint8_t)ev->a));
+                    rec.failures++;
+                } else if (ev->a != WDG_NONE && Sim_StalledTask() != ev->a) {
+                    printf("FAIL line %u @%u ms: iwdg reset blames %s, expected %s\n", ev->line, now_ms,
+                           Wdg_Name(Sim_StalledTask()), Wdg_Name((uint8_t)ev->a));
+                    rec.failures++;
+                }
+                break;
+            case SIM_CMD_END:
+                break;
+        }
+    }
+
+    if (sweep.active) {
+        uint32_t elapsed = now_ms - sweep.start_ms;
+        if (elapsed >= sweep.dur_ms) {
+            HW_Sim_SetADC((uint16_t)sweep.to);
+            sweep.active = 0;
+        } else {
+            int32_t v = sweep.from + (int32_t)((int64_t)(sweep.to - sweep.from) * elapsed / sweep.dur_ms);
+            HW_Sim_SetADC((uint16_t)v);
+        }
+    }
+
+    Sim_TrackStep();
+    Sim_Sample();
+}
+
+
+static double Sim_WallSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * @brief Đặc tả hành vi thiết bị viết độc lập với bảng fsm_table (theo logic gốc
+ *        của main.c/exti.c), dùng làm đáp án khi kiểm tra từng chuyển trạng thái
+ * @return Trạng thái kỳ vọng; *countdown được cập nhật theo kỳ vọng
+ */
+static uint8_t Spec_Next(uint8_t state, uint8_t event, uint8_t mode, uint8_t* countdown) {
+    static const uint8_t seconds[FSM_EV_BUTTONS] = { 0, 10, 20, 30 };
+
+    switch (event) {
+        case FSM_EV_POWER:
+            *countdown = 0;
+            return (state == FSM_ST_OFF) ? FSM_ST_RUN : FSM_ST_OFF;
+        case FSM_EV_10S:
+        case FSM_EV_20S:
+        case FSM_EV_30S:
+            if (state == FSM_ST_OFF) return state;
+            *countdown = seconds[event];
+            return FSM_ST_COUNTDOWN;
+        case FSM_EV_SECOND:
+            if (state != FSM_ST_COUNTDOWN || *countdown == 0 || mode == 0) return state;
+            if (--*countdown == 0) return FSM_ST_READY;
+            return state;
+        case FSM_EV_TIMEOUT:
+            if (state != FSM_ST_COUNTDOWN) return state;
+            *countdown = 0;
+            return FSM_ST_READY;
+    }
+    return state;
+}
+
+
+/**
+ * @brief Kiểm tra toàn bộ máy trạng thái: mọi (trạng thái × sự kiện × ngữ cảnh)
+ *        so với Spec_Next, bất biến đầu ra sau mỗi chuyển, mọi ô được dùng tới
+ *        và mọi trạng thái đều đến được từ trạng thái khởi động
+ * @return Số lỗi
+ */
+static uint32_t Sim_CheckFsm(void) {
+    static const uint8_t modes[] = { 0, 1, 3 };
+    static const uint8_t counts[] = { 1, 2, 15 };
+    const uint32_t cd_lines = HW_EXTI_PA7 | HW_EXTI_PB0 | HW_EXTI_PB1;
+    uint8_t used[FSM_ST_COUNT][FSM_EV_COUNT] = {{0}};
+    uint8_t reach[FSM_ST_COUNT] = {0};
+    uint32_t errors = 0, cases = 0;
+
+    // ======== Bảng chuyển trạng thái ========
+    printf("%-10s", "");
+    for (uint8_t e = 0; e < FSM_EV_COUNT; e++) printf(" %-9s", fsm_event_names[e]);
+    printf("\n");
+    for (uint8_t st = 0; st < FSM_ST_COUNT; st++) {
+        printf("%-10s", fsm_states[st].name);
+        for (uint8_t e = 0; e < FSM_EV_COUNT; e++) {
+            const Fsm_Transition* t = &fsm_table[st][e];
+            char cell[16];
+            if (t->next == FSM_ST_NONE) snprintf(cell, sizeof(cell), "-");
+            else snprintf(cell, sizeof(cell), "%s%s", fsm_states[t->next].name, t->guard ? "?" : "");
+            printf(" %-9s", cell);
+        }
+        printf("\n");
+    }
+
+    // ======== Từng chuyển trạng thái trong mọi ngữ cảnh ========
+    for (uint8_t st = 0; st < FSM_ST_COUNT; st++) {
+        for (uint8_t e = 0; e < FSM_EV_COUNT; e++) {
+            for (uint8_t m = 0; m < sizeof(modes); m++) {
+                for (uint8_t c = 0; c < sizeof(counts); c++) {
+                    uint8_t mode = (st == FSM_ST_OFF) ? 0 : modes[m];
+                    uint8_t cd = (st == FSM_ST_COUNTDOWN) ? counts[c] : 0;
+                    uint8_t exp_cd = cd;
+                    uint8_t exp = Spec_Next(st, e, mode, &exp_cd);
+                    uint8_t accepted;
+                    const char* why = NULL;
+
+                    HW_Sim_Reset();
+                    LED_Init();
+                    PWM_Init();
+                    GPIO_EXTI_Init();
+                    Fsm_Init(st);
+                    device.mode = mode;
+                    device.countdown = cd;
+                    Update_PWM_From_Mode(Fsm_FanEnabled() ? mode : 0);
+                    LED_Update(Fsm_FanEnabled() ? mode : 0);
+
+                    accepted = Fsm_Dispatch(e);
+                    if (accepted) used[st][e] = 1;
+                    cases++;
+
+                    if (device.state != exp) why = "sai trang thai dich";
+                    else if (device.countdown != exp_cd) why = "sai countdown";
+                    else if (device.state == FSM_ST_OFF &&
+                             (device.mode || !PWM_IsIdle() || hw_sim.led || (hw_sim.exti_imr & cd_lines)))
+                        why = "OFF nhung quat/LED/nut countdown chua tat";
+                    else if (device.state != FSM_ST_OFF && (hw_sim.exti_imr & cd_lines) != cd_lines)
+                        why = "nut countdown bi tat ngoai trang thai OFF";
+                    else if (!(hw_sim.exti_imr & HW_EXTI_PA6))
+                        why = "nut nguon bi tat";
+                    else if ((device.state == FSM_ST_COUNTDOWN) != (device.countdown > 0))
+                        why = "countdown khong khop trang thai";
+
+                    if (why) {
+                        printf("FAIL %s + %s (mode %u, countdown %u): %s -> %s, ky vong %s countdown %u\n",
+                               fsm_states[st].name, fsm_event_names[e], mode, cd, why,
+                               fsm_states[device.state].name, fsm_states[exp].name, exp_cd);
+                        errors++;
+                    }
+                }
+            }
+        }
+    }
+
+    // ======== Mọi ô không rỗng phải được dùng tới ========
+    for (uint8_t st = 0; st < FSM_ST_COUNT; st++) {
+        for (uint8_t e = 0; e < FSM_EV_COUNT; e++) {
+            if (fsm_table[st][e].next != FSM_ST_NONE && !used[st][e]) {
+                printf("FAIL o %s + %s khong bao gio duoc chap nhan\n", fsm_states[st].name, fsm_event_names[e]);
+                errors++;
+            }
+        }
+    }
+
+    // ======== Mọi trạng thái đến được từ RUN (trạng thái sau khởi động) ========
+    reach[FSM_ST_RUN] = 1;
+    for (uint8_t changed = 1; changed;) {
+        changed = 0;
+        for (uint8_t st = 0; st < FSM_ST_COUNT; st++) {
+            for (uint8_t e = 0; e < FSM_EV_COUNT && reach[st]; e++) {
+                uint8_t next = fsm_table[st][e].next;
+                if (used[st][e] && !reach[next]) reach[next] = changed = 1;
+            }
+        }
+    }
+    for (uint8_t st = 0; st < FSM_ST_COUNT; st++) {
+        if (!reach[st]) {
+            printf("FAIL trang thai %s khong den duoc\n", fsm_states[st].name);
+            errors++;
+        }
+    }
+
+    printf("fsm: %u cases, %u errors\n", cases, errors);
+    return errors;
+}
+
+
+/**
+ * @brief Kiểm tra bộ giải PSC/ARR (PWM_Solve) trên nhiều cấu hình clock timer và
+ *        tần số, rồi kiểm tra ánh xạ duty ‰/Q16 → CCR với từng cấu hình tìm được
+ *
+ * Với mỗi cặp (clock, target): tìm được ⇔ target ∈ [1, clock/2]; ARR + 1 ∈
+ * [2, PWM_PERIOD_MAX]; PSC nhỏ nhất (PSC − 1 thì chu kỳ không vừa 16-bit); ARR
+ * cho tần số gần target nhất với PSC đó; freq_hz là tần số thực làm tròn.
+ * @return Số lỗi
+ */
+static uint32_t Sim_CheckPwm(void) {
+    // Clock TIM4 của STM32F401: HSE 8 MHz, HSI 16 MHz, PLL 42/84 MHz, và vài giá trị lẻ
+    static const uint32_t clocks[] = { 1000000, 8000000, 16000000, 25000000, 42000000, 84000000, 100000000 };
+    static const uint32_t targets[] = { 0, 1, 20, 100, 1000, 21000, 25000, 28000, 30001, 100000,
+                                        4000000, 8000000, 8000001, 42000000, 50000001 };
+    uint32_t errors = 0, cases = 0;
+
+    printf("%-10s %-9s %6s %6s %9s %8s %7s\n", "clock", "target", "psc", "arr", "actual", "err ppm", "steps");
+    for (uint8_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        for (uint8_t k = 0; k < sizeof(targets) / sizeof(targets[0]); k++) {
+            uint32_t clock = clocks[c], target = targets[k];
+            uint8_t feasible = target >= 1 && target <= clock / 2;
+            Pwm_Timing t = {0};
+            uint8_t ok = PWM_Solve(clock, target, &t);
+            const char* why = NULL;
+            double period = (double)t.arr + 1;
+            double f = clock / (((double)t.psc + 1) * period);
+            double err = (f - target) / (target ? target : 1);
+
+            cases++;
+            if (ok != feasible) {
+                why = ok ? "tim duoc tan so khong the dat" : "khong tim duoc tan so dat duoc";
+            } else if (ok) {
+                double lo = clock / (((double)t.psc + 1) * (period - 1));
+                double hi = clock / (((double)t.psc + 1) * (period + 1));
+                double d = f > target ? f - target : target - f;
+
+                if (period < 2 || period > PWM_PERIOD_MAX) {
+                    why = "ARR + 1 ngoai khoang";
+                } else if (t.psc > 0 && (double)clock / ((double)t.psc * target) < PWM_PERIOD_MAX - 0.5) {
+                    why = "PSC chua nho nhat (mat do phan giai)";
+                } else if ((period > 2 && (lo > target ? lo - target : target - lo) < d) ||
+                           (period < PWM_PERIOD_MAX && (hi > target ? hi - target : target - hi) < d)) {
+                    why = "ARR khong cho tan so gan nhat";
+                } else if ((double)t.freq_hz < f - 0.5 || (double)t.freq_hz > f + 0.5) {
+                    why = "freq_hz sai";
+                }
+            }
+
+            if (ok) {
+                printf("%-10u %-9u %6u %6u %9u %8.0f %7.0f%s%s\n", clock, target, t.psc, t.arr, t.freq_hz,
+                       err * 1e6, period, why ? "  FAIL " : "", why ? why : "");
+            } else {
+                printf("%-10u %-9u %6s %6s %9s %8s %7s%s%s\n", clock, target, "-", "-", "-", "-", "-",
+                       why ? "  FAIL " : "", why ? why : "");
+            }
+            if (why) errors++;
+            if (!ok || why) continue;
+
+            // ======== Ánh xạ duty → CCR với cấu hình này ========
+            HW_Sim_Reset();
+            pwm_timing = t;
+            HW_PWM_Init(t.psc, t.arr);
+            for (uint32_t p = 0, last = 0; p <= 1000 && !why; p++) {
+                double exact = p * period / 1000;
+                PWM_SetPermille(0, (uint16_t)p);
+                if (hw_sim.pwm_ccr[0] < last) why = "CCR giam khi duty tang";
+                else if (hw_sim.pwm_ccr[0] < exact - 0.5 || hw_sim.pwm_ccr[0] > exact + 0.5) why = "CCR lech qua 0,5 tick";
+                last = hw_sim.pwm_ccr[0];
+            }
+            PWM_SetPermille(0, 1000);
+            if (!why && hw_sim.pwm_ccr[0] != t.arr + 1u) why = "1000 permille khong phai 100%";
+            PWM_SetPermille(0, 5000);
+            if (!why && hw_sim.pwm_ccr[0] != t.arr + 1u) why = "permille > 1000 khong bi gioi han";
+            PWM_SetQ16(0, 0);
+            if (!why && hw_sim.pwm_ccr[0] != 0) why = "Q16 0 khong phai 0%";
+            PWM_SetQ16(0, 65536);
+            if (!why && hw_sim.pwm_ccr[0] != t.arr + 1u) why = "Q16 65536 khong phai 100%";
+            PWM_SetQ16(0, 32768);
+            if (!why && (hw_sim.pwm_ccr[0] < period / 2 - 0.5 || hw_sim.pwm_ccr[0] > period / 2 + 0.5)) why = "Q16 50% sai";
+
+            // Các quạt dùng chung ARR nhưng CCR riêng
+            for (uint8_t fan = 1; fan < HW_FAN_COUNT && !why; fan++) {
+                uint16_t ccr0 = hw_sim.pwm_ccr[0];
+                PWM_SetQ16(fan, 65536);
+                if (hw_sim.pwm_ccr[fan] != t.arr + 1u) why = "quat khac khong dat 100%";
+                else if (hw_sim.pwm_ccr[0] != ccr0) why = "ghi quat khac lam doi CCR quat 1";
+                PWM_SetQ16(fan, 0);
+            }
+            if (why) {
+                printf("FAIL %u Hz / %u Hz: %s\n", clock, target, why);
+                errors++;
+            }
+        }
+    }
+
+    printf("pwm: %u cases, %u errors\n", cases, errors);
+    return errors;
+}
+
+
+/**
+ * @brief Mô phỏng toàn bộ firmware theo thời gian ảo với kịch bản thao tác
+ *
+ * Cách dùng: sim [-t trace.csv] [-f frame_dir] [-d thời_gian] [-j jitter.bin] [kịch_bản.txt]
+ *        sim -s   (chỉ kiểm tra toàn bộ bảng chuyển trạng thái)
+ *        sim -p   (chỉ kiểm tra bộ giải PSC/ARR và ánh xạ duty của PWM)
+ *   Không có file kịch bản: chạy kịch bản mặc định 1 giờ.
+ *   -j: ghi histogram độ trễ tác vụ (sched_jitter) để xem bằng jitter_dump.
+ *   Mã thoát khác 0 nếu có lệnh expect không đạt hoặc OLED báo lỗi giao thức.
+ */
+int main(int argc, char** argv) {
+    const char* script = NULL;
+    const char* trace_path = NULL;
+    const char* jitter_path = NULL;
+    uint32_t duration_ms = 0;
+    double wall0, wall1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s")) return Sim_CheckFsm() ? 1 : 0;
+        if (!strcmp(argv[i], "-p")) return Sim_CheckPwm() ? 1 : 0;
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) trace_path = argv[++i];
+        else if (!strcmp(argv[i], "-f") && i + 1 < argc) rec.frame_dir = argv[++i];
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc) jitter_path = argv[++i];
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            if (!Sim_ParseTime(argv[++i], &duration_ms)) {
+                fprintf(stderr, "thoi gian khong hop le: %s\n", argv[i]);
+                return 2;
+            }
+        } else script = argv[i];
+    }
+
+    if (script) {
+        FILE* f = fopen(script, "r");
+        char buf[256];
+        uint16_t line = 0;
+        if (!f) {
+            fprintf(stderr, "khong mo duoc %s\n", script);
+            return 2;
+        }
+        while (fgets(buf, sizeof(buf), f)) {
+            if (!Sim_ParseLine(buf, ++line)) {
+                fprintf(stderr, "%s:%u: dong khong hop le\n", script, line);
+                fclose(f);
+                return 2;
+            }
+        }
+        fclose(f);
+    } else {
+        for (uint16_t i = 0; default_script[i]; i++) Sim_ParseLine(default_script[i], i + 1);
+    }
+
+    // Thời gian chạy: -d, hoặc lệnh "end", hoặc sự kiện cuối cùng + 1 s
+    if (duration_ms) end_us = (uint64_t)duration_ms * 1000;
+    for (uint32_t i = 0; i < event_count && !end_us; i++) {
+        if (events[i].cmd == SIM_CMD_END) end_us = (uint64_t)events[i].t_ms * 1000;
+    }
+    if (!end_us) end_us = ((uint64_t)(event_count ? events[event_count - 1].t_ms : 0) + 1000) * 1000;
+
+    if (trace_path) {
+        rec.trace = fopen(trace_path, "w");
+        if (!rec.trace) {
+            fprintf(stderr, "khong ghi duoc %s\n", trace_path);
+            return 2;
+        }
+        fprintf(rec.trace, "t_ms,event,value\n");
+    }
+
+    HW_Sim_Reset();
+    hw_sim.tick_hook = Sim_OnTick;
+
+    wall0 = Sim_WallSeconds();
+    HW_Sim_Run(Firmware_Main, end_us);
+    wall1 = Sim_WallSeconds();
+
+    rec.duty_time_us[Sim_DutyPermille(rec.pwm)] += hw_sim.now_us - rec.pwm_since_us;
+    if (rec.trace) fclose(rec.trace);
+
+    // ======== Tổng kết ========
+    printf("virtual %.1f s in %.3f s wall (x%.0f)\n", hw_sim.now_us / 1e6, wall1 - wall0,
+           hw_sim.now_us / 1e6 / (wall1 - wall0 > 1e-9 ? wall1 - wall0 : 1e-9));
+    printf("pwm %u Hz (PSC %u, ARR %u: %u steps), fan curve", pwm_timing.freq_hz, hw_sim.pwm_psc,
+           hw_sim.pwm_arr, hw_sim.pwm_arr + 1);
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        printf("%s %s", fan ? "," : "", FanCurve_PresetName(FanCurve_GetPreset(fan)));
+    }
+    printf("\n");
+    printf("pwm changes %u (max step %u.%u%%/ms), led changes %u, frames %u, adc conversions %u\n",
+           rec.pwm_changes, rec.pwm_step_max / 10, rec.pwm_step_max % 10, rec.led_changes, rec.frames,
+           hw_sim.adc_conversions);
+    printf("pwm ramps:");
+    for (uint8_t k = 0; k < PWM_RAMP_KIND_COUNT; k++) {
+        printf(" %s %u ms %s", ramp_kinds[k], pwm_ramps[k].full_ms, ramp_shapes[pwm_ramps[k].shape]);
+    }
+    printf("\n");
+    printf("i2c %u xfers, %u bytes, %u violations%s%s\n", oled_sim.transactions, oled_sim.bus_bytes,
+           oled_sim.violations, oled_sim.violations ? ": " : "", oled_sim.last_violation);
+    printf("duty time (>= 0.05 s):");
+    for (uint32_t d = 0; d <= 1000; d++) {
+        if (rec.duty_time_us[d] >= 50000) printf(" %u.%u%%=%.1fs", d / 10, d % 10, rec.duty_time_us[d] / 1e6);
+    }
+    printf("\n");
+    if (rec.pwm_lat_n) {
+        printf("input->pwm latency avg %.1f ms max %.1f ms (%u)\n",
+               rec.pwm_lat_sum / 1e3 / rec.pwm_lat_n, rec.pwm_lat_max / 1e3, rec.pwm_lat_n);
+    }
+    if (rec.frame_lat_n) {
+        printf("input->frame latency avg %.1f ms max %.1f ms (%u)\n",
+               rec.frame_lat_sum / 1e3 / rec.frame_lat_n, rec.frame_lat_max / 1e3, rec.frame_lat_n);
+    }
+    printf("idle %.1f%% (%u sleeps, wfi %.1f s), wake latency max %u cycles\n",
+           (idle_stats.idle_cycles + idle_stats.stop_cycles) * 100.0 /
+               ((double)hw_sim.now_us * (HW_CPU_HZ / 1000000)),
+           idle_stats.sleeps, hw_sim.wfi_us / 1e6, idle_stats.wake_latency_max);
+    printf("stop %u times, %.1f s (rtc %.1f s), system_tick drift max %lld ms\n",
+           hw_sim.stop_count, hw_sim.stop_us / 1e6, idle_stats.stop_cycles / (double)HW_CPU_HZ,
+           (long long)rec.drift_worst_all);
+    {
+        uint64_t busy = 0;
+        double total = (double)hw_sim.now_us * (HW_CPU_HZ / 1000000);
+        for (uint8_t slot = CPU_SLOT_IDLE + 1; slot < CPU_SLOT_COUNT; slot++) busy += cpu_load.total_cycles[slot];
+        printf("cpu busy %.1f%% (last window %.1f%%):", busy * 100.0 / total, cpu_load.busy_permille / 10.0);
+        for (uint8_t slot = CPU_SLOT_IDLE + 1; slot < CPU_SLOT_COUNT; slot++) {
+            if (CpuLoad_SlotName(slot)) {
+                printf(" %s %.2f%%", CpuLoad_SlotName(slot), cpu_load.total_cycles[slot] * 100.0 / total);
+            }
+        }
+        printf("\n");
+    }
+    printf("control %u Hz, %u runs, exec max %u cycles, adc %u blocks (%u overruns), %u pot mode changes\n",
+           control_stats.rate_hz, control_stats.runs, control_stats.exec_max, adc_stats.blocks, adc_stats.overruns,
+           adc_stats.pot_modes);
+    printf("pot awd %u events, filtered in %u blocks\n", adc_stats.awd_events, adc_stats.pot_blocks);
+    printf("tach");
+    for (uint8_t fan = 0; fan < HW_FAN_COUNT; fan++) {
+        printf("%s fan%u %u rpm (model %.0f, pwm %u.%u%%)", fan ? "," : "", fan + 1, Tach_GetRpm(fan),
+               HW_Sim_FanRpm(fan), Sim_DutyPermille(hw_sim.pwm_ccr[fan]) / 10,
+               Sim_DutyPermille(hw_sim.pwm_ccr[fan]) % 10);
+    }
+    printf(": %u captures, %u overcaptures, %u starts, %u stalls\n",
+           tach_stats.captures, tach_stats.overcaptures, tach_stats.starts, tach_stats.stalls);
+    if (Temp_Ntc() == TEMP_INVALID) printf("temp ntc fault");
+    else printf("temp ntc %.1f C", Temp_Ntc() / 10.0);
+    printf(", die %.1f C (cal %u/%u), control %.1f C -> %.1f%%: %u samples, %u ntc faults\n",
+           Temp_Die() / 10.0, temp_stats.ts_cal30, temp_stats.ts_cal110, Temp_Control() / 10.0,
+           Temp_DutyQ16() * 100.0 / 65536, temp_stats.samples, temp_stats.ntc_faults);
+    if (rec.steps) {
+        printf("rpm loop %u steps", rec.steps);
+        if (rec.step_target) {
+            printf(", last %.0f->%u rpm: settle %.0f ms, overshoot %.1f%%", rec.step_from, rec.step_target,
+                   (rec.step_out_us - rec.step_us) / 1e3, Sim_StepOvershoot());
+        }
+        printf("\n");
+    }
+    printf("watchdog %.0f ms, %u feeds, check-in gap max:", hw_sim.iwdg_timeout_us / 1e3, wdg_stats.feeds);
+    for (uint8_t id = 0; id < WDG_COUNT; id++) {
+        printf(" %s %u/%u ms", Wdg_Name(id), wdg_stats.age_max[id], wdg_stats.deadline[id]);
+    }
+    printf("\n");
+    if (rec.stall) {
+        printf("stall %s @%llu ms:", stall_names[rec.stall], (unsigned long long)(rec.stall_us / 1000));
+        if (rec.detect_us) {
+            printf(" %s overdue +%.0f ms", Wdg_Name(Sim_StalledTask()), (rec.detect_us - rec.stall_us) / 1e3);
+        } else {
+            printf(" not detected");
+        }
+        if (hw_sim.halted) printf(", iwdg reset +%.0f ms", (hw_sim.reset_us - rec.stall_us) / 1e3);
+        printf("\n");
+    }
+    if (hw_sim.halted && !rec.reset_expected) {
+        printf("FAIL iwdg reset @%llu ms (stalled: %s)\n", (unsigned long long)(hw_sim.reset_us / 1000),
+               Wdg_Name(Sim_StalledTask()));
+        rec.failures++;
+    }
+    printf("events %u pushed, %u dropped, high water %u/%u\n",
+           evq_stats.pushed, evq_stats.dropped, evq_stats.high_water, EVQ_SIZE);
+    for (int8_t id = 0; id < SCHED_MAX_TASKS; id++) {
+        const Sched_Task* t = Sched_GetTask(id);
+        if (!t->runs) continue;
+        uint32_t timed = t->runs - t->forced_runs;   // Lần chạy theo deadline
+        printf("task %-10s runs %u (%u forced), run avg %.3f max %.3f ms, late avg %.3f max %.3f ms, skipped %u\n",
+               t->name, t->runs, t->forced_runs, t->run_total / 1e3 / t->runs, t->run_max / 1e3,
+               timed ? t->late_total / 1e3 / timed : 0.0, t->late_max / 1e3, t->skipped);
+    }
+
+    // Cùng định dạng với bản dump bộ nhớ lấy từ board bằng debugger
+    if (jitter_path) {
+        FILE* f = fopen(jitter_path, "wb");
+        if (!f || fwrite(&sched_jitter, sizeof(sched_jitter), 1, f) != 1) {
+            fprintf(stderr, "khong ghi duoc %s\n", jitter_path);
+            if (f) fclose(f);
+            return 2;
+        }
+        fclose(f);
+    }
+
+    return (rec.failures || oled_sim.violations) ? 1 : 0;
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================
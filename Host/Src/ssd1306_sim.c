@@ -0,0 +1,392 @@
+// =================================
+// ========== FILE INCLUDE =========
+// =================================
+
+#include "ssd1306_sim.h"  // Khai báo mô hình SSD1306
+#include <stdarg.h>       // va_list cho hàm báo lỗi
+#include <stdio.h>        // vsnprintf, fprintf
+#include <string.h>       // memset
+
+// Thực thể mô hình dùng chung với backend I2C giả lập
+SSD1306Sim oled_sim;
+
+// Số frame tương ứng với mã khoảng thời gian cuộn (byte C của lệnh 0x26/0x27)
+static const uint16_t scroll_interval_frames[8] = {5, 64, 128, 256, 3, 4, 25, 2};
+
+
+// =======================================
+// ========== FUNCTION DEFINITIONS =======
+// =======================================
+
+/**
+ * @brief Ghi nhận 1 vi phạm giao thức và lưu lại thông báo gần nhất
+ */
+static void SSD1306Sim_Violation(SSD1306Sim* sim, const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(sim->last_violation, sizeof(sim->last_violation), fmt, args);
+    va_end(args);
+
+    sim->violations++;
+    if (sim->verbose) fprintf(stderr, "ssd1306_sim: %s\n", sim->last_violation);
+}
+
+
+/**
+ * @brief Đưa mô hình về trạng thái sau khi cấp nguồn (theo giá trị reset trong datasheet)
+ */
+void SSD1306Sim_Reset(SSD1306Sim* sim) {
+    uint8_t verbose = sim->verbose;   // Giữ lại tuỳ chọn in lỗi
+
+    memset(sim, 0, sizeof(*sim));
+    sim->verbose = verbose;
+
+    sim->addr_mode = 2;               // Mặc định: Page addressing
+    sim->col_end = SSD1306_SIM_WIDTH - 1;
+    sim->page_end = SSD1306_SIM_PAGES - 1;
+    sim->mux_ratio = 63;
+    sim->contrast = 0x7F;
+    sim->charge_pump = 0x10;          // Charge pump tắt
+    sim->vscroll_rows = SSD1306_SIM_HEIGHT;
+}
+
+
+/**
+ * @brief Xóa bộ đếm thống kê, giữ nguyên GDDRAM và thanh ghi
+ */
+void SSD1306Sim_ResetStats(SSD1306Sim* sim) {
+    sim->transactions = 0;
+    sim->bus_bytes = 0;
+    sim->cmd_bytes = 0;
+    sim->data_bytes = 0;
+    sim->nacks = 0;
+    sim->violations = 0;
+    sim->last_violation[0] = '\0';
+}
+
+
+/**
+ * @brief Số byte tham số đi kèm mỗi lệnh (0 nếu lệnh chỉ có 1 byte)
+ */
+static uint8_t SSD1306Sim_ParamCount(uint8_t cmd) {
+    switch (cmd) {
+        case 0x20: case 0x81: case 0x8D: case 0xA8:
+        case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x26: case 0x27:
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * @brief Thực thi 1 lệnh đã nhận đủ tham số
+ */
+static void SSD1306Sim_Execute(SSD1306Sim* sim, const uint8_t* c) {
+    uint8_t cmd = c[0];
+
+    // Datasheet: phải tắt cuộn (0x2E) trước khi đổi cấu hình hoặc ghi RAM
+    if (sim->scroll_active && cmd != 0x2E && cmd != 0xAE && cmd != 0xAF) {
+        SSD1306Sim_Violation(sim, "lenh 0x%02X gui khi dang cuon", cmd);
+    }
+
+    if (cmd <= 0x0F) {                               // Cột - 4 bit thấp
+        sim->col = (sim->col & 0xF0) | (cmd & 0x0F);
+    } else if (cmd <= 0x1F) {                        // Cột - 4 bit cao
+        sim->col = (sim->col & 0x0F) | ((cmd & 0x07) << 4);
+        if (cmd & 0x08) SSD1306Sim_Violation(sim, "cot cao 0x%02X vuot 127", cmd);
+    } else if (cmd >= 0x40 && cmd <= 0x7F) {         // Start line
+        sim->start_line = cmd & 0x3F;
+    } else if (cmd >= 0xB0 && cmd <= 0xB7) {         // Page start
+        sim->page = cmd & 0x07;
+    } else {
+        switch (cmd) {
+            case 0x20:
+                if (c[1] > 2) SSD1306Sim_Violation(sim, "addressing mode 0x%02X khong hop le", c[1]);
+                else sim->addr_mode = c[1];
+                break;
+            case 0x21:
+                if (c[1] > 127 || c[2] > 127 || c[1] > c[2])
+                    SSD1306Sim_Violation(sim, "cua so cot %u..%u khong hop le", c[1], c[2]);
+                sim->col_start = c[1] & 0x7F;
+                sim->col_end = c[2] & 0x7F;
+                sim->col = sim->col_start;
+                break;
+            case 0x22:
+                if (c[1] > 7 || c[2] > 7 || c[1] > c[2])
+                    SSD1306Sim_Violation(sim, "cua so page %u..%u khong hop le", c[1], c[2]);
+                sim->page_start = c[1] & 0x07;
+                sim->page_end = c[2] & 0x07;
+                sim->page = sim->page_start;
+                break;
+            case 0x26: case 0x27:
+                if (c[1] != 0x00 || c[5] != 0x00 || c[6] != 0xFF)
+                    SSD1306Sim_Violation(sim, "byte dummy cua lenh cuon 0x%02X sai", cmd);
+                sim->scroll_dir = (cmd == 0x27);
+                sim->scroll_vertical = 0;
+                sim->scroll_page_start = c[2] & 0x07;
+                sim->scroll_interval = c[3] & 0x07;
+                sim->scroll_page_end = c[4] & 0x07;
+                sim->scroll_voffset = 0;
+                break;
+            case 0x29: case 0x2A:
+                if (c[1] != 0x00) SSD1306Sim_Violation(sim, "byte dummy cua lenh cuon 0x%02X sai", cmd);
+                sim->scroll_dir = (cmd == 0x2A);
+                sim->scroll_vertical = 1;
+                sim->scroll_page_start = c[2] & 0x07;
+                sim->scroll_interval = c[3] & 0x07;
+                sim->scroll_page_end = c[4] & 0x07;
+                sim->scroll_voffset = c[5] & 0x3F;
+                break;
+            case 0xA3:
+                if (c[1] + c[2] > SSD1306_SIM_HEIGHT)
+                    SSD1306Sim_Violation(sim, "vung cuon doc %u+%u vuot 64 dong", c[1], c[2]);
+                sim->vscroll_top = c[1] & 0x3F;
+                sim->vscroll_rows = c[2] & 0x7F;
+                break;
+            case 0x2E:
+                sim->scroll_active = 0;
+                break;
+            case 0x2F:
+                if (sim->scroll_page_start > sim->scroll_page_end)
+                    SSD1306Sim_Violation(sim, "bat cuon voi page %u > %u",
+                                         sim->scroll_page_start, sim->scroll_page_end);
+                sim->scroll_active = 1;
+                sim->scroll_frames = 0;
+                sim->scroll_hpos = 0;
+                sim->scroll_vpos = 0;
+                break;
+            case 0x81: sim->contrast = c[1]; break;
+            case 0x8D:
+                if ((c[1] & ~0x04) != 0x10) SSD1306Sim_Violation(sim, "charge pump 0x%02X khong hop le", c[1]);
+                sim->charge_pump = c[1];
+                break;
+            case 0xA0: case 0xA1: sim->seg_remap = cmd & 1; break;
+            case 0xA4: case 0xA5: sim->entire_on = cmd & 1; break;
+            case 0xA6: case 0xA7: sim->inverse = cmd & 1; break;
+            case 0xA8:
+                if (c[1] < 15 || c[1] > 63) SSD1306Sim_Violation(sim, "multiplex %u ngoai 15..63", c[1]);
+                sim->mux_ratio = c[1] & 0x3F;
+                break;
+            case 0xAE: case 0xAF: sim->display_on = cmd & 1; break;
+            case 0xC0: case 0xC8: sim->com_remap = (cmd == 0xC8); break;
+            case 0xD3:
+                if (c[1] > 63) SSD1306Sim_Violation(sim, "display offset %u vuot 63", c[1]);
+                sim->display_offset = c[1] & 0x3F;
+                break;
+            case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+                break;                               // Thông số analog – không ảnh hưởng ảnh
+            case 0xE3:
+                break;                               // NOP
+            default:
+                SSD1306Sim_Violation(sim, "lenh 0x%02X khong ton tai", cmd);
+                break;
+        }
+    }
+}
+
+
+/**
+ * @brief Nhận 1 byte lệnh (hoặc tham số của lệnh đang chờ)
+ */
+static void SSD1306Sim_CommandByte(SSD1306Sim* sim, uint8_t b) {
+    sim->cmd_bytes++;
+
+    if (sim->cmd_need == 0) {
+        sim->cmd_buf[0] = b;
+        sim->cmd_len = 1;
+        sim->cmd_need = SSD1306Sim_ParamCount(b);
+    } else {
+        sim->cmd_buf[sim->cmd_len++] = b;
+        sim->cmd_need--;
+    }
+
+    if (sim->cmd_need == 0) {
+        SSD1306Sim_Execute(sim, sim->cmd_buf);
+        sim->cmd_len = 0;
+    }
+}
+
+
+/**
+ * @brief Nhận 1 byte dữ liệu: ghi vào GDDRAM và tăng con trỏ theo addressing mode
+ */
+static void SSD1306Sim_DataByte(SSD1306Sim* sim, uint8_t b) {
+    sim->data_bytes++;
+
+    if (sim->cmd_need) {
+        SSD1306Sim_Violation(sim, "du lieu den khi lenh 0x%02X con thieu %u tham so",
+                             sim->cmd_buf[0], sim->cmd_need);
+        sim->cmd_need = 0;
+        sim->cmd_len = 0;
+    }
+    if (sim->scroll_active) {
+        SSD1306Sim_Violation(sim, "ghi GDDRAM khi dang cuon");
+    }
+
+    sim->gddram[sim->page & 0x07][sim->col & 0x7F] = b;
+
+    switch (sim->addr_mode) {
+        case 0:  // Horizontal: hết cột → xuống page kế tiếp
+            if (sim->col >= sim->col_end) {
+                sim->col = sim->col_start;
+                sim->page = (sim->page >= sim->page_end) ? sim->page_start : sim->page + 1;
+            } else {
+                sim->col++;
+            }
+            break;
+        case 1:  // Vertical: hết page → sang cột kế tiếp
+            if (sim->page >= sim->page_end) {
+                sim->page = sim->page_start;
+                sim->col = (sim->col >= sim->col_end) ? sim->col_start : sim->col + 1;
+            } else {
+                sim->page++;
+            }
+            break;
+        default: // Page: chỉ tăng cột, page giữ nguyên
+            sim->col = (sim->col + 1) & 0x7F;
+            break;
+    }
+}
+
+
+/**
+ * @brief Xử lý 1 transaction I2C (START, địa chỉ, các byte, STOP)
+ *
+ * @param addr Địa chỉ 7-bit mà master gửi
+ * @param buf Các byte sau byte địa chỉ (bắt đầu bằng control byte)
+ * @param len Số byte trong buf
+ * @return 1 nếu thiết bị ACK, 0 nếu sai địa chỉ (NACK)
+ */
+uint8_t SSD1306Sim_Transfer(SSD1306Sim* sim, uint8_t addr, const uint8_t* buf, uint32_t len) {
+    uint32_t i = 0;
+
+    sim->transactions++;
+    sim->bus_bytes++;                 // Byte địa chỉ luôn xuất hiện trên bus
+
+    if (addr != SSD1306_SIM_ADDR) {
+        sim->nacks++;
+        return 0;
+    }
+    if (len == 0) {
+        SSD1306Sim_Violation(sim, "transaction rong");
+        return 1;
+    }
+
+    sim->bus_bytes += len;
+
+    while (i < len) {
+        uint8_t control = buf[i++];
+        uint8_t co = control >> 7;           // Continuation bit
+        uint8_t dc = (control >> 6) & 1;     // 0: command, 1: data
+
+        if (control & 0x3F) {
+            SSD1306Sim_Violation(sim, "control byte 0x%02X co bit du tru", control);
+        }
+        if (i >= len) {
+            SSD1306Sim_Violation(sim, "control byte 0x%02X khong co du lieu theo sau", control);
+            break;
+        }
+
+        if (co) {
+            // Co = 1: đúng 1 byte rồi tới control byte kế tiếp
+            if (dc) SSD1306Sim_DataByte(sim, buf[i++]);
+            else    SSD1306Sim_CommandByte(sim, buf[i++]);
+        } else {
+            // Co = 0: phần còn lại của transaction cùng một loại
+            while (i < len) {
+                if (dc) SSD1306Sim_DataByte(sim, buf[i++]);
+                else    SSD1306Sim_CommandByte(sim, buf[i++]);
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief Cho thời gian hiển thị trôi qua (tính theo frame) để cập nhật vị trí cuộn
+ */
+void SSD1306Sim_AdvanceFrames(SSD1306Sim* sim, uint32_t frames) {
+    uint32_t steps;
+
+    if (!sim->scroll_active) return;
+
+    sim->scroll_frames += frames;
+    steps = sim->scroll_frames / scroll_interval_frames[sim->scroll_interval];
+
+    sim->scroll_hpos = steps % SSD1306_SIM_WIDTH;
+    if (sim->scroll_vertical) {
+        sim->scroll_vpos = (steps * sim->scroll_voffset) % SSD1306_SIM_HEIGHT;
+    }
+}
+
+
+/**
+ * @brief Đọc 1 điểm ảnh như người dùng nhìn thấy trên module
+ *
+ * Toạ độ (x, y) tính theo module lắp chuẩn: với 0xA1 + 0xC8 ảnh hiện đúng chiều,
+ * góc (0, 0) ở trên trái. Áp dụng remap, start line, offset, cuộn, đảo màu.
+ *
+ * @return 1 nếu điểm ảnh sáng, 0 nếu tắt
+ */
+uint8_t SSD1306Sim_GetPixel(const SSD1306Sim* sim, uint8_t x, uint8_t y) {
+    uint8_t line, row, col, page, pixel;
+
+    if (x >= SSD1306_SIM_WIDTH || y >= SSD1306_SIM_HEIGHT) return 0;
+    if (!sim->display_on) return 0;
+    if (sim->entire_on) return 1;
+
+    // Dòng COM đang quét ứng với y, bỏ qua các dòng ngoài multiplex ratio
+    line = sim->com_remap ? y : (SSD1306_SIM_HEIGHT - 1 - y);
+    if (line > sim->mux_ratio) return sim->inverse;
+
+    row = (line + sim->start_line + sim->display_offset) & 0x3F;
+    if (sim->scroll_active && sim->scroll_vertical &&
+        row >= sim->vscroll_top && row < sim->vscroll_top + sim->vscroll_rows) {
+        row = sim->vscroll_top + (row - sim->vscroll_top + sim->scroll_vpos) % sim->vscroll_rows;
+    }
+
+    col = sim->seg_remap ? x : (SSD1306_SIM_WIDTH - 1 - x);
+    page = row >> 3;
+    if (sim->scroll_active && page >= sim->scroll_page_start && page <= sim->scroll_page_end) {
+        col = sim->scroll_dir ? (col + sim->scroll_hpos) & 0x7F : (col - sim->scroll_hpos) & 0x7F;
+    }
+
+    pixel = (sim->gddram[page][col] >> (row & 7)) & 1;
+    return pixel ^ sim->inverse;
+}
+
+
+/**
+ * @brief Chụp toàn bộ màn hình hiện tại thành ảnh 1 byte/điểm (0 hoặc 1)
+ */
+void SSD1306Sim_Capture(const SSD1306Sim* sim, uint8_t image[SSD1306_SIM_HEIGHT][SSD1306_SIM_WIDTH]) {
+    for (uint8_t y = 0; y < SSD1306_SIM_HEIGHT; y++) {
+        for (uint8_t x = 0; x < SSD1306_SIM_WIDTH; x++) {
+            image[y][x] = SSD1306Sim_GetPixel(sim, x, y);
+        }
+    }
+}
+
+
+/**
+ * @brief Backend I2C giả lập: gửi 1 transaction nhiều byte tới mô hình
+ * @return 1 nếu ACK, 0 nếu NACK
+ */
+uint8_t I2C_Sim_Write(uint8_t addr, const uint8_t* buf, uint32_t len) {
+    return SSD1306Sim_Transfer(&oled_sim, addr, buf, len);
+}
+
+
+// =======================================
+// ============= END FILE ================
+// =======================================